@@ -0,0 +1,280 @@
+/**
+ * @file Arduino.cpp
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#include <Arduino.h>
+#include <Sim.h>
+#include <chrono>
+#include <thread>
+#include <mutex>
+
+/**
+ * Namespace Definitions
+ */
+namespace Sim
+{
+	// Pin states
+	const uint8_t num_pins = 20;
+	bool pin_level[num_pins] = {false};
+	float pin_pwm[num_pins] = {0.0f};
+
+	// Pin interrupts
+	void (*pin_isr[num_pins])() = {nullptr};
+	int pin_isr_mode[num_pins] = {0};
+	bool pin_isr_pending[num_pins] = {false};
+	bool isr_enabled = true;
+
+	// Held while interrupts are disabled or a timer ISR runs (never destroyed
+	// so timer threads can outlive static destruction at exit)
+	std::mutex& isr_mutex = *new std::mutex();
+
+	// Clock reference
+	const std::chrono::steady_clock::time_point t_start =
+		std::chrono::steady_clock::now();
+#if defined(SIM_MANUAL_CLOCK)
+	bool clock_is_manual = true;
+#else
+	bool clock_is_manual = false;
+#endif
+	unsigned long clock_us = 0;
+}
+
+/**
+ * @brief Sets pin mode (all pins behave as bidirectional on host)
+ */
+void pinMode(uint8_t pin, uint8_t mode)
+{
+	if (pin < Sim::num_pins && mode == INPUT_PULLUP)
+	{
+		Sim::pin_level[pin] = true;
+	}
+}
+
+/**
+ * @brief Sets digital output level
+ */
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+	if (pin < Sim::num_pins)
+	{
+		Sim::pin_level[pin] = (val != LOW);
+		Sim::pin_pwm[pin] = (val != LOW) ? 1.0f : 0.0f;
+	}
+}
+
+/**
+ * @brief Returns digital input level
+ */
+int digitalRead(uint8_t pin)
+{
+	return (pin < Sim::num_pins && Sim::pin_level[pin]) ? HIGH : LOW;
+}
+
+/**
+ * @brief Sets 8-bit PWM output duty cycle
+ */
+void analogWrite(uint8_t pin, int val)
+{
+	if (pin < Sim::num_pins)
+	{
+		Sim::pin_pwm[pin] = val / 255.0f;
+	}
+}
+
+/**
+ * @brief Attaches ISR to pin-change events
+ */
+void attachInterrupt(uint8_t interrupt, void (*isr)(), int mode)
+{
+	if (interrupt < Sim::num_pins)
+	{
+		Sim::pin_isr[interrupt] = isr;
+		Sim::pin_isr_mode[interrupt] = mode;
+	}
+}
+
+/**
+ * @brief Detaches ISR from pin
+ */
+void detachInterrupt(uint8_t interrupt)
+{
+	if (interrupt < Sim::num_pins)
+	{
+		Sim::pin_isr[interrupt] = nullptr;
+	}
+}
+
+/**
+ * @brief Enables interrupts and runs ISRs which fired while disabled
+ */
+void interrupts()
+{
+	if (Sim::isr_enabled) return;
+	Sim::isr_enabled = true;
+	Sim::isr_mutex.unlock();
+	for (uint8_t pin = 0; pin < Sim::num_pins; pin++)
+	{
+		if (Sim::pin_isr_pending[pin])
+		{
+			Sim::pin_isr_pending[pin] = false;
+			if (Sim::pin_isr[pin]) Sim::pin_isr[pin]();
+		}
+	}
+}
+
+/**
+ * @brief Disables interrupts
+ */
+void noInterrupts()
+{
+	if (!Sim::isr_enabled) return;
+	Sim::isr_mutex.lock();
+	Sim::isr_enabled = false;
+}
+
+/**
+ * @brief Returns microseconds since program start
+ */
+unsigned long micros()
+{
+	if (Sim::clock_is_manual) return Sim::clock_us;
+	using namespace std::chrono;
+	return (unsigned long)duration_cast<microseconds>(
+		steady_clock::now() - Sim::t_start).count();
+}
+
+/**
+ * @brief Returns milliseconds since program start
+ */
+unsigned long millis()
+{
+	return micros() / 1000;
+}
+
+/**
+ * @brief Sleeps for given milliseconds (advances manual clock instantly)
+ */
+void delay(unsigned long ms)
+{
+	if (Sim::clock_is_manual)
+	{
+		Sim::clock_us += ms * 1000;
+		return;
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+/**
+ * @brief Busy-waits for given microseconds (advances manual clock instantly)
+ */
+void delayMicroseconds(unsigned int us)
+{
+	if (Sim::clock_is_manual)
+	{
+		Sim::clock_us += us;
+		return;
+	}
+	const unsigned long t_start = micros();
+	while (micros() - t_start < us);
+}
+
+/**
+ * @brief Drives input pin level and fires attached ISR on matching edge
+ */
+void Sim::set_pin(uint8_t pin, bool level)
+{
+	if (pin >= num_pins || pin_level[pin] == level) return;
+	pin_level[pin] = level;
+	const int mode = pin_isr_mode[pin];
+	const bool fire =
+		(mode == CHANGE) ||
+		(mode == RISING && level) ||
+		(mode == FALLING && !level);
+	if (pin_isr[pin] && fire)
+	{
+		if (isr_enabled) pin_isr[pin]();
+		else pin_isr_pending[pin] = true;
+	}
+}
+
+/**
+ * @brief Returns digital pin level
+ */
+bool Sim::get_pin(uint8_t pin)
+{
+	return (pin < num_pins) && pin_level[pin];
+}
+
+/**
+ * @brief Returns PWM duty cycle [0, 1] of pin
+ */
+float Sim::get_pwm(uint8_t pin)
+{
+	return (pin < num_pins) ? pin_pwm[pin] : 0.0f;
+}
+
+/**
+ * @brief Sets PWM duty cycle [0, 1] of pin (stands in for Timer1 in Hal)
+ */
+void Sim::set_pwm(uint8_t pin, float duty)
+{
+	if (pin < num_pins) pin_pwm[pin] = duty;
+}
+
+/**
+ * @brief Switches clock between real time and host-advanced time
+ */
+void Sim::clock_manual(bool manual)
+{
+	if (manual && !clock_is_manual) clock_us = micros();
+	clock_is_manual = manual;
+}
+
+/**
+ * @brief Advances manual clock by given microseconds
+ */
+void Sim::clock_advance(uint32_t us)
+{
+	clock_us += us;
+}
+
+/**
+ * @brief Calls isr every period_us from a background thread
+ */
+void Sim::start_timer(uint32_t period_us, void (*isr)())
+{
+	std::thread([period_us, isr]()
+	{
+		using namespace std::chrono;
+		steady_clock::time_point t_next = steady_clock::now();
+		while (true)
+		{
+			t_next += microseconds(period_us);
+			std::this_thread::sleep_until(t_next);
+			std::lock_guard<std::mutex> lock(isr_mutex);
+			isr();
+		}
+	}).detach();
+}
+
+#if !defined(PIO_UNIT_TESTING)
+
+/**
+ * @brief Runs sketch setup and loop
+ *
+ * Set environment variable BALBOT_LOOPS to bound the number of loop calls.
+ * Unit tests under test/ provide their own main.
+ */
+int main()
+{
+	const char* loops_env = getenv("BALBOT_LOOPS");
+	const long loops = loops_env ? atol(loops_env) : -1;
+	setup();
+	for (long i = 0; loops < 0 || i < loops; i++)
+	{
+		loop();
+	}
+	return 0;
+}
+
+#endif
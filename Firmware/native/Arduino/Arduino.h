@@ -0,0 +1,63 @@
+/**
+ * @file Arduino.h
+ * @brief Linux stand-in for the Arduino core API used by BalBot
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * Only the subset of the Arduino API used by the BalBot subsystems and their
+ * libraries is emulated. Pins, PWM outputs, I2C devices, and the serial port
+ * are backed by in-memory models which host programs can drive via Sim.h.
+ */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <WString.h>
+#include <HardwareSerial.h>
+
+// Pin Levels and Modes
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+// Interrupt Modes
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+// Program Memory (flat address space on host)
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+#define pgm_read_float(addr) (*(const float*)(addr))
+
+// Types
+typedef uint8_t byte;
+typedef bool boolean;
+
+// Digital IO
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int val);
+
+// Interrupts (every pin is interrupt-capable on host)
+#define digitalPinToInterrupt(pin) (pin)
+void attachInterrupt(uint8_t interrupt, void (*isr)(), int mode);
+void detachInterrupt(uint8_t interrupt);
+void interrupts();
+void noInterrupts();
+
+// Timing
+unsigned long micros();
+unsigned long millis();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// Sketch Entry Points
+void setup();
+void loop();
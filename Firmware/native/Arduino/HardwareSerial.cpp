@@ -0,0 +1,226 @@
+/**
+ * @file HardwareSerial.cpp
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#include <HardwareSerial.h>
+#include <Sim.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <deque>
+#include <Arduino.h>
+
+/**
+ * Namespace Definitions
+ */
+namespace Sim
+{
+	std::deque<uint8_t> serial_rx_buf;	// Bytes sent to firmware
+	std::deque<uint8_t> serial_tx_buf;	// Bytes sent by firmware
+	bool serial_captured = false;		// Capture TX instead of stdout
+
+	// UART TX model (AVR 64-byte TX ring drained at baud / 10 bytes/s)
+	const int serial_tx_ring = 64;		// TX ring size [bytes]
+	bool serial_throttled = false;		// Model UART throughput
+	unsigned long serial_baud = 0;		// Baud rate [bit/s]
+	float serial_tx_queued = 0.0f;		// Bytes in TX ring
+	unsigned long serial_tx_t = 0;		// Last drain time [us]
+
+	// Private functions
+	void serial_drain();
+}
+
+// Global Serial Port
+HardwareSerial Serial;
+
+/**
+ * @brief Writes buffer byte-by-byte
+ */
+size_t Print::write(const uint8_t* buffer, size_t size)
+{
+	size_t n = 0;
+	while (size--) n += write(*buffer++);
+	return n;
+}
+
+/**
+ * @brief Print methods
+ */
+size_t Print::print(const char* str)
+{
+	return write((const uint8_t*)str, strlen(str));
+}
+size_t Print::print(const String& str)
+{
+	return print(str.c_str());
+}
+size_t Print::print(long value)
+{
+	return print(String(value));
+}
+size_t Print::print(double value, int decimals)
+{
+	return print(String(value, (unsigned char)decimals));
+}
+size_t Print::println()
+{
+	return print("\r\n");
+}
+size_t Print::println(const char* str)
+{
+	return print(str) + println();
+}
+size_t Print::println(const String& str)
+{
+	return print(str) + println();
+}
+size_t Print::println(long value)
+{
+	return print(value) + println();
+}
+size_t Print::println(double value, int decimals)
+{
+	return print(value, decimals) + println();
+}
+
+/**
+ * @brief Opens serial port (baud sets the throttled TX rate on host)
+ */
+void HardwareSerial::begin(unsigned long baud)
+{
+	Sim::serial_baud = baud;
+}
+
+/**
+ * @brief Closes serial port (no-op on host)
+ */
+void HardwareSerial::end() {}
+
+/**
+ * @brief Returns number of received bytes
+ */
+int HardwareSerial::available()
+{
+	return (int)Sim::serial_rx_buf.size();
+}
+
+/**
+ * @brief Returns free TX space (unlimited unless throttled)
+ */
+int HardwareSerial::availableForWrite()
+{
+	if (!Sim::serial_throttled) return Sim::serial_tx_ring - 1;
+	Sim::serial_drain();
+	return Sim::serial_tx_ring - 1 - (int)ceilf(Sim::serial_tx_queued);
+}
+
+/**
+ * @brief Reads next received byte or returns -1 if empty
+ */
+int HardwareSerial::read()
+{
+	if (Sim::serial_rx_buf.empty()) return -1;
+	const uint8_t byte = Sim::serial_rx_buf.front();
+	Sim::serial_rx_buf.pop_front();
+	return byte;
+}
+
+/**
+ * @brief Returns next received byte without consuming it
+ */
+int HardwareSerial::peek()
+{
+	return Sim::serial_rx_buf.empty() ? -1 : Sim::serial_rx_buf.front();
+}
+
+/**
+ * @brief Waits for transmission to complete
+ */
+void HardwareSerial::flush()
+{
+	if (!Sim::serial_captured) fflush(stdout);
+}
+
+/**
+ * @brief Transmits byte
+ */
+size_t HardwareSerial::write(uint8_t byte)
+{
+	if (Sim::serial_throttled)
+	{
+		// Block until the TX ring has room, as on the AVR
+		Sim::serial_drain();
+		const float excess = Sim::serial_tx_queued - (Sim::serial_tx_ring - 2);
+		if (excess > 0.0f)
+		{
+			delayMicroseconds((unsigned int)ceilf(excess * 1e7f / Sim::serial_baud));
+			Sim::serial_drain();
+		}
+		Sim::serial_tx_queued += 1.0f;
+	}
+	if (Sim::serial_captured) Sim::serial_tx_buf.push_back(byte);
+	else putchar(byte);
+	return 1;
+}
+
+/**
+ * @brief Returns true (port is always open on host)
+ */
+HardwareSerial::operator bool() const
+{
+	return true;
+}
+
+/**
+ * @brief Injects bytes into firmware serial RX buffer
+ */
+void Sim::serial_rx(const uint8_t* data, size_t size)
+{
+	serial_rx_buf.insert(serial_rx_buf.end(), data, data + size);
+}
+
+/**
+ * @brief Redirects firmware serial TX from stdout into a buffer
+ */
+void Sim::serial_capture(bool capture)
+{
+	serial_captured = capture;
+}
+
+/**
+ * @brief Models UART throughput at the begin() baud rate
+ * 
+ * When on, availableForWrite() reports the free space of a 64-byte TX ring
+ * and write() blocks while it is full, as on the AVR.
+ */
+void Sim::serial_throttle(bool throttle)
+{
+	serial_throttled = throttle;
+	serial_tx_queued = 0.0f;
+	serial_tx_t = micros();
+}
+
+/**
+ * @brief Removes bytes sent since last call from modeled TX ring
+ */
+void Sim::serial_drain()
+{
+	const unsigned long t = micros();
+	serial_tx_queued -= (t - serial_tx_t) * 1e-7f * serial_baud;
+	if (serial_tx_queued < 0.0f) serial_tx_queued = 0.0f;
+	serial_tx_t = t;
+}
+
+/**
+ * @brief Takes up to size bytes from captured TX and returns count
+ */
+size_t Sim::serial_tx(uint8_t* data, size_t size)
+{
+	size_t n = 0;
+	while (n < size && !serial_tx_buf.empty())
+	{
+		data[n++] = serial_tx_buf.front();
+		serial_tx_buf.pop_front();
+	}
+	return n;
+}
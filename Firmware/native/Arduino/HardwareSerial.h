@@ -0,0 +1,65 @@
+/**
+ * @file HardwareSerial.h
+ * @brief Linux stand-in for the Arduino Print, Stream, and Serial classes
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <WString.h>
+
+/**
+ * Print Class Declaration
+ */
+class Print
+{
+public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t byte) = 0;
+	virtual size_t write(const uint8_t* buffer, size_t size);
+	size_t print(const char* str);
+	size_t print(const String& str);
+	size_t print(long value);
+	size_t print(double value, int decimals = 2);
+	size_t println();
+	size_t println(const char* str);
+	size_t println(const String& str);
+	size_t println(long value);
+	size_t println(double value, int decimals = 2);
+};
+
+/**
+ * Stream Class Declaration
+ */
+class Stream : public Print
+{
+public:
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+	virtual void flush() {}
+};
+
+/**
+ * HardwareSerial Class Declaration
+ *
+ * Received bytes are injected with Sim::serial_rx(). Transmitted bytes are
+ * echoed to stdout unless captured with Sim::serial_capture().
+ */
+class HardwareSerial : public Stream
+{
+public:
+	void begin(unsigned long baud);
+	void end();
+	int available();
+	int availableForWrite();
+	int read();
+	int peek();
+	void flush();
+	size_t write(uint8_t byte);
+	using Print::write;
+	operator bool() const;
+};
+
+// Global Serial Port
+extern HardwareSerial Serial;
@@ -0,0 +1,46 @@
+/**
+ * @file Sim.h
+ * @brief Host-side hooks into the Linux Arduino stand-in
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * Lets host programs (benchmarks, simulators) drive sensor inputs and observe
+ * actuator outputs of the firmware running against the stand-in core.
+ *
+ * Timer interrupts run on a background thread and are held off while the
+ * firmware has interrupts disabled, as on the AVR. The clock follows real
+ * time unless clock_manual() hands it to the host program, which can then
+ * generate precisely timed input waveforms with clock_advance(). Building
+ * with -D SIM_MANUAL_CLOCK starts the program on the manual clock at zero, so
+ * firmware initialization is timed identically on every run.
+ */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Namespace Declaration
+ */
+namespace Sim
+{
+	// Digital pins
+	void set_pin(uint8_t pin, bool level);
+	bool get_pin(uint8_t pin);
+	float get_pwm(uint8_t pin);
+	void set_pwm(uint8_t pin, float duty);
+
+	// I2C devices
+	uint8_t* i2c_regs(uint8_t address);
+	void write_reg16(uint8_t address, uint8_t reg, int16_t value);
+	void i2c_fifo_push(uint8_t address, uint8_t reg, const uint8_t* data, size_t size);
+
+	// Clock and timer interrupts
+	void clock_manual(bool manual);
+	void clock_advance(uint32_t us);
+	void start_timer(uint32_t period_us, void (*isr)());
+
+	// Serial port
+	void serial_rx(const uint8_t* data, size_t size);
+	void serial_capture(bool capture);
+	void serial_throttle(bool throttle);
+	size_t serial_tx(uint8_t* data, size_t size);
+}
@@ -0,0 +1,66 @@
+/**
+ * @file WString.cpp
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#include <WString.h>
+#include <stdio.h>
+
+/**
+ * @brief Formats floating-point value with given decimal places
+ */
+static std::string format_float(double value, unsigned char decimals)
+{
+	char buf[64];
+	snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+	return std::string(buf);
+}
+
+String::String(const char* str) : str(str) {}
+String::String(const std::string& str) : str(str) {}
+String::String(int value) : str(std::to_string(value)) {}
+String::String(unsigned int value) : str(std::to_string(value)) {}
+String::String(long value) : str(std::to_string(value)) {}
+String::String(unsigned long value) : str(std::to_string(value)) {}
+String::String(float value, unsigned char decimals) : str(format_float(value, decimals)) {}
+String::String(double value, unsigned char decimals) : str(format_float(value, decimals)) {}
+
+/**
+ * @brief Returns C-string pointer
+ */
+const char* String::c_str() const
+{
+	return str.c_str();
+}
+
+/**
+ * @brief Returns string length
+ */
+unsigned int String::length() const
+{
+	return (unsigned int)str.length();
+}
+
+/**
+ * @brief Appends string
+ */
+String& String::operator+=(const String& rhs)
+{
+	str += rhs.str;
+	return *this;
+}
+
+/**
+ * @brief String concatenation operators
+ */
+String operator+(const String& lhs, const String& rhs)
+{
+	return String(lhs.str + rhs.str);
+}
+String operator+(const char* lhs, const String& rhs)
+{
+	return String(lhs + rhs.str);
+}
+String operator+(const String& lhs, const char* rhs)
+{
+	return String(lhs.str + rhs);
+}
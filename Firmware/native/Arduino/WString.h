@@ -0,0 +1,31 @@
+/**
+ * @file WString.h
+ * @brief Linux stand-in for the Arduino String class
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#pragma once
+#include <string>
+
+/**
+ * Class Declaration
+ */
+class String
+{
+public:
+	String(const char* str = "");
+	String(const std::string& str);
+	String(int value);
+	String(unsigned int value);
+	String(long value);
+	String(unsigned long value);
+	String(float value, unsigned char decimals = 2);
+	String(double value, unsigned char decimals = 2);
+	const char* c_str() const;
+	unsigned int length() const;
+	String& operator+=(const String& rhs);
+	friend String operator+(const String& lhs, const String& rhs);
+	friend String operator+(const char* lhs, const String& rhs);
+	friend String operator+(const String& lhs, const char* rhs);
+protected:
+	std::string str;
+};
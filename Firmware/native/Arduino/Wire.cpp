@@ -0,0 +1,236 @@
+/**
+ * @file Wire.cpp
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#include <Wire.h>
+#include <Sim.h>
+#include <map>
+#include <array>
+#include <deque>
+
+/**
+ * Namespace Definitions
+ */
+namespace Sim
+{
+	// Register files by address
+	std::map<uint8_t, std::array<uint8_t, 256>> i2c_devices;
+	uint8_t i2c_reg_ptr[128] = {0};
+
+	// FIFO ports by address and register
+	std::map<uint16_t, std::deque<uint8_t>> i2c_fifos;
+
+	// MPU6050 power-on state
+	const uint8_t mpu_address = 0x68;
+	const uint8_t mpu_who_am_i = 0x75;
+	const uint8_t mpu_acc_z = 0x3F;
+	const int16_t mpu_acc_1g = 16384;
+
+	// MPU6050 FIFO and latched interrupt
+	const uint8_t mpu_pin_int = 11;
+	const uint8_t mpu_int_pin_cfg = 0x37;
+	const uint8_t mpu_int_rd_clear = 0x10;
+	const uint8_t mpu_fifo_count_h = 0x72;
+	const uint8_t mpu_fifo_count_l = 0x73;
+	const uint8_t mpu_fifo_r_w = 0x74;
+	const size_t mpu_fifo_size = 1024;
+	const uint8_t mpu_user_ctrl = 0x6A;
+	const uint8_t mpu_fifo_reset = 0x04;
+
+	// Private functions
+	bool i2c_exists(uint8_t address);
+	uint8_t i2c_read_reg(uint8_t address, uint8_t& ptr);
+	void i2c_init();
+}
+
+// Global I2C Bus
+TwoWire Wire;
+
+/**
+ * @brief Initializes bus (no-op on host)
+ */
+void TwoWire::begin()
+{
+	Sim::i2c_init();
+}
+
+/**
+ * @brief Releases bus (no-op on host)
+ */
+void TwoWire::end() {}
+
+/**
+ * @brief Sets bus clock (no-op on host)
+ */
+void TwoWire::setClock(uint32_t freq)
+{
+	(void)freq;
+}
+
+/**
+ * @brief Starts write transaction to device
+ */
+void TwoWire::beginTransmission(uint8_t address)
+{
+	this->address = address;
+	reg_set = false;
+}
+
+/**
+ * @brief Ends write transaction and returns 0 on ACK or 2 on address NACK
+ */
+uint8_t TwoWire::endTransmission(bool stop)
+{
+	(void)stop;
+	return Sim::i2c_exists(address) ? 0 : 2;
+}
+
+/**
+ * @brief Reads bytes from device starting at register pointer
+ */
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, bool stop)
+{
+	(void)stop;
+	rx_len = 0;
+	rx_pos = 0;
+	if (!Sim::i2c_exists(address)) return 0;
+	uint8_t& ptr = Sim::i2c_reg_ptr[address & 0x7F];
+	for (rx_len = 0; rx_len < quantity; rx_len++)
+	{
+		rx_buf[rx_len] = Sim::i2c_read_reg(address, ptr);
+	}
+	if (address == Sim::mpu_address &&
+		(Sim::i2c_regs(address)[Sim::mpu_int_pin_cfg] & Sim::mpu_int_rd_clear))
+	{
+		Sim::set_pin(Sim::mpu_pin_int, false);
+	}
+	return rx_len;
+}
+uint8_t TwoWire::requestFrom(int address, int quantity, int stop)
+{
+	return requestFrom((uint8_t)address, (uint8_t)quantity, stop != 0);
+}
+
+/**
+ * @brief Writes register pointer (first byte) or register data
+ */
+size_t TwoWire::write(uint8_t byte)
+{
+	if (!Sim::i2c_exists(address)) return 0;
+	uint8_t& ptr = Sim::i2c_reg_ptr[address & 0x7F];
+	if (!reg_set)
+	{
+		ptr = byte;
+		reg_set = true;
+	}
+	else
+	{
+		if (address == Sim::mpu_address && ptr == Sim::mpu_user_ctrl &&
+			(byte & Sim::mpu_fifo_reset))
+		{
+			Sim::i2c_fifos[((uint16_t)address << 8) | Sim::mpu_fifo_r_w].clear();
+		}
+		Sim::i2c_regs(address)[ptr++] = byte;
+	}
+	return 1;
+}
+size_t TwoWire::write(const uint8_t* buffer, size_t size)
+{
+	size_t n = 0;
+	while (size--) n += write(*buffer++);
+	return n;
+}
+
+/**
+ * @brief Returns number of unread received bytes
+ */
+int TwoWire::available()
+{
+	return rx_len - rx_pos;
+}
+
+/**
+ * @brief Returns next received byte or -1 if empty
+ */
+int TwoWire::read()
+{
+	return (rx_pos < rx_len) ? rx_buf[rx_pos++] : -1;
+}
+
+/**
+ * @brief Returns true if device at address has a register file
+ */
+bool Sim::i2c_exists(uint8_t address)
+{
+	return i2c_devices.count(address) > 0;
+}
+
+/**
+ * @brief Reads register at ptr (popping FIFO ports) and advances ptr
+ *
+ * The MPU6050 FIFO count registers report the bytes queued in its FIFO port.
+ */
+uint8_t Sim::i2c_read_reg(uint8_t address, uint8_t& ptr)
+{
+	if (address == mpu_address &&
+		(ptr == mpu_fifo_count_h || ptr == mpu_fifo_count_l))
+	{
+		const size_t count = i2c_fifos[((uint16_t)address << 8) | mpu_fifo_r_w].size();
+		return (ptr++ == mpu_fifo_count_h) ? (uint8_t)(count >> 8) : (uint8_t)count;
+	}
+	auto fifo = i2c_fifos.find(((uint16_t)address << 8) | ptr);
+	if (fifo != i2c_fifos.end())
+	{
+		if (fifo->second.empty()) return 0;
+		const uint8_t byte = fifo->second.front();
+		fifo->second.pop_front();
+		return byte;
+	}
+	return i2c_regs(address)[ptr++];
+}
+
+/**
+ * @brief Creates default devices on the bus
+ */
+void Sim::i2c_init()
+{
+	if (!i2c_exists(mpu_address))
+	{
+		uint8_t* regs = i2c_regs(mpu_address);
+		regs[mpu_who_am_i] = mpu_address;
+		write_reg16(mpu_address, mpu_acc_z, mpu_acc_1g);
+	}
+}
+
+/**
+ * @brief Returns register file of device at address (creating it if needed)
+ */
+uint8_t* Sim::i2c_regs(uint8_t address)
+{
+	return i2c_devices[address].data();
+}
+
+/**
+ * @brief Writes big-endian 16-bit value to register pair
+ */
+void Sim::write_reg16(uint8_t address, uint8_t reg, int16_t value)
+{
+	uint8_t* regs = i2c_regs(address);
+	regs[reg + 0] = (uint8_t)((uint16_t)value >> 8);
+	regs[reg + 1] = (uint8_t)((uint16_t)value & 0xFF);
+}
+
+/**
+ * @brief Queues bytes to be read from FIFO port reg of device at address
+ *
+ * A full MPU6050 FIFO overwrites its oldest bytes, as on the sensor.
+ */
+void Sim::i2c_fifo_push(uint8_t address, uint8_t reg, const uint8_t* data, size_t size)
+{
+	std::deque<uint8_t>& fifo = i2c_fifos[((uint16_t)address << 8) | reg];
+	fifo.insert(fifo.end(), data, data + size);
+	if (address == mpu_address && reg == mpu_fifo_r_w && fifo.size() > mpu_fifo_size)
+	{
+		fifo.erase(fifo.begin(), fifo.end() - mpu_fifo_size);
+	}
+}
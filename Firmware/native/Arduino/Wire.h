@@ -0,0 +1,42 @@
+/**
+ * @file Wire.h
+ * @brief Linux stand-in for the Arduino I2C (Wire) library
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * Each 7-bit address maps to a 256-byte register file with an auto-incrementing
+ * register pointer, which is how the MPU6050 and most I2C sensors behave.
+ * Register files are accessed by host programs via Sim::i2c_regs(). Registers
+ * fed with Sim::i2c_fifo_push() act as FIFO ports: reads pop queued bytes and
+ * do not advance the register pointer.
+ */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Class Declaration
+ */
+class TwoWire
+{
+public:
+	void begin();
+	void end();
+	void setClock(uint32_t freq);
+	void beginTransmission(uint8_t address);
+	uint8_t endTransmission(bool stop = true);
+	uint8_t requestFrom(uint8_t address, uint8_t quantity, bool stop = true);
+	uint8_t requestFrom(int address, int quantity, int stop = 1);
+	size_t write(uint8_t byte);
+	size_t write(const uint8_t* buffer, size_t size);
+	int available();
+	int read();
+protected:
+	uint8_t address = 0;
+	bool reg_set = false;
+	uint8_t rx_buf[255];	// Holds any uint8_t quantity
+	uint8_t rx_len = 0;
+	uint8_t rx_pos = 0;
+};
+
+// Global I2C Bus
+extern TwoWire Wire;
@@ -0,0 +1,630 @@
+/**
+ * @file MonteCarlo.cpp
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#include <MonteCarlo.h>
+#include <Plant.h>
+#include <Sim.h>
+#include <Hal.h>
+#include <Protocol.h>
+#include <Bluetooth.h>
+#include <Imu.h>
+#include <Mpu.h>
+#include <Encoder.h>
+#include <MotorL.h>
+#include <MotorR.h>
+#include <MotorPwm.h>
+#include <MotorConfig.h>
+#include <Controller.h>
+#include <RateConfig.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/wait.h>
+using RateConfig::due;
+using RateConfig::frames_per_cycle;
+
+/**
+ * Namespace Definitions
+ */
+namespace MonteCarlo
+{
+	// Batch size
+#if defined(SIM_SCENARIOS)
+	const uint32_t num_scenarios = SIM_SCENARIOS;
+#else
+	const uint32_t num_scenarios = 1000;
+#endif
+#if defined(SIM_SECONDS)
+	const float t_run = SIM_SECONDS;
+#else
+	const float t_run = 6.0f;
+#endif
+	const float t_hold = 0.5f * t_run;	// Zero-command recovery phase [s]
+	const uint32_t seed_base = 1;
+
+	// Command profiles (after t_hold)
+	typedef enum
+	{
+		profile_hold = 0,	// Zero commands
+		profile_lin_step,	// Linear velocity step and back
+		profile_yaw_step,	// Yaw velocity step and back
+		profile_lin_sine,	// Linear velocity sine at 0.5 Hz
+		num_profiles,
+	}
+	profile_t;
+	const char* const profile_names[num_profiles] = {
+		"hold", "linear step", "yaw step", "linear sine",
+	};
+	const float cmd_period = 0.05f;		// Command frame period [s]
+
+	// Scenario spread (uniform +- fraction of nominal unless noted)
+	const float spread_mass = 0.10f;
+	const float spread_com = 0.15f;
+	const float spread_inertia = 0.20f;
+	const float spread_radius = 0.02f;
+	const float spread_motor = 0.10f;
+	const float spread_rotor = 0.30f;
+	const float Vb_min = 11.1f, Vb_max = 12.6f;			// Battery [V]
+	const float delay_min = 0.5e-3f, delay_max = 2.5e-3f;	// Actuation [s]
+	const float noise_min = 0.5f, noise_max = 2.0f;		// Noise scale
+	const float gyr_bias_std = 0.002f;		// Gyro bias std [rad/s]
+	const float acc_bias_std = 0.05f;		// Accel bias std [m/s^2]
+	const float imu_tilt_std = 0.01f;		// IMU tilt std [rad]
+	const float pitch0_max = 0.10f;			// Initial lean [rad]
+	const float pitch_vel0_max = 0.30f;		// Initial pitch velocity [rad/s]
+	const float push_max = 0.50f;			// Push [rad/s]
+	const float lin_cmd_max = 0.30f;		// Linear command [m/s]
+	const float yaw_cmd_max = 2.00f;		// Yaw command [rad/s]
+
+	// Outcome thresholds
+	const float tip_pitch = 0.8f;			// Fallen [rad] (Controller.cpp)
+	const float settle_pitch = 0.01f;		// Settled pitch band [rad]
+	const float settle_vel = 0.05f;			// Settled velocity band [m/s]
+	const float settle_window = 0.5f;		// Final mean window [s]
+	const float sat_fraction = 0.99f;		// Saturated voltage / Vb
+
+	// Margin search
+	const float margin_pitch0 = 0.05f;		// Initial lean [rad]
+	const float gain_max = 20.0f;			// Gain search range [x]
+	const float delay_extra_max = 0.1f;		// Delay search range [s]
+	const uint8_t margin_iterations = 10;
+
+	// Scenario
+	typedef struct
+	{
+		uint32_t index;
+		uint32_t seed;
+		Plant::params_t params;
+		float pitch0;			// Initial pitch [rad]
+		float pitch_vel0;		// Initial pitch velocity [rad/s]
+		profile_t profile;
+		float amplitude;		// Profile amplitude [m/s or rad/s]
+		float t_push;			// Push time [s]
+		float push;				// Push [rad/s]
+	}
+	scenario_t;
+
+	// Outcome
+	typedef struct
+	{
+		bool valid;				// Child reported back
+		bool tipped;
+		float t_tip;			// Tip-over time [s]
+		bool settled;			// Settled within hold phase
+		float t_settle;			// Settling time [s]
+		float pitch_rms;		// Pitch about mean after t_hold [rad]
+		float lin_rms;			// Linear velocity error after t_hold [m/s]
+		float yaw_rms;			// Yaw velocity error after t_hold [rad/s]
+		float sat;				// Steps with saturated voltage [fraction]
+	}
+	result_t;
+
+	// Private functions
+	scenario_t make_scenario(uint32_t index);
+	scenario_t margin_scenario(float act_gain, float act_delay);
+	void get_cmds(const scenario_t& sc, float t, float& lin, float& yaw);
+	void simulate(const scenario_t& sc, result_t& res, bool trace);
+	void run_batch(const scenario_t* scenarios, result_t* results, uint32_t count);
+	bool is_stable(const result_t& res);
+	void find_margins();
+	float percentile(std::vector<float>& values, float p);
+	void report(const std::vector<scenario_t>& scenarios,
+		const std::vector<result_t>& results, float t_wall);
+}
+
+/**
+ * @brief Runs scenario batch and margin search and prints a summary
+ */
+void MonteCarlo::run()
+{
+	printf("SIM_MONTE_CARLO\n");
+	Sim::clock_manual(true);
+
+	// Replay one scenario
+	const char* trace_env = getenv("BALBOT_SIM_TRACE");
+	if (trace_env)
+	{
+		result_t res;
+		simulate(make_scenario(atol(trace_env)), res, true);
+		return;
+	}
+
+	// Run batch
+	std::vector<scenario_t> scenarios(num_scenarios);
+	std::vector<result_t> results(num_scenarios);
+	for (uint32_t i = 0; i < num_scenarios; i++)
+	{
+		scenarios[i] = make_scenario(i);
+	}
+	using namespace std::chrono;
+	const steady_clock::time_point t_start = steady_clock::now();
+	run_batch(scenarios.data(), results.data(), num_scenarios);
+	const float t_wall = duration<float>(steady_clock::now() - t_start).count();
+	report(scenarios, results, t_wall);
+	find_margins();
+}
+
+/**
+ * @brief Draws scenario from its index
+ */
+MonteCarlo::scenario_t MonteCarlo::make_scenario(uint32_t index)
+{
+	std::mt19937 rng(seed_base + index);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::normal_distribution<float> normal(0.0f, 1.0f);
+	auto spread = [&](float nominal, float fraction)
+	{
+		return nominal * (1.0f + fraction * unit(rng));
+	};
+	auto between = [&](float lo, float hi)
+	{
+		return lo + (hi - lo) * 0.5f * (unit(rng) + 1.0f);
+	};
+
+	scenario_t sc;
+	sc.index = index;
+	sc.seed = rng();
+	Plant::params_t& p = sc.params;
+	p = Plant::nominal();
+	p.M = spread(p.M, spread_mass);
+	p.l = spread(p.l, spread_com);
+	p.Ib = spread(p.Ib, spread_inertia);
+	p.Iz = spread(p.Iz, spread_inertia);
+	p.r = spread(p.r, spread_radius);
+	p.R = spread(p.R, spread_motor);
+	p.Kv = spread(p.Kv, spread_motor);
+	p.Kt = spread(p.Kt, spread_motor);
+	p.J_rotor = spread(p.J_rotor, spread_rotor);
+	p.Vb = between(Vb_min, Vb_max);
+	p.act_delay = between(delay_min, delay_max);
+	p.noise_scale = between(noise_min, noise_max);
+	p.gyr_bias = gyr_bias_std * normal(rng);
+	p.acc_bias = acc_bias_std * normal(rng);
+	p.imu_tilt = imu_tilt_std * normal(rng);
+	sc.pitch0 = pitch0_max * unit(rng);
+	sc.pitch_vel0 = pitch_vel0_max * unit(rng);
+	sc.profile = (profile_t)(index % num_profiles);
+	sc.amplitude = unit(rng) * ((sc.profile == profile_yaw_step) ? yaw_cmd_max : lin_cmd_max);
+	sc.t_push = between(t_hold, t_run - 1.0f);
+	sc.push = push_max * unit(rng);
+	return sc;
+}
+
+/**
+ * @brief Returns noiseless nominal scenario with given actuator gain and delay
+ * 
+ * IMU_BOOT_CAL keeps the nominal (seeded) noise, since the firmware estimates
+ * its sensor variances from it.
+ */
+MonteCarlo::scenario_t MonteCarlo::margin_scenario(float act_gain, float act_delay)
+{
+	scenario_t sc;
+	sc.index = 0;
+	sc.seed = seed_base;
+	sc.params = Plant::nominal();
+#if !defined(IMU_BOOT_CAL)
+	sc.params.noise_scale = 0.0f;
+#endif
+	sc.params.act_gain = act_gain;
+	sc.params.act_delay = act_delay;
+	sc.pitch0 = margin_pitch0;
+	sc.pitch_vel0 = 0.0f;
+	sc.profile = profile_hold;
+	sc.amplitude = 0.0f;
+	sc.t_push = t_run;
+	sc.push = 0.0f;
+	return sc;
+}
+
+/**
+ * @brief Returns profile commands at time t [m/s, rad/s]
+ */
+void MonteCarlo::get_cmds(const scenario_t& sc, float t, float& lin, float& yaw)
+{
+	lin = 0.0f;
+	yaw = 0.0f;
+	if (t < t_hold) return;
+	const bool first_half = (t - t_hold) < 0.5f * (t_run - t_hold);
+	switch (sc.profile)
+	{
+		case profile_lin_step: if (first_half) lin = sc.amplitude; break;
+		case profile_yaw_step: if (first_half) yaw = sc.amplitude; break;
+		case profile_lin_sine: lin = sc.amplitude * sinf(M_PI * (t - t_hold)); break;
+		default: break;
+	}
+}
+
+/**
+ * @brief Runs scenario against the firmware (once per process)
+ *
+ * Each step is one Scheduler frame and mirrors loop(): background serial
+ * writes, then the rate groups due in that frame, with commands parsed in the
+ * comms group. Mpu::init() is rerun after the plant is placed so its first
+ * frame reads the initial attitude. With IMU_BOOT_CAL the plant is held at its
+ * initial pitch until the boot calibration is ready, then released with its
+ * initial pitch velocity.
+ */
+void MonteCarlo::simulate(const scenario_t& sc, result_t& res, bool trace)
+{
+	// Place plant
+	Sim::serial_capture(true);
+	const Plant::state_t x0 = {0.0f, 0.0f, sc.pitch0, sc.pitch_vel0, 0.0f, 0.0f};
+	Plant::init(sc.params, x0, sc.seed);
+	Mpu::init();
+
+	// Step counts (one step per Scheduler frame)
+	const float f_frame = RateConfig::f_frame;
+	const uint32_t t_frame_us = (uint32_t)lroundf(1.0e6f / f_frame);
+	const uint32_t steps = (uint32_t)(t_run * f_frame);
+	const uint32_t hold_steps = (uint32_t)(t_hold * f_frame);
+	const uint32_t cmd_steps = (uint32_t)lroundf(cmd_period * f_frame);
+	const uint32_t push_step = (uint32_t)(sc.t_push * f_frame);
+	const uint32_t window_steps = (uint32_t)(settle_window * f_frame);
+
+#if defined(IMU_BOOT_CAL)
+
+	// Hold until the boot calibration is ready
+	Plant::hold(true);
+	for (uint32_t k = 0; !Imu::is_calibrated(); k++)
+	{
+		Plant::advance(t_frame_us);
+		if (due(RateConfig::group_sense, k % frames_per_cycle)) Imu::update();
+	}
+	Plant::hold(false);
+	Plant::push(sc.pitch_vel0);
+
+#endif
+
+	// Outcome accumulators
+	res = {true, false, 0.0f, false, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+	std::vector<float> hold_pitch, hold_vel;
+	float pitch_sum = 0.0f, pitch_sq = 0.0f, lin_sq = 0.0f, yaw_sq = 0.0f;
+	uint32_t sat_steps = 0, run_steps = 0;
+	uint8_t seq = 0;
+
+	if (trace)
+	{
+		printf("t,pitch,pitch_est,pitch_vel,lin_vel,lin_vel_est,yaw_vel,"
+			"lin_vel_cmd,yaw_vel_cmd,volts_L,volts_R\n");
+	}
+	for (uint32_t k = 0; k < steps; k++)
+	{
+		const float t = k / f_frame;
+		const uint16_t frame = k % frames_per_cycle;
+
+		// Plant and disturbances
+		Plant::advance(t_frame_us);
+		if (k == push_step) Plant::push(sc.push);
+		if (k % cmd_steps == 0)
+		{
+			float cmds[2];
+			get_cmds(sc, t, cmds[0], cmds[1]);
+			uint8_t frame[Protocol::max_frame];
+			const uint8_t size = Protocol::encode(frame,
+				Protocol::id_cmd_vel, seq++, cmds, sizeof(cmds));
+			Sim::serial_rx(frame, size);
+		}
+
+		// Firmware frame
+		Bluetooth::drain();
+		uint8_t tx[64];
+		while (Sim::serial_tx(tx, sizeof(tx)) > 0);
+		if (due(RateConfig::group_sense, frame))
+		{
+			Imu::update();
+			Encoder::update();
+			MotorL::update();
+			MotorR::update();
+		}
+		if (due(RateConfig::group_yaw, frame))
+		{
+			Controller::update_yaw();
+		}
+		if (due(RateConfig::group_balance, frame))
+		{
+			Controller::update_balance();
+#if defined(BALBOT_FIXED_POINT)
+			MotorPwm::set_voltages_q16(
+				Controller::get_motor_L_cmd_q16(), Controller::get_motor_R_cmd_q16());
+#else
+			MotorPwm::set_voltages(
+				Controller::get_motor_L_cmd(), Controller::get_motor_R_cmd());
+#endif
+		}
+		if (due(RateConfig::group_comms, frame))
+		{
+			Bluetooth::update();
+		}
+
+		// Outcome
+		const Plant::state_t& s = Plant::get_state();
+		const float lin_cmd = Bluetooth::get_lin_vel_cmd();
+		const float yaw_cmd = Bluetooth::get_yaw_vel_cmd();
+		if (trace)
+		{
+			printf("%.3f,%.5f,%.5f,%.4f,%.4f,%.4f,%.4f,%.3f,%.3f,%.3f,%.3f\n",
+				t, s.pitch, Imu::get_pitch(), s.pitch_dot, s.x_dot,
+				Controller::get_lin_vel(), s.yaw_dot, lin_cmd, yaw_cmd,
+				Plant::get_volts_L(), Plant::get_volts_R());
+		}
+		if (Controller::is_tipped() || fabsf(s.pitch) > tip_pitch)
+		{
+			res.tipped = true;
+			res.t_tip = t;
+			break;
+		}
+		const float v_max = sat_fraction * MotorConfig::Vb;
+		if (fabsf(Controller::get_motor_L_cmd()) >= v_max ||
+			fabsf(Controller::get_motor_R_cmd()) >= v_max) sat_steps++;
+		run_steps++;
+		if (k < hold_steps)
+		{
+			hold_pitch.push_back(s.pitch);
+			hold_vel.push_back(s.x_dot);
+		}
+		else
+		{
+			pitch_sum += s.pitch;
+			pitch_sq += s.pitch * s.pitch;
+			lin_sq += (lin_cmd - s.x_dot) * (lin_cmd - s.x_dot);
+			yaw_sq += (yaw_cmd - s.yaw_dot) * (yaw_cmd - s.yaw_dot);
+		}
+	}
+	res.sat = run_steps ? (float)sat_steps / run_steps : 0.0f;
+	if (res.tipped) return;
+
+	// Settling: last step outside the bands about the final mean pitch
+	float pitch_final = 0.0f;
+	for (uint32_t k = hold_steps - window_steps; k < hold_steps; k++)
+	{
+		pitch_final += hold_pitch[k] / window_steps;
+	}
+	uint32_t k_settle = 0;
+	for (uint32_t k = 0; k < hold_steps; k++)
+	{
+		if (fabsf(hold_pitch[k] - pitch_final) > settle_pitch ||
+			fabsf(hold_vel[k]) > settle_vel) k_settle = k + 1;
+	}
+	res.settled = (k_settle + window_steps <= hold_steps);
+	res.t_settle = k_settle / f_frame;
+
+	// Profile phase errors
+	const uint32_t n = steps - hold_steps;
+	const float pitch_mean = pitch_sum / n;
+	res.pitch_rms = sqrtf(fmaxf(pitch_sq / n - pitch_mean * pitch_mean, 0.0f));
+	res.lin_rms = sqrtf(lin_sq / n);
+	res.yaw_rms = sqrtf(yaw_sq / n);
+}
+
+/**
+ * @brief Runs each scenario in its own child process, one per core at a time
+ *
+ * Children start from the initialized firmware and report over a pipe. A
+ * child which exits without reporting (such as a firmware halt) leaves its
+ * result marked invalid.
+ */
+void MonteCarlo::run_batch(const scenario_t* scenarios, result_t* results, uint32_t count)
+{
+	typedef struct
+	{
+		pid_t pid;
+		int fd;
+		uint32_t index;
+	}
+	child_t;
+	const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	const size_t workers = (cores > 0) ? (size_t)cores : 1;
+	std::vector<child_t> children;
+	uint32_t next = 0, done = 0;
+	while (done < count)
+	{
+		// Start children
+		while (next < count && children.size() < workers)
+		{
+			int fds[2];
+			if (pipe(fds) != 0) break;
+			fflush(stdout);
+			const pid_t pid = fork();
+			if (pid == 0)
+			{
+				close(fds[0]);
+				result_t res;
+				simulate(scenarios[next], res, false);
+				const ssize_t written = write(fds[1], &res, sizeof(res));
+				_exit(written == (ssize_t)sizeof(res) ? 0 : 1);
+			}
+			close(fds[1]);
+			results[next].valid = false;
+			children.push_back({pid, fds[0], next++});
+		}
+
+		// Collect one child
+		int status;
+		const pid_t pid = waitpid(-1, &status, 0);
+		if (pid < 0) break;
+		for (size_t i = 0; i < children.size(); i++)
+		{
+			if (children[i].pid != pid) continue;
+			result_t& res = results[children[i].index];
+			if (read(children[i].fd, &res, sizeof(res)) != (ssize_t)sizeof(res))
+			{
+				res.valid = false;
+			}
+			close(children[i].fd);
+			children.erase(children.begin() + i);
+			done++;
+			break;
+		}
+	}
+}
+
+/**
+ * @brief Returns true if the run stayed up and settled
+ */
+bool MonteCarlo::is_stable(const result_t& res)
+{
+	return res.valid && !res.tipped && res.settled;
+}
+
+/**
+ * @brief Bisects actuator gain and delay of the noiseless nominal plant for
+ * the largest change which still settles, and prints the margins
+ *
+ * The three searches advance together, one child each per iteration.
+ */
+void MonteCarlo::find_margins()
+{
+	printf("Stability margins (nominal plant, %.2f rad lean):\n", margin_pitch0);
+	const float delay = Plant::nominal().act_delay;
+	scenario_t scenarios[3];
+	result_t results[3];
+	scenarios[0] = margin_scenario(1.0f, delay);
+	run_batch(scenarios, results, 1);
+	if (!is_stable(results[0]))
+	{
+		printf("  Nominal closed loop does not settle, so no margins\n");
+		return;
+	}
+
+	// Brackets [stable, unstable]
+	float gain_up[2] = {1.0f, gain_max};
+	float gain_down[2] = {1.0f, 1.0f / gain_max};
+	float delay_up[2] = {0.0f, delay_extra_max};
+	for (uint8_t i = 0; i < margin_iterations; i++)
+	{
+		const float gain_up_mid = sqrtf(gain_up[0] * gain_up[1]);
+		const float gain_down_mid = sqrtf(gain_down[0] * gain_down[1]);
+		const float delay_mid = 0.5f * (delay_up[0] + delay_up[1]);
+		scenarios[0] = margin_scenario(gain_up_mid, delay);
+		scenarios[1] = margin_scenario(gain_down_mid, delay);
+		scenarios[2] = margin_scenario(1.0f, delay + delay_mid);
+		run_batch(scenarios, results, 3);
+		gain_up[is_stable(results[0]) ? 0 : 1] = gain_up_mid;
+		gain_down[is_stable(results[1]) ? 0 : 1] = gain_down_mid;
+		delay_up[is_stable(results[2]) ? 0 : 1] = delay_mid;
+	}
+	printf("  Gain margin: x%.2f to x%.2f (%.1f dB, +%.1f dB)%s\n",
+		gain_down[0], gain_up[0], 20.0f * log10f(gain_down[0]),
+		20.0f * log10f(gain_up[0]), (gain_up[0] > 0.9f * gain_max) ? " (search limit)" : "");
+	printf("  Delay margin: %.1f ms beyond %.1f ms\n", 1e3f * delay_up[0], 1e3f * delay);
+}
+
+/**
+ * @brief Returns p-th percentile [0, 1] of values (sorts values)
+ */
+float MonteCarlo::percentile(std::vector<float>& values, float p)
+{
+	if (values.empty()) return NAN;
+	std::sort(values.begin(), values.end());
+	return values[(size_t)(p * (values.size() - 1) + 0.5f)];
+}
+
+/**
+ * @brief Prints batch summary
+ */
+void MonteCarlo::report(const std::vector<scenario_t>& scenarios,
+	const std::vector<result_t>& results, float t_wall)
+{
+	// Collect outcomes
+	uint32_t invalid = 0, tipped = 0, settled = 0;
+	uint32_t tip_by_profile[num_profiles] = {0};
+	uint32_t runs_by_profile[num_profiles] = {0};
+	std::vector<float> t_tip, t_settle, pitch_rms, lin_rms, yaw_rms, sat;
+	std::vector<uint32_t> worst;
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const result_t& res = results[i];
+		if (!res.valid)
+		{
+			invalid++;
+			continue;
+		}
+		runs_by_profile[scenarios[i].profile]++;
+		sat.push_back(100.0f * res.sat);
+		if (res.tipped)
+		{
+			tipped++;
+			tip_by_profile[scenarios[i].profile]++;
+			t_tip.push_back(res.t_tip);
+			worst.push_back(i);
+			continue;
+		}
+		if (res.settled)
+		{
+			settled++;
+			t_settle.push_back(res.t_settle);
+		}
+		pitch_rms.push_back(1e3f * res.pitch_rms);
+		lin_rms.push_back(res.lin_rms);
+		yaw_rms.push_back(res.yaw_rms);
+	}
+	const uint32_t valid = results.size() - invalid;
+	const uint32_t upright = valid - tipped;
+
+	// Batch
+	const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	printf("Scenarios: %u x %.1f s on %ld workers\n", (unsigned)results.size(), t_run, cores);
+	printf("Wall time: %.2f s (%.0fx real time)\n", t_wall, results.size() * t_run / t_wall);
+	if (invalid) printf("Failed runs: %u\n", invalid);
+
+	// Tip-over
+	printf("Tip-overs: %u of %u (%.1f%%), median at %.2f s\n",
+		tipped, valid, valid ? 100.0f * tipped / valid : 0.0f, percentile(t_tip, 0.5f));
+	for (uint8_t p = 0; p < num_profiles; p++)
+	{
+		printf("  %-12s %u of %u\n", profile_names[p], tip_by_profile[p], runs_by_profile[p]);
+	}
+
+	// Upright runs
+	printf("Settled: %u of %u upright, settling time p50 %.2f s  p90 %.2f s  max %.2f s\n",
+		settled, upright, percentile(t_settle, 0.5f), percentile(t_settle, 0.9f),
+		percentile(t_settle, 1.0f));
+	printf("Pitch RMS [mrad]: p50 %.2f  p90 %.2f\n",
+		percentile(pitch_rms, 0.5f), percentile(pitch_rms, 0.9f));
+	printf("Linear velocity error RMS [m/s]: p50 %.3f  p90 %.3f\n",
+		percentile(lin_rms, 0.5f), percentile(lin_rms, 0.9f));
+	printf("Yaw velocity error RMS [rad/s]: p50 %.3f  p90 %.3f\n",
+		percentile(yaw_rms, 0.5f), percentile(yaw_rms, 0.9f));
+	printf("Saturated steps [%%]: p50 %.1f  p90 %.1f\n",
+		percentile(sat, 0.5f), percentile(sat, 0.9f));
+
+	// Fastest falls
+	std::sort(worst.begin(), worst.end(), [&](uint32_t a, uint32_t b)
+	{
+		return results[a].t_tip < results[b].t_tip;
+	});
+	if (!worst.empty()) printf("Fastest tip-overs (replay with BALBOT_SIM_TRACE=<index>):\n");
+	for (size_t i = 0; i < worst.size() && i < 5; i++)
+	{
+		const scenario_t& sc = scenarios[worst[i]];
+		printf("  %u: %.2f s, %s, lean %+.3f rad, Vb %.1f V, delay %.1f ms, "
+			"l %.3f m, noise x%.1f\n",
+			sc.index, results[worst[i]].t_tip, profile_names[sc.profile], sc.pitch0,
+			sc.params.Vb, 1e3f * sc.params.act_delay, sc.params.l, sc.params.noise_scale);
+	}
+	fflush(stdout);
+}
@@ -0,0 +1,28 @@
+/**
+ * @file MonteCarlo.h
+ * @brief Batch software-in-the-loop simulation of the balancing controller
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * Runs the firmware's own Imu, MotorL, MotorR, Controller, and Bluetooth code
+ * against the Plant model on the manual clock, so a run takes milliseconds
+ * instead of seconds. Each scenario draws plant parameters, sensor noise and
+ * offsets, an initial lean, a push, and a command profile (sent as cmd_vel
+ * frames over the serial stand-in) from a seeded generator.
+ *
+ * The subsystems keep their state in namespace globals, so every scenario runs
+ * in a child process forked from the initialized firmware, with one child per
+ * core at a time. After the batch, the nominal plant's gain and delay margins
+ * are found by bisection on the actuator gain and delay.
+ *
+ * Set BALBOT_SIM_TRACE to a scenario index to rerun only that scenario and
+ * print its trajectory as CSV.
+ */
+#pragma once
+
+/**
+ * Namespace Declaration
+ */
+namespace MonteCarlo
+{
+	void run();
+}
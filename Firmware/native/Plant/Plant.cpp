@@ -0,0 +1,471 @@
+/**
+ * @file Plant.cpp
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#include <Plant.h>
+#include <Sim.h>
+#include <MotorConfig.h>
+#include <ModelConfig.h>
+#include <ImuConfig.h>
+#include <Mpu.h>
+#include <Arduino.h>
+#include <deque>
+#include <random>
+
+/**
+ * Namespace Definitions
+ */
+namespace Plant
+{
+	// Board wiring [MotorL.cpp, MotorR.cpp, Encoder.cpp, Mpu.cpp]
+	const uint8_t pin_pwm_L = 9, pin_fwd_L = 6, pin_rev_L = 7;
+	const uint8_t pin_pwm_R = 10, pin_fwd_R = 12, pin_rev_R = 13;
+	const uint8_t pin_enc_a[2] = {2, 5};
+	const uint8_t pin_enc_b[2] = {3, 4};
+	const uint8_t mpu_address = 0x68;
+	const uint8_t mpu_pin_int = 11;
+	const uint8_t mpu_reg_data = 0x3B;
+	const uint8_t mpu_reg_fifo = 0x74;
+	const uint8_t mpu_reg_int_pin_cfg = 0x37;
+	const uint8_t mpu_latch_int_en = 0x20;
+
+	// MPU6050 sampling [Mpu.cpp]
+#if defined(MPU6050_SMPLRT_DIV)
+	const uint32_t mpu_sample_us = 1000ul * (1 + MPU6050_SMPLRT_DIV);
+#else
+	const uint32_t mpu_sample_us = 2000;
+#endif
+#if defined(MPU6050_DLPF_CFG)
+	const uint8_t dlpf_cfg = MPU6050_DLPF_CFG;
+#else
+	const uint8_t dlpf_cfg = 2;
+#endif
+	const float dlpf_bw[7] = {260.0f, 184.0f, 94.0f, 44.0f, 21.0f, 10.0f, 5.0f};	// [Hz]
+
+	// Integration
+	const uint32_t dt_us = 100;			// Substep [us]
+	const float g = 9.81f;				// Gravity [m/s^2]
+
+	// Model
+	params_t p;
+	state_t s;
+	float x_ddot = 0.0f;				// Axle acceleration [m/s^2]
+	float pitch_ddot = 0.0f;			// Pitch acceleration [rad/s^2]
+	bool held = false;					// Body held still by hand
+
+	// Motor voltages [V, wheel frame]
+	typedef struct
+	{
+		uint32_t t_apply;				// Time to apply [us]
+		float volts[2];					// Voltages L, R [V]
+	}
+	volts_t;
+	std::deque<volts_t> volts_queue;	// Commanded, not yet applied
+	float volts_cmd[2] = {0.0f, 0.0f};	// Latest commanded
+	float volts[2] = {0.0f, 0.0f};		// Applied
+
+	// Encoders
+	float rad_per_cnt;					// Encoder angle per count [rad/cnt]
+	float enc_pos[2];					// Continuous position [cnt]
+	int32_t enc_offset[2];				// Count at init [cnt]
+	int32_t enc_count[2];				// Count driven onto pins [cnt]
+
+	// IMU
+	std::mt19937 rng;
+	std::normal_distribution<float> normal(0.0f, 1.0f);
+	float imu_lpf[6];					// Filtered acc XYZ, gyr XYZ
+	float imu_std[6];					// Per-sample noise std
+	uint32_t t_sample;					// Time of next sample [us]
+
+	// Private functions
+	state_t add(const state_t& x, const state_t& dx, float h);
+	void derivs(const state_t& x, state_t& dx, float& ddx, float& ddp);
+	void wheel_torques(const state_t& x, float& tau_L, float& tau_R);
+	void sample_pins();
+	void drive_encoders(uint32_t t_start, uint32_t t_step);
+	void enc_positions(float* pos);
+	void imu_signals(float* out);
+	void imu_sample();
+	int16_t to_raw(uint8_t axis, float value);
+}
+
+/**
+ * @brief Returns nominal parameters
+ *
+ * Motor constants come from MotorConfig, body and wheel values from
+ * ModelConfig, and noise from ImuConfig.
+ */
+Plant::params_t Plant::nominal()
+{
+	params_t n;
+	n.M = ModelConfig::M;
+	n.l = ModelConfig::l;
+	n.Ib = ModelConfig::Ib;
+	n.Iz = ModelConfig::Iz;
+	n.m = ModelConfig::m;
+	n.r = ModelConfig::r;
+	n.d = ModelConfig::d;
+	n.h_imu = ModelConfig::h_imu;
+	n.Vb = MotorConfig::Vb;
+	n.R = MotorConfig::R;
+	n.Kv = MotorConfig::Kv;
+	n.Kt = MotorConfig::Kt;
+	n.J_rotor = ModelConfig::J_rotor;
+	n.b = ModelConfig::b;
+	n.act_gain = 1.0f;
+	n.act_delay = 1.0e-3f;
+	n.noise_scale = 1.0f;
+	n.gyr_bias = 0.0f;
+	n.acc_bias = 0.0f;
+	n.imu_tilt = 0.0f;
+	return n;
+}
+
+/**
+ * @brief Sets parameters and initial state and drives sensors to match
+ *
+ * Call with the manual clock running, after the firmware has initialized.
+ * Encoder pins restart at the firmware's latched state, and the MPU data
+ * registers are written so Mpu::init() reads the initial attitude.
+ */
+void Plant::init(const params_t& params, const state_t& state, uint32_t seed)
+{
+	p = params;
+	s = state;
+	x_ddot = 0.0f;
+	pitch_ddot = 0.0f;
+	held = false;
+	rng.seed(seed);
+	volts_queue.clear();
+	for (uint8_t i = 0; i < 2; i++)
+	{
+		volts_cmd[i] = 0.0f;
+		volts[i] = 0.0f;
+	}
+
+	// Encoders
+	rad_per_cnt = 2.0f * M_PI / MotorConfig::enc_cpr;
+	enc_positions(enc_pos);
+	for (uint8_t i = 0; i < 2; i++)
+	{
+		enc_offset[i] = (int32_t)floorf(enc_pos[i]);
+		enc_count[i] = enc_offset[i];
+		Sim::set_pin(pin_enc_a[i], false);
+		Sim::set_pin(pin_enc_b[i], false);
+	}
+
+	// IMU noise averaged at the ImuConfig calibration rate matches ImuConfig
+	const float n_avg = (1.0e6f / mpu_sample_us) / ImuConfig::f_cal;
+	const float vars[6] = {
+		ImuConfig::acc_x_var, ImuConfig::acc_y_var, ImuConfig::acc_z_var,
+		ImuConfig::gyr_x_var, ImuConfig::gyr_y_var, ImuConfig::gyr_z_var,
+	};
+	for (uint8_t i = 0; i < 6; i++)
+	{
+		imu_std[i] = p.noise_scale * sqrtf(vars[i] * n_avg);
+	}
+	imu_signals(imu_lpf);
+	for (uint8_t i = 0; i < 6; i++)
+	{
+		const uint8_t reg = mpu_reg_data + 2 * i + (i >= 3 ? 2 : 0);
+		Sim::write_reg16(mpu_address, reg, to_raw(i, imu_lpf[i]));
+	}
+	t_sample = micros() + mpu_sample_us;
+}
+
+/**
+ * @brief Advances model and clock by us, emitting sensor events on the way
+ */
+void Plant::advance(uint32_t us)
+{
+	const float lpf_a = 1.0f - expf(-2.0f * M_PI * dlpf_bw[dlpf_cfg] * dt_us * 1e-6f);
+	while (us > 0)
+	{
+		const uint32_t t_start = micros();
+		const uint32_t t_step = (us < dt_us) ? us : dt_us;
+		const float dt = t_step * 1e-6f;
+		sample_pins();
+
+		// Integrate (RK4)
+		if (!held)
+		{
+			state_t k1, k2, k3, k4;
+			float ddx, ddp;
+			derivs(s, k1, x_ddot, pitch_ddot);
+			derivs(add(s, k1, 0.5f * dt), k2, ddx, ddp);
+			derivs(add(s, k2, 0.5f * dt), k3, ddx, ddp);
+			derivs(add(s, k3, dt), k4, ddx, ddp);
+			s = add(s, k1, dt / 6.0f);
+			s = add(s, k2, dt / 3.0f);
+			s = add(s, k3, dt / 3.0f);
+			s = add(s, k4, dt / 6.0f);
+		}
+
+		// Sensors
+		drive_encoders(t_start, t_step);
+		float imu[6];
+		imu_signals(imu);
+		for (uint8_t i = 0; i < 6; i++)
+		{
+			imu_lpf[i] += lpf_a * (imu[i] - imu_lpf[i]);
+		}
+		if ((int32_t)(micros() - t_sample) >= 0)
+		{
+			imu_sample();
+			t_sample += mpu_sample_us;
+		}
+		us -= t_step;
+	}
+}
+
+/**
+ * @brief Holds the body still or releases it
+ * 
+ * While held, the state is frozen at rest and only the sensors run, like a
+ * robot held by hand while it calibrates.
+ */
+void Plant::hold(bool hold)
+{
+	held = hold;
+	if (held)
+	{
+		s.x_dot = 0.0f;
+		s.pitch_dot = 0.0f;
+		s.yaw_dot = 0.0f;
+		x_ddot = 0.0f;
+		pitch_ddot = 0.0f;
+	}
+}
+
+/**
+ * @brief Adds pitch velocity impulse (a push) [rad/s]
+ */
+void Plant::push(float pitch_dot)
+{
+	s.pitch_dot += pitch_dot;
+}
+
+/**
+ * @brief Returns true state
+ */
+const Plant::state_t& Plant::get_state()
+{
+	return s;
+}
+
+/**
+ * @brief Returns applied left motor voltage [V]
+ */
+float Plant::get_volts_L()
+{
+	return volts[0];
+}
+
+/**
+ * @brief Returns applied right motor voltage [V]
+ */
+float Plant::get_volts_R()
+{
+	return volts[1];
+}
+
+/**
+ * @brief Returns x + h * dx
+ */
+Plant::state_t Plant::add(const state_t& x, const state_t& dx, float h)
+{
+	return {
+		x.x + h * dx.x, x.x_dot + h * dx.x_dot,
+		x.pitch + h * dx.pitch, x.pitch_dot + h * dx.pitch_dot,
+		x.yaw + h * dx.yaw, x.yaw_dot + h * dx.yaw_dot,
+	};
+}
+
+/**
+ * @brief Computes state derivative and accelerations
+ *
+ * Lagrangian model in axle travel and pitch with rotor inertia on the
+ * wheel-to-body angle, plus a decoupled yaw axis.
+ */
+void Plant::derivs(const state_t& x, state_t& dx, float& ddx, float& ddp)
+{
+	float tau_L, tau_R;
+	wheel_torques(x, tau_L, tau_R);
+	const float tau = tau_L + tau_R;
+	const float Iw = 0.5f * p.m * p.r * p.r;
+	const float Jr = p.J_rotor * MotorConfig::tr * MotorConfig::tr;
+	const float c = cosf(x.pitch);
+	const float sn = sinf(x.pitch);
+
+	// [M11 -M12; -M12 M22] [ddx; ddp] = [f1; f2]
+	const float M11 = p.M + 2.0f * (p.m + (Iw + Jr) / (p.r * p.r));
+	const float M12 = p.M * p.l * c - 2.0f * Jr / p.r;
+	const float M22 = p.Ib + p.M * p.l * p.l + 2.0f * Jr;
+	const float f1 = tau / p.r - p.M * p.l * sn * x.pitch_dot * x.pitch_dot;
+	const float f2 = tau + p.M * g * p.l * sn;
+	const float det = M11 * M22 - M12 * M12;
+	ddx = (M22 * f1 + M12 * f2) / det;
+	ddp = (M12 * f1 + M11 * f2) / det;
+
+	// Yaw
+	const float Iz = p.Iz + 2.0f * p.d * p.d * (p.m + (Iw + Jr) / (p.r * p.r));
+	dx.x = x.x_dot;
+	dx.x_dot = ddx;
+	dx.pitch = x.pitch_dot;
+	dx.pitch_dot = ddp;
+	dx.yaw = x.yaw_dot;
+	dx.yaw_dot = p.d / p.r * (tau_R - tau_L) / Iz;
+}
+
+/**
+ * @brief Computes motor torques at the wheels [N*m]
+ */
+void Plant::wheel_torques(const state_t& x, float& tau_L, float& tau_R)
+{
+	const float w_L = (x.x_dot - p.d * x.yaw_dot) / p.r + x.pitch_dot;
+	const float w_R = (x.x_dot + p.d * x.yaw_dot) / p.r + x.pitch_dot;
+	tau_L = p.Kt * (volts[0] - p.Kv * w_L) / p.R - p.b * w_L;
+	tau_R = p.Kt * (volts[1] - p.Kv * w_R) / p.R - p.b * w_R;
+}
+
+/**
+ * @brief Reads H-bridge pins and applies voltages after act_delay
+ */
+void Plant::sample_pins()
+{
+	const float gain = MotorConfig::direction * p.act_gain * p.Vb;
+	const float dir_L = Sim::get_pin(pin_fwd_L) ? 1.0f : (Sim::get_pin(pin_rev_L) ? -1.0f : 0.0f);
+	const float dir_R = Sim::get_pin(pin_fwd_R) ? 1.0f : (Sim::get_pin(pin_rev_R) ? -1.0f : 0.0f);
+	const float cmd_L = gain * dir_L * Sim::get_pwm(pin_pwm_L);
+	const float cmd_R = gain * dir_R * Sim::get_pwm(pin_pwm_R);
+	const uint32_t t = micros();
+	if (cmd_L != volts_cmd[0] || cmd_R != volts_cmd[1])
+	{
+		volts_cmd[0] = cmd_L;
+		volts_cmd[1] = cmd_R;
+		volts_queue.push_back({t + (uint32_t)(p.act_delay * 1e6f), {cmd_L, cmd_R}});
+	}
+	while (!volts_queue.empty() && (int32_t)(t - volts_queue.front().t_apply) >= 0)
+	{
+		volts[0] = volts_queue.front().volts[0];
+		volts[1] = volts_queue.front().volts[1];
+		volts_queue.pop_front();
+	}
+}
+
+/**
+ * @brief Steps encoder pins to the new wheel angles
+ *
+ * Edges of both wheels are emitted in time order, each at the interpolated
+ * time its count boundary was crossed, so the edge ISRs latch realistic
+ * timestamps.
+ */
+void Plant::drive_encoders(uint32_t t_start, uint32_t t_step)
+{
+	static const uint8_t quadrature[4] = {0, 2, 3, 1};	// Count to A << 1 | B
+	float pos_end[2];
+	enc_positions(pos_end);
+	while (true)
+	{
+		// Find earliest pending edge
+		int8_t next = -1;
+		float frac_next = 1.0f;
+		for (uint8_t i = 0; i < 2; i++)
+		{
+			const int32_t target = (int32_t)floorf(pos_end[i]);
+			if (target == enc_count[i]) continue;
+			const float boundary = enc_count[i] + (target > enc_count[i] ? 1 : 0);
+			const float frac = (boundary - enc_pos[i]) / (pos_end[i] - enc_pos[i]);
+			if (next < 0 || frac < frac_next)
+			{
+				next = i;
+				frac_next = frac;
+			}
+		}
+		if (next < 0) break;
+
+		// Emit edge
+		const uint32_t t_edge = t_start + (uint32_t)(fmaxf(frac_next, 0.0f) * t_step);
+		if ((int32_t)(t_edge - micros()) > 0) Sim::clock_advance(t_edge - micros());
+		enc_count[next] += ((int32_t)floorf(pos_end[next]) > enc_count[next]) ? 1 : -1;
+		const uint8_t state = quadrature[(enc_count[next] - enc_offset[next]) & 3];
+		Sim::set_pin(pin_enc_a[next], state & 2);
+		Sim::set_pin(pin_enc_b[next], state & 1);
+	}
+	enc_pos[0] = pos_end[0];
+	enc_pos[1] = pos_end[1];
+	Sim::clock_advance(t_start + t_step - micros());
+}
+
+/**
+ * @brief Computes encoder positions from the model state [cnt]
+ */
+void Plant::enc_positions(float* pos)
+{
+	const float dir_cnt_per_rad = MotorConfig::direction / rad_per_cnt;
+	pos[0] = dir_cnt_per_rad * ((s.x - p.d * s.yaw) / p.r + s.pitch);
+	pos[1] = dir_cnt_per_rad * ((s.x + p.d * s.yaw) / p.r + s.pitch);
+}
+
+/**
+ * @brief Computes noiseless IMU signals (acc XYZ [m/s^2], gyr XYZ [rad/s])
+ *
+ * Acceleration is specific force at the IMU in the tilted sensor frame, in
+ * which y is forward at zero pitch so that atan2(acc_y, acc_z) is pitch.
+ */
+void Plant::imu_signals(float* out)
+{
+	const float c = cosf(s.pitch);
+	const float sn = sinf(s.pitch);
+	const float a_x = x_ddot - p.h_imu * (pitch_ddot * c - s.pitch_dot * s.pitch_dot * sn);
+	const float a_z = -p.h_imu * (pitch_ddot * sn + s.pitch_dot * s.pitch_dot * c) + g;
+	const float pitch_s = s.pitch + p.imu_tilt;
+	const float cs = cosf(pitch_s);
+	const float ss = sinf(pitch_s);
+	out[0] = s.x_dot * s.yaw_dot;
+	out[1] = a_x * cs + a_z * ss + p.acc_bias;
+	out[2] = -a_x * ss + a_z * cs;
+	out[3] = s.pitch_dot;
+	out[4] = s.yaw_dot * ss;
+	out[5] = s.yaw_dot * cs;
+}
+
+/**
+ * @brief Queues one noisy sample in the MPU FIFO and raises data-ready
+ *
+ * Data-ready is a pulse unless latched, in which case reads clear it [Wire.cpp].
+ */
+void Plant::imu_sample()
+{
+	uint8_t bytes[12];
+	for (uint8_t i = 0; i < 6; i++)
+	{
+		const int16_t raw = to_raw(i, imu_lpf[i] + imu_std[i] * normal(rng));
+		bytes[2 * i + 0] = (uint8_t)((uint16_t)raw >> 8);
+		bytes[2 * i + 1] = (uint8_t)((uint16_t)raw & 0xFF);
+	}
+	Sim::i2c_fifo_push(mpu_address, mpu_reg_fifo, bytes, sizeof(bytes));
+	Sim::set_pin(mpu_pin_int, true);
+	if (!(Sim::i2c_regs(mpu_address)[mpu_reg_int_pin_cfg] & mpu_latch_int_en))
+	{
+		Sim::set_pin(mpu_pin_int, false);
+	}
+}
+
+/**
+ * @brief Converts IMU signal to saturated register count
+ *
+ * Gyro counts include the ImuConfig offset (which the firmware removes) plus
+ * the uncalibrated bias.
+ */
+int16_t Plant::to_raw(uint8_t axis, float value)
+{
+	static const float gyr_cal[3] = {
+		ImuConfig::gyr_x_cal, ImuConfig::gyr_y_cal, ImuConfig::gyr_z_cal,
+	};
+	if (axis >= 3) value = (value + gyr_cal[axis - 3] + p.gyr_bias) / Mpu::gyr_scale;
+	else value /= Mpu::acc_scale;
+	if (value > 32767.0f) return 32767;
+	if (value < -32768.0f) return -32768;
+	return (int16_t)lroundf(value);
+}
@@ -0,0 +1,79 @@
+/**
+ * @file Plant.h
+ * @brief Wheeled inverted pendulum model wired to the Linux Arduino stand-in
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * Emulates the robot hardware seen by the unmodified firmware. The H-bridge
+ * pins set the motor voltages, the motors drive a planar pendulum on two
+ * wheels with yaw, and the resulting motion comes back as quadrature edges
+ * on the encoder pins and as MPU6050 FIFO samples with data-ready pulses, all
+ * through Sim.h. The host program owns the manual clock and calls advance()
+ * between firmware control steps.
+ *
+ * Coordinates follow the firmware: x is forward axle travel, pitch is the
+ * Imu pitch (positive leans the body backwards, so encoder angle is wheel
+ * angle plus pitch as in MotorL.cpp), and yaw is positive to the left.
+ *
+ * Each motor applies Kt * (V - Kv * w) / R at the wheel, where w is the wheel
+ * speed relative to the body and V is the PWM duty times the battery voltage.
+ * Reflected rotor inertia scales with tr^2. Sensors are low-pass filtered at
+ * the MPU6050_DLPF_CFG bandwidth, offset, and given white noise sized so the
+ * frame averaged at ImuConfig::f_cal has the ImuConfig variances.
+ */
+#pragma once
+#include <stdint.h>
+
+/**
+ * Namespace Declaration
+ */
+namespace Plant
+{
+	// Model parameters
+	typedef struct
+	{
+		// Body and wheels
+		float M;			// Body mass [kg]
+		float l;			// Axle to body COM [m]
+		float Ib;			// Body pitch inertia about COM [kg*m^2]
+		float Iz;			// Body yaw inertia [kg*m^2]
+		float m;			// Wheel mass (each) [kg]
+		float r;			// Wheel radius [m]
+		float d;			// Half wheel track [m]
+		float h_imu;		// Axle to IMU [m]
+
+		// Motors and drivers (each)
+		float Vb;			// Battery voltage [V]
+		float R;			// Resistance [Ohm]
+		float Kv;			// Voltage constant [V/(rad/s)]
+		float Kt;			// Torque constant [N*m/A]
+		float J_rotor;		// Rotor inertia [kg*m^2]
+		float b;			// Gearbox viscous friction [N*m/(rad/s)]
+		float act_gain;		// Applied / commanded voltage
+		float act_delay;	// Command to voltage delay [s]
+
+		// Sensors
+		float noise_scale;	// Noise std / ImuConfig std
+		float gyr_bias;		// Uncalibrated gyro bias [rad/s]
+		float acc_bias;		// Accelerometer bias [m/s^2]
+		float imu_tilt;		// IMU mounting pitch error [rad]
+	}
+	params_t;
+
+	// State
+	typedef struct
+	{
+		float x, x_dot;				// Axle travel [m], velocity [m/s]
+		float pitch, pitch_dot;		// Pitch [rad], velocity [rad/s]
+		float yaw, yaw_dot;			// Yaw [rad], velocity [rad/s]
+	}
+	state_t;
+
+	params_t nominal();
+	void init(const params_t& params, const state_t& state, uint32_t seed);
+	void advance(uint32_t us);
+	void hold(bool hold);
+	void push(float pitch_dot);
+	const state_t& get_state();
+	float get_volts_L();
+	float get_volts_R();
+}
@@ -9,17 +9,29 @@
 #include <Timer.h>
 
 // Project Libraries
+#include <Hal.h>
+#include <Bench.h>
+#include <Scheduler.h>
+#include <Profiler.h>
+#include <Recorder.h>
 #include <Bluetooth.h>
 #include <Imu.h>
+#include <Mpu.h>
+#include <Encoder.h>
 #include <MotorL.h>
 #include <MotorR.h>
+#include <MotorPwm.h>
 #include <MotorConfig.h>
+#include <RateConfig.h>
 #include <Controller.h>
+#if defined(SIM_MONTE_CARLO)
+	#include <MonteCarlo.h>
+#endif
 using MotorConfig::Vb;
-using Controller::t_ctrl;
+using RateConfig::due;
 
 // Global Variables
-uint32_t loop_count = 0;	// Control loop counter
+uint32_t loop_count = 0;	// Balance step counter
 Timer timer;				// Controller timer
 
 /**
@@ -32,40 +44,50 @@ void setup()
 	Imu::init();
 	MotorL::init();
 	MotorR::init();
+	MotorPwm::init();
 	Controller::init();
 
 #if defined(CALIBRATE_IMU)
 
 	// Print IMU calibration values
 	Imu::calibrate();
-	while(1);
+	Hal::halt();
+
+#elif defined(BENCH_SUBSYSTEMS)
+
+	// Print subsystem update timing
+	Bench::run();
+	Hal::halt();
+
+#elif defined(SIM_MONTE_CARLO)
+
+	// Run simulated closed-loop scenarios
+	MonteCarlo::run();
+	Hal::halt();
 
 #endif
 
 	// Start loop timing
 	timer.start();
+	Scheduler::init();
 }
 
 /**
- * Balbot Control Loop.
+ * Runs the balance rate group: pitch-velocity control, motor outputs, and
+ * recorder and telemetry samples of the step.
  */
-void loop()
+void balance_step()
 {
-	// Reset loop timer
-	timer.reset();
-
-	// Update subsystems
-	Bluetooth::update();
-	Imu::update();
-	MotorL::update();
-	MotorR::update();
-	Controller::update();
+	// Update controller
+	const uint32_t t_controller = Profiler::start();
+	Controller::update_balance();
+	Profiler::lap(Profiler::span_controller, t_controller);
+	Profiler::trace(Profiler::point_control);
 
 #if defined(SERIAL_DEBUG)
 
 	// Print debug info to serial
-	MotorL::set_voltage(0.0f);
-	MotorR::set_voltage(0.0f);
+	MotorPwm::set_voltages(0.0f, 0.0f);
 	if (loop_count % 25 == 0)
 	{
 		Serial.println("Motor L Angle [rad]: " + String(MotorL::get_angle(), 2));
@@ -73,14 +95,15 @@ void loop()
 		Serial.println("Pitch Angle [rad]: " + String(Imu::get_pitch(), 2));
 		Serial.println("Voltage L [V]: " + String(Controller::get_motor_L_cmd(), 2));
 		Serial.println("Voltage R [V]: " + String(Controller::get_motor_R_cmd(), 2));
+		Serial.println("Overruns: " + String(Scheduler::get_overruns()));
+		Serial.println("TX drops: " + String(Bluetooth::get_tx_drops()));
 		Serial.println();
 	}
 
 #elif defined(MOTOR_SPEED_TEST)
 
 	// Send max motor voltages and print velocities
-	MotorL::set_voltage(MotorConfig::Vb);
-	MotorR::set_voltage(MotorConfig::Vb);
+	MotorPwm::set_voltages(MotorConfig::Vb, MotorConfig::Vb);
 	if (loop_count % 25 == 0)
 	{
 		Serial.println("Velocities [rad/s]:");
@@ -93,21 +116,142 @@ void loop()
 
 	// Estimate maximum possible control frequency
 	const float f_ctrl_max = 1.0f / timer.read();
-	MotorL::set_voltage(0.0f);
-	MotorR::set_voltage(0.0f);
+	MotorPwm::set_voltages(0.0f, 0.0f);
 	Serial.println("GET_MAX_CTRL_FREQ");
 	Serial.println("Max ctrl freq: " + String(f_ctrl_max));
-	while(1);
+	Hal::halt();
 
 #else
 
 	// Send voltage commands to motors
-	MotorL::set_voltage(Controller::get_motor_L_cmd());
-	MotorR::set_voltage(Controller::get_motor_R_cmd());
+#if defined(BALBOT_FIXED_POINT)
+	MotorPwm::set_voltages_q16(
+		Controller::get_motor_L_cmd_q16(), Controller::get_motor_R_cmd_q16());
+#else
+	MotorPwm::set_voltages(
+		Controller::get_motor_L_cmd(), Controller::get_motor_R_cmd());
+#endif
+	Profiler::trace_pwm();
 
 #endif
 
-	// Maintain loop timing
+	// Record and stream step
+	Recorder::record(loop_count);
+	Bluetooth::stream(loop_count);
 	loop_count++;
-	while (timer.read() < t_ctrl);
-}
\ No newline at end of file
+}
+
+/**
+ * Runs background tasks (writing queued serial frames).
+ */
+void background_step()
+{
+	Bluetooth::drain();
+}
+
+/**
+ * Balbot Control Loop.
+ * 
+ * Runs one Scheduler frame: the sense, yaw, balance, and comms rate groups
+ * due in that frame (RateConfig.h), in that order. Background tasks run
+ * until the frame is released.
+ * 
+ * With LOOP_ORDER_LATENCY, the loop idles until release instead, so no
+ * background task is interleaved before sensing. The balance group runs
+ * straight after sensing, then yaw, comms, and one pass of the background
+ * tasks once the frame is done. That pass runs to completion, so if it
+ * crosses the next release the delay shows up as period jitter or an overrun
+ * (BENCH_LOOP) instead of being avoided.
+ */
+void loop()
+{
+#if defined(LOOP_ORDER_LATENCY)
+
+	// Wait for frame release
+	while (!Scheduler::ready());
+
+#else
+
+	// Run background tasks until frame release
+	while (!Scheduler::ready())
+	{
+		background_step();
+	}
+
+#endif
+	const uint16_t frame = Scheduler::get_frame();
+	const uint32_t t_step = Profiler::start();
+	Bench::frame_start();
+
+	// Reset loop timer
+	timer.reset();
+	Recorder::start();
+
+	// Sense group
+	if (due(RateConfig::group_sense, frame))
+	{
+		uint32_t t_span = t_step;
+		Imu::update();
+		t_span = Profiler::lap(Profiler::span_imu, t_span);
+		if (Mpu::get_samples() > 0)
+		{
+			Profiler::trace_at(Profiler::point_imu, Mpu::get_stamp());
+		}
+		Encoder::update();
+		Profiler::trace(Profiler::point_encoder);
+		t_span = Profiler::lap(Profiler::span_encoder, t_span);
+		MotorL::update();
+		t_span = Profiler::lap(Profiler::span_motor_l, t_span);
+		MotorR::update();
+		Profiler::lap(Profiler::span_motor_r, t_span);
+	}
+
+#if defined(LOOP_ORDER_LATENCY)
+
+	// Balance group
+	if (due(RateConfig::group_balance, frame))
+	{
+		balance_step();
+	}
+
+#endif
+
+	// Yaw group
+	if (due(RateConfig::group_yaw, frame))
+	{
+		const uint32_t t_yaw = Profiler::start();
+		Controller::update_yaw();
+		Profiler::lap(Profiler::span_yaw, t_yaw);
+	}
+
+#if !defined(LOOP_ORDER_LATENCY)
+
+	// Balance group
+	if (due(RateConfig::group_balance, frame))
+	{
+		balance_step();
+	}
+
+#endif
+
+	// Comms group
+	if (due(RateConfig::group_comms, frame))
+	{
+		const uint32_t t_bluetooth = Profiler::start();
+		Bluetooth::update();
+		Profiler::lap(Profiler::span_bluetooth, t_bluetooth);
+	}
+
+	// Finish frame
+	Profiler::lap(Profiler::span_step, t_step);
+	Profiler::end_cycle();
+	Bench::frame_end();
+	Scheduler::done();
+
+#if defined(LOOP_ORDER_LATENCY)
+
+	// Run background tasks after actuation
+	background_step();
+
+#endif
+}
@@ -0,0 +1,329 @@
+/**
+ * @file Bench.cpp
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#include <Bench.h>
+#include <Hal.h>
+#include <Scheduler.h>
+#include <Profiler.h>
+#include <Bluetooth.h>
+#include <Imu.h>
+#include <Encoder.h>
+#include <MotorL.h>
+#include <MotorR.h>
+#include <MotorPwm.h>
+#include <Controller.h>
+#include <RateConfig.h>
+#include <ImuConfig.h>
+#include <FastMath.h>
+#include <Protocol.h>
+#include <GRV.h>
+#if defined(PLATFORM_NATIVE)
+	#include <Sim.h>
+#else
+	extern "C" void INT0_vect() __attribute__((signal));
+#endif
+
+/**
+ * Namespace Definitions
+ */
+namespace Bench
+{
+	// Iterations per measurement
+#if defined(BENCH_ITERATIONS)
+	const uint32_t iterations = BENCH_ITERATIONS;
+#else
+	const uint32_t iterations = 1000;
+#endif
+
+	// Call overhead [ns]
+	float overhead_ns = 0.0f;
+
+	// Kernel operands (volatile to defeat constant folding)
+	volatile float kernel_x = 0.3f;
+	volatile float kernel_y = 0.7f;
+	volatile float kernel_out = 0.0f;
+	uint8_t kernel_payload[Protocol::max_payload];
+	uint8_t kernel_frame[Protocol::max_frame];
+#if defined(PLATFORM_NATIVE)
+	bool kernel_edge = false;
+	const uint8_t pin_enc_left_a = 2;	// Encoder.cpp
+#endif
+
+	// Pitch estimator state (Imu.cpp float paths)
+	GRV kernel_grv_pitch;
+	float kernel_pitch = 0.0f;
+	float kernel_gyr_bias = 0.0f;
+	float kernel_k_pitch = 0.0117f;
+	float kernel_k_bias = -0.0030f;
+
+#if defined(BENCH_LOOP)
+
+	// Loop measurement time [s]
+#if defined(BENCH_LOOP_SECONDS)
+	const uint32_t loop_seconds = BENCH_LOOP_SECONDS;
+#else
+	const uint32_t loop_seconds = 5;
+#endif
+
+	// Frame period [us]
+	constexpr uint32_t t_frame_us = (uint32_t)(1.0e6f * RateConfig::t_frame + 0.5f);
+
+	// Frame statistics
+	uint32_t frames = 0;			// Frames measured
+	uint32_t t_first = 0;			// Start of first frame [us]
+	uint32_t t_frame_start = 0;		// Start of current frame [us]
+	uint32_t busy_sum = 0;			// Sum of busy times [us]
+	uint32_t busy_max = 0;			// Max busy time [us]
+	float jitter_sq_sum = 0.0f;		// Sum of squared period errors [us^2]
+	uint32_t jitter_max = 0;		// Max period error [us]
+
+	// Private functions
+	void loop_report();
+
+#endif
+
+	// Private functions
+	float time_ns(void (*func)());
+	void report(const char* name, void (*func)());
+	void nop();
+	void libm_sin();
+	void libm_atan2();
+	void fast_sin();
+	void fast_atan2();
+	void protocol_encode();
+	void motor_pwm();
+	void encoder_edge();
+	void grv_pitch();
+	void kalman_pitch();
+}
+
+/**
+ * @brief Times each subsystem update and prints results to serial
+ * 
+ * Results are reported in nanoseconds per call with the loop and
+ * function-pointer call overhead subtracted.
+ */
+void Bench::run()
+{
+	Hal::serial->println("BENCH_SUBSYSTEMS");
+	Hal::serial->println("Iterations: " + String(iterations));
+	overhead_ns = time_ns(nop);
+	report("Bluetooth::update", Bluetooth::update);
+	report("Imu::update", Imu::update);
+	report("Encoder::update", Encoder::update);
+	report("MotorL::update", MotorL::update);
+	report("MotorR::update", MotorR::update);
+	report("Controller::update_balance", Controller::update_balance);
+	report("Controller::update_yaw", Controller::update_yaw);
+	report("sinf", libm_sin);
+	report("FastMath::sin", fast_sin);
+	report("atan2f", libm_atan2);
+	report("FastMath::atan2", fast_atan2);
+	report("Protocol::encode (max payload)", protocol_encode);
+	report("MotorPwm::set_voltages", motor_pwm);
+	report("Encoder edge ISR (INT0)", encoder_edge);
+	report("GRV pitch fusion", grv_pitch);
+	report("Kalman pitch update", kalman_pitch);
+}
+
+#if defined(BENCH_LOOP)
+
+/**
+ * @brief Marks the start of a Scheduler frame
+ * 
+ * Period jitter is the difference between consecutive frame starts and the
+ * frame period, so it includes release latency and any overrun.
+ */
+void Bench::frame_start()
+{
+	const uint32_t t_now = Hal::micros();
+	if (frames == 0)
+	{
+		t_first = t_now;
+	}
+	else
+	{
+		const int32_t error = (int32_t)(t_now - t_frame_start - t_frame_us);
+		const uint32_t jitter = (error < 0) ? -error : error;
+		jitter_sq_sum += (float)jitter * jitter;
+		if (jitter > jitter_max) jitter_max = jitter;
+	}
+	t_frame_start = t_now;
+}
+
+/**
+ * @brief Marks the end of a Scheduler frame and reports when time is up
+ */
+void Bench::frame_end()
+{
+	const uint32_t t_now = Hal::micros();
+	const uint32_t busy = t_now - t_frame_start;
+	busy_sum += busy;
+	if (busy > busy_max) busy_max = busy;
+	frames++;
+	if (t_now - t_first >= loop_seconds * 1000000ul)
+	{
+		loop_report();
+		Hal::halt();
+	}
+}
+
+/**
+ * @brief Prints loop timing statistics to serial
+ * 
+ * Headroom is the fraction of frame time left idle, on average and in the
+ * busiest frame. With PROFILE_LOOP the sensor-to-PWM latencies of the balance
+ * steps follow.
+ */
+void Bench::loop_report()
+{
+	const float busy_mean = (float)busy_sum / frames;
+	const float jitter_rms = (frames > 1) ? sqrtf(jitter_sq_sum / (frames - 1)) : 0.0f;
+	Hal::serial->println("BENCH_LOOP");
+	Hal::serial->println("Frame rate: " + String(RateConfig::f_frame, 0) +
+		" Hz (" + String(t_frame_us) + " us), balance " +
+		String(RateConfig::f_balance, 0) + " Hz");
+	Hal::serial->println("Frames: " + String(frames) + ", overruns: " +
+		String(Scheduler::get_overruns()));
+	Hal::serial->println("Busy [us]: mean " + String(busy_mean, 1) +
+		", max " + String(busy_max));
+	Hal::serial->println("Headroom [%]: mean " +
+		String(100.0f * (1.0f - busy_mean / t_frame_us), 1) + ", worst frame " +
+		String(100.0f * (1.0f - (float)busy_max / t_frame_us), 1));
+	Hal::serial->println("Period jitter [us]: rms " + String(jitter_rms, 1) +
+		", max " + String(jitter_max));
+
+#if defined(PROFILE_LOOP)
+
+	// Sensor-to-actuator latencies
+	const char* names[] = {"IMU", "Encoder", "Control"};
+	const Profiler::span_t spans[] = {
+		Profiler::span_imu_pwm, Profiler::span_encoder_pwm, Profiler::span_control_pwm};
+	for (uint8_t i = 0; i < 3; i++)
+	{
+		const Profiler::hist_t& hist = Profiler::get_hist(spans[i]);
+		String line = String(names[i]) + " to PWM latency [us]: ";
+		if (hist.count > 0)
+		{
+			line += "mean " + String((float)hist.sum / hist.count, 1) +
+				", min " + String(hist.min) + ", max " + String(hist.max);
+		}
+		else
+		{
+			line += "no samples";
+		}
+		Hal::serial->println(line);
+	}
+
+#endif
+}
+
+#endif
+
+/**
+ * @brief Returns mean time per call of func [ns]
+ */
+float Bench::time_ns(void (*func)())
+{
+	const uint32_t t_start = Hal::micros();
+	for (uint32_t i = 0; i < iterations; i++) func();
+	const uint32_t t_total = Hal::micros() - t_start;
+	return 1000.0f * t_total / iterations;
+}
+
+/**
+ * @brief Times func and prints result to serial
+ */
+void Bench::report(const char* name, void (*func)())
+{
+	const float t_call = time_ns(func) - overhead_ns;
+	Hal::serial->println(String(name) + ": " + String(t_call, 0) + " ns/call");
+}
+
+/**
+ * @brief Empty function for measuring call overhead
+ */
+void Bench::nop()
+{
+	__asm__ __volatile__("");
+}
+
+/**
+ * @brief Trig kernels for libm vs FastMath comparison
+ */
+void Bench::libm_sin()
+{
+	kernel_out = sinf(kernel_x);
+}
+void Bench::libm_atan2()
+{
+	kernel_out = atan2f(kernel_y, kernel_x);
+}
+void Bench::fast_sin()
+{
+	kernel_out = FastMath::sin(kernel_x);
+}
+void Bench::fast_atan2()
+{
+	kernel_out = FastMath::atan2(kernel_y, kernel_x);
+}
+
+/**
+ * @brief Frame encoding kernel (dominated by CRC over the payload)
+ */
+void Bench::protocol_encode()
+{
+	Protocol::encode(kernel_frame, Protocol::id_state, 0,
+		kernel_payload, Protocol::max_payload);
+}
+
+/**
+ * @brief Motor output kernel (both motors, direction unchanged)
+ */
+void Bench::motor_pwm()
+{
+	MotorPwm::set_voltages(kernel_x, kernel_y);
+}
+
+/**
+ * @brief Encoder edge kernel (left wheel ISR)
+ * 
+ * The AVR calls the INT0 vector directly. It returns with reti like a
+ * hardware interrupt, so only the interrupt response and vector jump (7
+ * cycles) are missing. The host toggles channel A through the pin stand-in,
+ * which runs the attached ISR.
+ */
+void Bench::encoder_edge()
+{
+#if defined(PLATFORM_NATIVE)
+	kernel_edge = !kernel_edge;
+	Sim::set_pin(pin_enc_left_a, kernel_edge);
+#else
+	INT0_vect();
+#endif
+}
+
+/**
+ * @brief Pitch estimator kernels for GRV vs steady-state Kalman comparison
+ * 
+ * Both include the accelerometer atan2, so the difference is the variance
+ * propagation that IMU_KALMAN removes.
+ */
+void Bench::grv_pitch()
+{
+	const GRV acc_y(kernel_y, ImuConfig::acc_y_var);
+	const GRV acc_z(kernel_x, ImuConfig::acc_z_var);
+	const GRV pitch_vel(kernel_x, ImuConfig::gyr_x_var);
+	kernel_grv_pitch = fuse(
+		kernel_grv_pitch + pitch_vel * RateConfig::t_sense,
+		atan2(acc_y, acc_z));
+}
+void Bench::kalman_pitch()
+{
+	const float pitch_gyr = kernel_pitch +
+		(kernel_x - kernel_gyr_bias) * RateConfig::t_sense;
+	const float innovation = atan2f(kernel_y, kernel_x) - pitch_gyr;
+	kernel_pitch = pitch_gyr + kernel_k_pitch * innovation;
+	kernel_gyr_bias += kernel_k_bias * innovation;
+}
@@ -0,0 +1,35 @@
+/**
+ * @file Bench.h
+ * @brief Subsystem for microbenchmarking subsystem updates
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * With BENCH_LOOP, frame_start() and frame_end() bracket each Scheduler frame
+ * of the running loop. After BENCH_LOOP_SECONDS the busy time, CPU headroom,
+ * and period jitter of the frames are printed to serial. The native_rate_*
+ * environments build this at several frame rates (RATE_FRAME_HZ), and the
+ * native_latency environments add the Profiler latency spans with and without
+ * LOOP_ORDER_LATENCY.
+ *
+ * Without BENCH_LOOP the frame calls are empty inlines and compile out.
+ */
+#pragma once
+
+/**
+ * Namespace Declaration
+ */
+namespace Bench
+{
+	void run();
+
+#if defined(BENCH_LOOP)
+
+	void frame_start();
+	void frame_end();
+
+#else
+
+	inline void frame_start() {}
+	inline void frame_end() {}
+
+#endif
+}
@@ -5,23 +5,71 @@
 #include <Bluetooth.h>
 #include <Imu.h>
 #include <Controller.h>
-#include <SerialStruct.h>
+#include <MotorL.h>
+#include <MotorR.h>
+#include <Hal.h>
+#include <Profiler.h>
+#include <Recorder.h>
+#include <Protocol.h>
+#include <string.h>
 
 /**
  * Namespace Definitions
  */
 namespace Bluetooth
 {
-	// Hardware interfaces
-	SerialStruct serial(&Serial);
+	// Serial link
 	const uint32_t baud = 57600;
+	const uint8_t max_rx_bytes = 32;	// Bytes parsed per update
+	Protocol::parser_t parser;
+	uint8_t tx_seq = 0;
+
+	// Transmit queue (whole frames, front frame may be partly written)
+	const uint8_t tx_queue_size = 128;	// Queue size [bytes]
+	uint8_t tx_queue[tx_queue_size];	// Queued frame bytes
+	uint8_t tx_len = 0;					// Queued byte count
+	uint8_t tx_partial = 0;				// Unwritten bytes of front frame
+	uint16_t tx_drops = 0;				// Dropped frame count
+
+	// Profile dump
+	uint8_t profile_span = 0;			// Next span to send
+	bool profile_pending = false;		// Dump in progress
+
+	// Recorder download
+	const uint8_t record_part_size = 32;	// Block bytes per frame
+	const uint8_t record_parts = Recorder::block_size / record_part_size;
+	uint16_t record_part = 0;			// Next part to send
+	bool record_pending = false;		// Download in progress
+
+	// Telemetry stream
+	uint8_t stream_decim = 0;		// Balance steps per frame (0 = off)
+	uint16_t stream_mask = 0;		// Channel mask
+	uint8_t stream_step = 0;		// Steps since last frame
 
 	// Received commands
 	float lin_vel_cmd = 0.0f;	// Linear velocity [m/s]
 	float yaw_vel_cmd = 0.0f;	// Yaw velocity [rad/s]
 
+	// Link watchdog
+#if defined(CMD_TIMEOUT_MS)
+	const uint32_t cmd_timeout = CMD_TIMEOUT_MS * 1000UL;	// Command timeout [us]
+#else
+	const uint32_t cmd_timeout = 500000UL;					// Command timeout [us]
+#endif
+	uint32_t cmd_time = 0;		// Time of last valid command [us]
+	bool cmd_fresh = false;		// Command received within timeout
+
 	// Init flag
 	bool init_complete = false;
+
+	// Private functions
+	void handle(const Protocol::frame_t& frame);
+	float get_channel(uint8_t channel);
+	bool send(uint8_t id, const void* payload, uint8_t len);
+	bool drop_telemetry();
+	void send_state();
+	void send_profile();
+	void send_record();
 }
 
 /**
@@ -35,8 +83,8 @@ void Bluetooth::init()
 		Imu::init();
 
 		// Init serial
-		Serial.begin(baud);
-		serial.flush();
+		Hal::serial->begin(baud);
+		Protocol::reset(parser);
 
 		// Set init flag
 		init_complete = true;
@@ -44,20 +92,67 @@ void Bluetooth::init()
 }
 
 /**
- * @brief Checks Bluetooth serial buffer for commands
+ * @brief Parses received bytes, handles complete frames, and queues replies
+ * 
+ * Called in each comms frame (RateConfig::group_comms). At most max_rx_bytes
+ * are parsed per call to bound the time spent here. Outgoing frames are
+ * queued and written by drain() only as fast as the serial TX buffer has
+ * room, so this never blocks on the link.
  */
 void Bluetooth::update()
 {
-	if(Serial.available() >= 8)
+	for (uint8_t n = 0; n < max_rx_bytes && Hal::serial->available() > 0; n++)
 	{
-		serial.rx(lin_vel_cmd);
-		serial.rx(yaw_vel_cmd);
-		serial.tx(Imu::get_pitch());
-		serial.tx(Controller::get_lin_vel());
-		serial.tx(Imu::get_yaw_vel());
-		serial.tx(Controller::get_motor_L_cmd());
-		serial.tx(Controller::get_motor_R_cmd());
+		if (Protocol::parse(parser, (uint8_t)Hal::serial->read()))
+		{
+			handle(parser.frame);
+		}
 	}
+	if (profile_pending)
+	{
+		send_profile();
+	}
+	if (record_pending)
+	{
+		send_record();
+	}
+	drain();
+}
+
+/**
+ * @brief Returns number of outgoing frames dropped on queue overflow
+ */
+uint16_t Bluetooth::get_tx_drops()
+{
+	return tx_drops;
+}
+
+/**
+ * @brief Samples telemetry channels every stream_decim balance steps
+ * 
+ * Called at the end of each balance step (RateConfig::group_balance), so all
+ * channels come from the same step and the stream is not limited by the
+ * slower comms group. The frame is queued at once and written by drain(); on
+ * queue overflow the oldest queued telemetry frame is dropped.
+ */
+void Bluetooth::stream(uint32_t loop_count)
+{
+	if (stream_decim == 0 || ++stream_step < stream_decim) return;
+	stream_step = 0;
+	uint8_t telem[Protocol::max_payload];
+	memcpy(telem, &loop_count, 4);
+	memcpy(telem + 4, &stream_mask, 2);
+	uint8_t len = 6;
+	for (uint8_t ch = 0; ch < Protocol::num_channels; ch++)
+	{
+		if (stream_mask & (1u << ch))
+		{
+			const int16_t count = Protocol::to_channel(ch, get_channel(ch));
+			memcpy(telem + len, &count, 2);
+			len += 2;
+		}
+	}
+	send(Protocol::id_telemetry, telem, len);
 }
 
 /**
@@ -74,4 +169,256 @@ float Bluetooth::get_lin_vel_cmd()
 float Bluetooth::get_yaw_vel_cmd()
 {
 	return yaw_vel_cmd;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Returns true if no valid command arrived within the timeout
+ * 
+ * Latches until the next command, so micros() wrapping during a long
+ * silence can not make an old command look fresh again.
+ */
+bool Bluetooth::is_link_lost()
+{
+	if (cmd_fresh && (Hal::micros() - cmd_time) > cmd_timeout)
+	{
+		cmd_fresh = false;
+	}
+	return !cmd_fresh;
+}
+
+/**
+ * @brief Handles received frame (unknown IDs are ignored)
+ */
+void Bluetooth::handle(const Protocol::frame_t& frame)
+{
+	switch (frame.id)
+	{
+		case Protocol::id_cmd_vel:
+		{
+			if (frame.len != 2 * sizeof(float)) break;
+			float cmds[2];
+			memcpy(cmds, frame.payload, sizeof(cmds));
+			if (isfinite(cmds[0]) && isfinite(cmds[1]))
+			{
+				lin_vel_cmd = cmds[0];
+				yaw_vel_cmd = cmds[1];
+				cmd_time = Hal::micros();
+				cmd_fresh = true;
+			}
+			send_state();
+			break;
+		}
+		case Protocol::id_profile_req:
+			profile_span = 0;
+			profile_pending = true;
+			break;
+		case Protocol::id_stream_cfg:
+			if (frame.len != 3) break;
+			stream_decim = frame.payload[0];
+			memcpy(&stream_mask, frame.payload + 1, 2);
+			stream_mask &= (1u << Protocol::num_channels) - 1;
+			stream_step = 0;
+			break;
+		case Protocol::id_record_req:
+			if (frame.len != 1) break;
+#if defined(FLIGHT_RECORDER)
+			if (frame.payload[0] == 1)
+			{
+				Recorder::rearm();
+				break;
+			}
+			Recorder::freeze(Recorder::reason_host);
+#endif
+			record_part = 0;
+			record_pending = true;
+			break;
+		default:
+			break;
+	}
+}
+
+/**
+ * @brief Returns telemetry channel value in channel units
+ */
+float Bluetooth::get_channel(uint8_t channel)
+{
+	switch (channel)
+	{
+		case Protocol::ch_pitch: return Imu::get_pitch();
+		case Protocol::ch_pitch_vel: return Imu::get_pitch_vel();
+		case Protocol::ch_lin_vel: return Controller::get_lin_vel();
+		case Protocol::ch_yaw_vel: return Imu::get_yaw_vel();
+		case Protocol::ch_volts_L: return Controller::get_motor_L_cmd();
+		case Protocol::ch_volts_R: return Controller::get_motor_R_cmd();
+		case Protocol::ch_wheel_vel_L: return MotorL::get_velocity();
+		case Protocol::ch_wheel_vel_R: return MotorR::get_velocity();
+		case Protocol::ch_lin_vel_cmd: return lin_vel_cmd;
+		case Protocol::ch_yaw_vel_cmd: return yaw_vel_cmd;
+		default: return 0.0f;
+	}
+}
+
+/**
+ * @brief Frames payload and adds it to the transmit queue
+ * 
+ * If the frame does not fit, the oldest queued telemetry frames are dropped
+ * to make room. Telemetry never displaces other frames; a frame which still
+ * does not fit is dropped. Every dropped frame is counted.
+ * 
+ * @return True if frame was queued
+ */
+bool Bluetooth::send(uint8_t id, const void* payload, uint8_t len)
+{
+	const uint8_t size = Protocol::header_size + len + Protocol::crc_size;
+	while (tx_len + size > tx_queue_size)
+	{
+		if (!drop_telemetry())
+		{
+			tx_drops++;
+			return false;
+		}
+	}
+	Protocol::encode(tx_queue + tx_len, id, tx_seq++, payload, len);
+	tx_len += size;
+	return true;
+}
+
+/**
+ * @brief Removes oldest whole telemetry frame from the transmit queue
+ * @return True if a frame was removed
+ */
+bool Bluetooth::drop_telemetry()
+{
+	uint8_t pos = tx_partial;
+	while (pos < tx_len)
+	{
+		const uint8_t size = Protocol::header_size + tx_queue[pos + 4] + Protocol::crc_size;
+		if (tx_queue[pos + 2] == Protocol::id_telemetry)
+		{
+			memmove(tx_queue + pos, tx_queue + pos + size, tx_len - pos - size);
+			tx_len -= size;
+			tx_drops++;
+			return true;
+		}
+		pos += size;
+	}
+	return false;
+}
+
+/**
+ * @brief Writes as much of the queue as fits in the serial TX buffer
+ * 
+ * The serial TX buffer is emptied by the UART data-register-empty
+ * interrupt, so writes that fit return without waiting.
+ */
+void Bluetooth::drain()
+{
+	const int space = Hal::serial->availableForWrite();
+	if (tx_len == 0 || space <= 0) return;
+	const uint8_t count = (space < tx_len) ? (uint8_t)space : tx_len;
+	Hal::serial->write(tx_queue, count);
+
+	// Find unwritten bytes of the new front frame
+	uint8_t pos = tx_partial;
+	while (pos < count)
+	{
+		pos += Protocol::header_size + tx_queue[pos + 4] + Protocol::crc_size;
+	}
+	tx_partial = pos - count;
+	tx_len -= count;
+	memmove(tx_queue, tx_queue + count, tx_len);
+}
+
+/**
+ * @brief Sends state reply
+ */
+void Bluetooth::send_state()
+{
+	const float state[5] = {
+		Imu::get_pitch(),
+		Controller::get_lin_vel(),
+		Imu::get_yaw_vel(),
+		Controller::get_motor_L_cmd(),
+		Controller::get_motor_R_cmd(),
+	};
+	send(Protocol::id_state, state, sizeof(state));
+}
+
+/**
+ * @brief Queues next loop timing histogram, resetting them after the last
+ * 
+ * Sends one span per call, once the queue has room for it, so a dump never
+ * overflows the queue. If profiling is compiled out, sends a single frame
+ * with zero spans.
+ */
+void Bluetooth::send_profile()
+{
+	uint8_t payload[2 + sizeof(Profiler::hist_t)];
+#if defined(PROFILE_LOOP)
+	const uint8_t size = Protocol::header_size + sizeof(payload) + Protocol::crc_size;
+	if (tx_len + size > tx_queue_size) return;
+	payload[0] = profile_span;
+	payload[1] = Profiler::num_spans;
+	memcpy(payload + 2, &Profiler::get_hist((Profiler::span_t)profile_span), sizeof(Profiler::hist_t));
+	send(Protocol::id_profile, payload, sizeof(payload));
+	if (++profile_span == Profiler::num_spans)
+	{
+		Profiler::reset();
+		profile_pending = false;
+	}
+#else
+	payload[0] = 0;
+	payload[1] = 0;
+	send(Protocol::id_profile, payload, 2);
+	profile_pending = false;
+#endif
+}
+
+/**
+ * @brief Queues recorder info, then one block part per call
+ * 
+ * Parts are sent oldest block first, once the queue has room for each. If
+ * the recorder is compiled out, sends only an info frame with zero blocks.
+ */
+void Bluetooth::send_record()
+{
+#if defined(FLIGHT_RECORDER)
+	const uint8_t num_blocks = Recorder::get_num_blocks();
+#else
+	const uint8_t num_blocks = 0;
+#endif
+	uint8_t payload[2 + record_part_size];
+	const uint8_t size = Protocol::header_size + sizeof(payload) + Protocol::crc_size;
+	if (tx_len + size > tx_queue_size) return;
+
+	// Info frame
+	if (record_part == 0)
+	{
+		uint32_t last_loop = 0;
+		payload[0] = Recorder::reason_none;
+#if defined(FLIGHT_RECORDER)
+		last_loop = Recorder::get_last_loop();
+		payload[0] = Recorder::get_reason();
+#endif
+		memcpy(payload + 1, &last_loop, 4);
+		payload[5] = num_blocks;
+		send(Protocol::id_record_info, payload, 6);
+	}
+
+	// Block part frame
+#if defined(FLIGHT_RECORDER)
+	else
+	{
+		const uint8_t block = (record_part - 1) / record_parts;
+		const uint8_t part = (record_part - 1) % record_parts;
+		payload[0] = block;
+		payload[1] = part;
+		memcpy(payload + 2, Recorder::get_block(block) + part * record_part_size, record_part_size);
+		send(Protocol::id_record_data, payload, sizeof(payload));
+	}
+#endif
+	if (++record_part > (uint16_t)num_blocks * record_parts)
+	{
+		record_pending = false;
+	}
+}
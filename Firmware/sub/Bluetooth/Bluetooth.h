@@ -4,6 +4,7 @@
  * @author Dan Oates (WPI Class of 2020)
  */
 #pragma once
+#include <stdint.h>
 
 /**
  * Namespace Declaration
@@ -12,6 +13,10 @@ namespace Bluetooth
 {
 	void init();
 	void update();
+	void drain();
+	void stream(uint32_t loop_count);
 	float get_lin_vel_cmd();
 	float get_yaw_vel_cmd();
+	bool is_link_lost();
+	uint16_t get_tx_drops();
 }
\ No newline at end of file
@@ -3,19 +3,29 @@
  * @author Dan Oates (WPI Class of 2020)
  */
 #include <Controller.h>
+#include <RateConfig.h>
 #include <MotorConfig.h>
+#include <ModelConfig.h>
+#include <Gains.h>
 #include <Bluetooth.h>
 #include <Imu.h>
 #include <MotorL.h>
 #include <MotorR.h>
+#include <Mpu.h>
+#include <Hal.h>
 #include <CppUtil.h>
-#include <SlewLimiter.h>
-#include <PID.h>
+#include <ClampLimiter.h>
 using MotorConfig::Vb;
 using MotorConfig::Kv;
 using MotorConfig::Kt;
 using MotorConfig::R;
 using CppUtil::clamp;
+using RateConfig::t_balance;
+using RateConfig::f_yaw;
+using RateConfig::t_yaw;
+#if defined(BALBOT_FIXED_POINT)
+	using namespace Fixed;
+#endif
 
 /**
  * Namespace Definitions
@@ -23,60 +33,145 @@ using CppUtil::clamp;
 namespace Controller
 {
 
-	// External Constants
-	const float f_ctrl = 100.0f;
-	const float t_ctrl = 1.0f / f_ctrl;
-	
-	// State Variables
-	float lin_vel = 0.0f;		// Linear velocity [m/s]
-	float lin_vel_cmd = 0.0f;	// Linear velocity command [m/s]
-	float yaw_vel = 0.0f;		// Yaw velocity [rad/s]
-	float yaw_vel_cmd = 0.0f;	// Yaw velocity command [rad/s]
-	float v_cmd_L = 0.0f;		// L motor voltage cmd [V]
-	float v_cmd_R = 0.0f;		// R motor voltage cmd [V]
+	// Model Parameters (ModelConfig.h, MotorConfig.h)
+	constexpr float dr = ModelConfig::r;		// Wheel radius [m]
+	constexpr float Gv = Gains::lin_vel_ff();	// Linear velocity feedforward [V/(m/s)]
+	constexpr float Gw = Gains::yaw_vel_ff();	// Yaw velocity feedforward [V/(rad/s)]
 
+	// Controller Constants
+	constexpr float dr_div_2 = dr/2.0f;	// Half wheel radius [m]
+	constexpr float pitch_max = 0.8f;	// Max pitch angle [rad]
+	constexpr float pz = 80.0f;		// Yaw-velocity pole [1/s]
 
-	// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% //
-	// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% //
-	// %%%%%% YOUR MODEL PARAMETERS GO IN HERE %%%%%%% //
-	// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% //
-	// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% //
-	
+	// Pitch-Velocity Poles [1/s]
+	// Chosen per torque ratio for margin in the native_sim environment
+	// CTRL_PREDICTOR keeps them; a faster pitch pole costs it gain margin
+	#if ES3011_BOT_ID <= 1
+		constexpr float px[3] = {40.0f, 10.0f, 3.0f};
+	#else
+		constexpr float px[3] = {60.0f, 10.0f, 3.0f};
+	#endif
 
-	// Controller Constants
-	const float dr_div_2 = dr/2.0f;	// Half wheel radius [m]
-	const float pitch_max = 0.8f;	// Max pitch angle [rad]
-	const float px = 20.0f;			// Pitch-velocity pole [1/s]
-	const float pz = 80.0f;			// Yaw-velocity pole [1/s]
-
-
-	// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% //
-	// %%%%% INSERT YOUR CONTROLLER GAINS BELOW %%%%%% //
-	// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% //
-	const float k1 = 0.0f;
-	const float k2 = 0.0f;
-	const float k3 = 0.0f;
-	// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% //
-
-	// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% //
-	// %%%%% INSERT YOUR PID CONTROLLER GAINS BELOW %%%%%% //
-	// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% //
-	const float Kp = 0.0f;
-	const float Ki = 0.0f;
-	const float Kd = 0.0f;
-	// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% //
+	// Pitch-Velocity Gains (pole placement, Gains.h)
+	constexpr Gains::feedback_t pitch_fb = Gains::place(px[0], px[1], px[2]);
+	constexpr float k1 = pitch_fb.k1;
+	constexpr float k2 = pitch_fb.k2;
+	constexpr float k3 = pitch_fb.k3;
 
+	// Yaw PID Gains (Kp placed at pz)
+	constexpr float Kp = Gains::yaw_kp(pz);
+	constexpr float Ki = 0.0f;
+	constexpr float Kd = 0.0f;
+
+	// Command Shaping Limits
+	constexpr float lin_vel_max = 0.8f;		// Max linear velocity [m/s]
+	constexpr float lin_acc_max = 0.8f;		// Max linear acceleration [m/s^2]
+	constexpr float yaw_vel_max = 2.0f;		// Max yaw velocity [rad/s]
+	constexpr float yaw_acc_max = 8.0f;		// Max yaw acceleration [rad/s^2]
+	constexpr float lin_vel_step = lin_acc_max * t_balance;	// Per balance step [m/s]
+	constexpr float yaw_vel_step = yaw_acc_max * t_yaw;		// Per yaw step [rad/s]
+
+#if defined(CTRL_PREDICTOR)
+	// Predictor Model (Gains.h)
+	constexpr float a10 = Gains::A[1][0];	// Pitch accel per pitch [1/s^2]
+	constexpr float a11 = Gains::A[1][1];	// Pitch accel per pitch velocity [1/s]
+	constexpr float a12 = Gains::A[1][2];	// Pitch accel per linear velocity [1/(m*s)]
+	constexpr float a20 = Gains::A[2][0];	// Linear accel per pitch [m/s^2]
+	constexpr float a21 = Gains::A[2][1];	// Linear accel per pitch velocity [m/s]
+	constexpr float a22 = Gains::A[2][2];	// Linear accel per linear velocity [1/s]
+	constexpr float b1 = Gains::B[1];		// Pitch accel per volt [1/(V*s^2)]
+	constexpr float b2 = Gains::B[2];		// Linear accel per volt [m/(V*s^2)]
+
+	// Prediction Horizon
+	// One Euler step of the model holds over about 7.5 ms in native_sim. At a
+	// 100 Hz balance rate the IMU sample alone is a frame old, so the horizon
+	// is capped there instead of covering the whole delay.
+	constexpr float t_pred_max = 7.5e-3f;				// Max horizon [s]
+	constexpr float t_hold = (0.5f * t_balance < t_pred_max) ?
+		0.5f * t_balance : t_pred_max;					// Mean age of held output [s]
+	constexpr uint32_t age_max =
+		(uint32_t)((t_pred_max - t_hold) / Hal::stamp_res);	// Max IMU age [stamps]
+#endif
+
+#if defined(BALBOT_FIXED_POINT)
+	// Fixed-Point Constants
+	constexpr q16_t f_yaw_q16 = to_q16(f_yaw);
+	constexpr q16_t t_yaw_q16 = to_q16(t_yaw);
+	constexpr q16_t Vb_q16 = to_q16(Vb);
+	constexpr q16_t dr_div_2_q16 = to_q16(dr_div_2);
+	constexpr q16_t pitch_max_q16 = to_q16(pitch_max);
+	constexpr q16_t Gv_q16 = to_q16(Gv);
+	constexpr q16_t Gw_q16 = to_q16(Gw);
+	constexpr q16_t k1_q16 = to_q16(k1);
+	constexpr q16_t k2_q16 = to_q16(k2);
+	constexpr q16_t k3_q16 = to_q16(k3);
+	constexpr q16_t Kp_q16 = to_q16(Kp);
+	constexpr q16_t Ki_q16 = to_q16(Ki);
+	constexpr q16_t Kd_q16 = to_q16(Kd);
+	constexpr q16_t lin_vel_max_q16 = to_q16(lin_vel_max);
+	constexpr q16_t yaw_vel_max_q16 = to_q16(yaw_vel_max);
+	constexpr q16_t lin_vel_step_q16 = to_q16(lin_vel_step);
+	constexpr q16_t yaw_vel_step_q16 = to_q16(yaw_vel_step);
+#if defined(CTRL_PREDICTOR)
+	constexpr q16_t a10_q16 = to_q16(a10);
+	constexpr q16_t a11_q16 = to_q16(a11);
+	constexpr q16_t a12_q16 = to_q16(a12);
+	constexpr q16_t a20_q16 = to_q16(a20);
+	constexpr q16_t a21_q16 = to_q16(a21);
+	constexpr q16_t a22_q16 = to_q16(a22);
+	constexpr q16_t b1_q16 = to_q16(b1);
+	constexpr q16_t b2_q16 = to_q16(b2);
+	constexpr q16_t t_hold_q16 = to_q16(t_hold);
+	constexpr uint32_t stamp_res_q32 =
+		(uint32_t)(Hal::stamp_res * 4294967296.0 + 0.5);	// [s/stamp, Q0.32]
+#endif
+
+	// State Variables
+	q16_t lin_vel = 0;			// Linear velocity [m/s]
+	q16_t lin_vel_cmd = 0;		// Linear velocity command [m/s]
+	q16_t yaw_vel_cmd = 0;		// Yaw velocity command [rad/s]
+	q16_t v_diff = 0;			// Differential voltage cmd [V]
+	q16_t v_cmd_L = 0;			// L motor voltage cmd [V]
+	q16_t v_cmd_R = 0;			// R motor voltage cmd [V]
+
+	// Yaw PID State
+	q16_t yaw_error_int = 0;	// Yaw error integral [rad]
+	q16_t yaw_error_prev = 0;	// Previous yaw error [rad/s]
+#else
 	// State Variables
 	float lin_vel = 0.0f;		// Linear velocity [m/s]
 	float lin_vel_cmd = 0.0f;	// Linear velocity command [m/s]
 	float yaw_vel = 0.0f;		// Yaw velocity [rad/s]
 	float yaw_vel_cmd = 0.0f;	// Yaw velocity command [rad/s]
+	float v_diff = 0.0f;		// Differential voltage cmd [V]
 	float v_cmd_L = 0.0f;		// L motor voltage cmd [V]
 	float v_cmd_R = 0.0f;		// R motor voltage cmd [V]
 
+	// Yaw PID State
+	float yaw_error_int = 0.0f;		// Yaw error integral [rad]
+	float yaw_error_prev = 0.0f;	// Previous yaw error [rad/s]
+
 	// Controllers
-	PID yaw_pid(Kp, Ki, Kd, -Vb, Vb, f_ctrl);
 	ClampLimiter volt_limiter(Vb);
+#endif
+
+	// Tip-over flag (motors disabled)
+	bool tipped = false;
+
+	// Private Functions
+#if defined(BALBOT_FIXED_POINT)
+	q16_t shape(q16_t cmd, float target, q16_t vel_max, q16_t vel_step);
+#else
+	float shape(float cmd, float target, float vel_max, float vel_step);
+#endif
+#if defined(CTRL_PREDICTOR)
+	uint32_t get_imu_age();
+#if defined(BALBOT_FIXED_POINT)
+	void predict(q16_t& pitch, q16_t& pitch_vel, q16_t& lin_vel_pred);
+#else
+	void predict(float& pitch, float& pitch_vel, float& lin_vel_pred);
+#endif
+#endif
 
 	// Init Flag
 	bool init_complete = false;
@@ -101,44 +196,310 @@ void Controller::init()
 }
 
 /**
- * @brief Runs one control loop iteration
+ * @brief Runs one pitch-velocity control iteration (balance rate group)
+ * 
+ * Combines the new average voltage with the latest differential voltage
+ * from update_yaw() into the motor voltage commands.
  */
-void Controller::update()
+void Controller::update_balance()
 {
-	// Get teleop commands
-	lin_vel_cmd = Bluetooth::get_lin_vel_cmd();
-	yaw_vel_cmd = Bluetooth::get_yaw_vel_cmd();
+#if defined(BALBOT_FIXED_POINT)
+
+	// Shape teleop command
+	lin_vel_cmd = shape(lin_vel_cmd, Bluetooth::get_lin_vel_cmd(),
+		lin_vel_max_q16, lin_vel_step_q16);
+
+	// Estimate linear velocity
+	lin_vel = mul(dr_div_2_q16,
+		add(MotorL::get_velocity_q16(), MotorR::get_velocity_q16()));
+
+	// Feedback states
+	q16_t pitch = Imu::get_pitch_q16();
+	q16_t pitch_vel = Imu::get_pitch_vel_q16();
+	q16_t lin_vel_fb = lin_vel;
+#if defined(CTRL_PREDICTOR)
+	predict(pitch, pitch_vel, lin_vel_fb);
+#endif
+
+	// Pitch-Velocity State-Space Control
+	q16_t v_avg = mul(Gv_q16, lin_vel_cmd);
+	v_avg = sub(v_avg, mul(k1_q16, pitch_vel));
+	v_avg = sub(v_avg, mul(k2_q16, pitch));
+	v_avg = add(v_avg, mul(k3_q16, sub(lin_vel_cmd, lin_vel_fb)));
+
+	// Clamp the voltage within the limits
+	v_avg = Fixed::clamp(v_avg, -Vb_q16, Vb_q16);
+
+	// Motor voltage commands
+	v_cmd_L = Fixed::clamp(sub(v_avg, v_diff), -Vb_q16, Vb_q16);
+	v_cmd_R = Fixed::clamp(add(v_avg, v_diff), -Vb_q16, Vb_q16);
+
+	// Disable motors if tipped over or IMU is calibrating
+	tipped = Fixed::abs(Imu::get_pitch_q16()) > pitch_max_q16;
+	if(tipped || !Imu::is_calibrated())
+	{
+		v_cmd_L = 0;
+		v_cmd_R = 0;
+	}
+
+#else
+
+	// Shape teleop command
+	lin_vel_cmd = shape(lin_vel_cmd, Bluetooth::get_lin_vel_cmd(),
+		lin_vel_max, lin_vel_step);
 
 	// Estimate linear velocity
 	lin_vel = dr_div_2 * (MotorL::get_velocity() + MotorR::get_velocity());
 
+	// Feedback states
+	float pitch = Imu::get_pitch();
+	float pitch_vel = Imu::get_pitch_vel();
+	float lin_vel_fb = lin_vel;
+#if defined(CTRL_PREDICTOR)
+	predict(pitch, pitch_vel, lin_vel_fb);
+#endif
+
 	// Pitch-Velocity State-Space Control
 	const float v_avg_ref = Gv * lin_vel_cmd;
-	float v_avg = v_avg_ref + k1 * (0.0f - Imu::get_pitch_vel()) +
-				  k2 * (0.0f - Imu::get_pitch()) +
-				  k3 * (lin_vel_cmd - lin_vel);
+	float v_avg = v_avg_ref + k1 * (0.0f - pitch_vel) +
+				  k2 * (0.0f - pitch) +
+				  k3 * (lin_vel_cmd - lin_vel_fb);
 
 	// Clamp the voltage within the limits
 	v_avg = clamp(v_avg, -Vb, Vb);
 
-	// Yaw velocity control
-	const float yaw_ff = Gw * yaw_vel_cmd;
-	const float yaw_error = yaw_vel_cmd - Imu::get_yaw_vel();
-	const float v_diff = yaw_pid.update(yaw_error, yaw_ff);
-
 	// Motor voltage commands
 	v_cmd_L = volt_limiter.update(v_avg - v_diff);
 	v_cmd_R = volt_limiter.update(v_avg + v_diff);
 
-	// Disable motors if tipped over
-	if(fabsf(Imu::get_pitch()) > pitch_max)
+	// Disable motors if tipped over or IMU is calibrating
+	tipped = fabsf(Imu::get_pitch()) > pitch_max;
+	if(tipped || !Imu::is_calibrated())
 	{
 		v_cmd_L = 0.0f;
 		v_cmd_R = 0.0f;
 	}
 
+#endif
 }
 
+/**
+ * @brief Runs one yaw velocity control iteration (yaw rate group)
+ */
+void Controller::update_yaw()
+{
+#if defined(BALBOT_FIXED_POINT)
+
+	// Shape teleop command
+	yaw_vel_cmd = shape(yaw_vel_cmd, Bluetooth::get_yaw_vel_cmd(),
+		yaw_vel_max_q16, yaw_vel_step_q16);
+
+	// Yaw velocity control
+	const q16_t yaw_ff = mul(Gw_q16, yaw_vel_cmd);
+	const q16_t yaw_error = sub(yaw_vel_cmd, Imu::get_yaw_vel_q16());
+	const q16_t yaw_error_dif = mul(sub(yaw_error, yaw_error_prev), f_yaw_q16);
+	yaw_error_int = add(yaw_error_int, mul(yaw_error, t_yaw_q16));
+	yaw_error_prev = yaw_error;
+	v_diff = add(yaw_ff, mul(Kp_q16, yaw_error));
+	v_diff = add(v_diff, mul(Ki_q16, yaw_error_int));
+	v_diff = add(v_diff, mul(Kd_q16, yaw_error_dif));
+	v_diff = Fixed::clamp(v_diff, -Vb_q16, Vb_q16);
+
+#else
+
+	// Shape teleop command
+	yaw_vel_cmd = shape(yaw_vel_cmd, Bluetooth::get_yaw_vel_cmd(),
+		yaw_vel_max, yaw_vel_step);
+
+	// Yaw velocity control
+	const float yaw_ff = Gw * yaw_vel_cmd;
+	const float yaw_error = yaw_vel_cmd - Imu::get_yaw_vel();
+	const float yaw_error_dif = (yaw_error - yaw_error_prev) * f_yaw;
+	yaw_error_int += yaw_error * t_yaw;
+	yaw_error_prev = yaw_error;
+	v_diff = yaw_ff + Kp * yaw_error + Ki * yaw_error_int + Kd * yaw_error_dif;
+	v_diff = clamp(v_diff, -Vb, Vb);
+
+#endif
+}
+
+#if defined(BALBOT_FIXED_POINT)
+
+/**
+ * @brief Returns command slewed toward clamped target
+ * @param cmd Current shaped command
+ * @param target Latest received command
+ * @param vel_max Command magnitude limit
+ * @param vel_step Max change per call
+ * 
+ * Targets zero once the Bluetooth link times out, so a lost host brings the
+ * robot to rest at the slew rate instead of holding the last command.
+ */
+q16_t Controller::shape(q16_t cmd, float target, q16_t vel_max, q16_t vel_step)
+{
+	const q16_t ref = Bluetooth::is_link_lost() ? 0 :
+		Fixed::clamp(to_q16(target), -vel_max, vel_max);
+	return add(cmd, Fixed::clamp(sub(ref, cmd), -vel_step, vel_step));
+}
+
+#else
+
+/**
+ * @brief Returns command slewed toward clamped target
+ * @param cmd Current shaped command
+ * @param target Latest received command
+ * @param vel_max Command magnitude limit
+ * @param vel_step Max change per call
+ * 
+ * Targets zero once the Bluetooth link times out, so a lost host brings the
+ * robot to rest at the slew rate instead of holding the last command.
+ */
+float Controller::shape(float cmd, float target, float vel_max, float vel_step)
+{
+	const float ref = Bluetooth::is_link_lost() ? 0.0f :
+		clamp(target, -vel_max, vel_max);
+	return cmd + clamp(ref - cmd, -vel_step, vel_step);
+}
+
+#endif
+
+#if defined(CTRL_PREDICTOR)
+
+/**
+ * @brief Returns age of the latest IMU sample [Hal::stamp_res]
+ * 
+ * Measured from the data-ready stamp of the newest sample in the frame
+ * (Mpu::get_stamp), so it includes the Mpu burst pipeline. Limited to
+ * age_max, which also covers the time before the first FIFO frame.
+ */
+uint32_t Controller::get_imu_age()
+{
+	noInterrupts();
+	const uint32_t stamp = Hal::stamp();
+	interrupts();
+	const uint32_t age = stamp - Mpu::get_stamp();
+	return (age < age_max) ? age : age_max;
+}
+
+#if defined(BALBOT_FIXED_POINT)
+
+/**
+ * @brief Propagates feedback states to the middle of the next output period
+ * @param pitch Pitch [rad]
+ * @param pitch_vel Pitch velocity [rad/s]
+ * @param lin_vel_pred Linear velocity [m/s]
+ * 
+ * See the float version for the model.
+ */
+void Controller::predict(q16_t& pitch, q16_t& pitch_vel, q16_t& lin_vel_pred)
+{
+	// Horizon and applied average voltage
+	const q16_t dt = add(t_hold_q16,
+		(q16_t)((get_imu_age() * stamp_res_q32) >> 16));
+	const q16_t u = add(v_cmd_L, v_cmd_R) / 2;
+
+	// Linearized accelerations
+	q16_t pitch_acc = mul(b1_q16, u);
+	pitch_acc = add(pitch_acc, mul(a10_q16, pitch));
+	pitch_acc = add(pitch_acc, mul(a11_q16, pitch_vel));
+	pitch_acc = add(pitch_acc, mul(a12_q16, lin_vel_pred));
+	q16_t lin_acc = mul(b2_q16, u);
+	lin_acc = add(lin_acc, mul(a20_q16, pitch));
+	lin_acc = add(lin_acc, mul(a21_q16, pitch_vel));
+	lin_acc = add(lin_acc, mul(a22_q16, lin_vel_pred));
+
+	// Propagate
+	const q16_t pitch_vel_mid = add(pitch_vel, mul(dt, pitch_acc) / 2);
+	pitch = add(pitch, mul(dt, pitch_vel_mid));
+	pitch_vel = add(pitch_vel, mul(dt, pitch_acc));
+	lin_vel_pred = add(lin_vel_pred, mul(dt, lin_acc));
+}
+
+#else
+
+/**
+ * @brief Propagates feedback states to the middle of the next output period
+ * @param pitch Pitch [rad]
+ * @param pitch_vel Pitch velocity [rad/s]
+ * @param lin_vel_pred Linear velocity [m/s]
+ * 
+ * The horizon is the measured age of the IMU sample plus half a balance
+ * period, the mean age of the held output, up to t_pred_max. One Euler step
+ * of the Gains.h model with the average voltage applied since the last step
+ * carries the states over it; pitch uses the mid-step velocity.
+ */
+void Controller::predict(float& pitch, float& pitch_vel, float& lin_vel_pred)
+{
+	// Horizon and applied average voltage
+	const float dt = t_hold + get_imu_age() * Hal::stamp_res;
+	const float u = 0.5f * (v_cmd_L + v_cmd_R);
+
+	// Linearized accelerations
+	const float pitch_acc = a10 * pitch + a11 * pitch_vel + a12 * lin_vel_pred + b1 * u;
+	const float lin_acc = a20 * pitch + a21 * pitch_vel + a22 * lin_vel_pred + b2 * u;
+
+	// Propagate
+	pitch += dt * (pitch_vel + 0.5f * dt * pitch_acc);
+	pitch_vel += dt * pitch_acc;
+	lin_vel_pred += dt * lin_acc;
+}
+
+#endif
+
+#endif
+
+/**
+ * @brief Returns true if motors were disabled for tip-over
+ */
+bool Controller::is_tipped()
+{
+	return tipped;
+}
+
+#if defined(BALBOT_FIXED_POINT)
+
+/**
+ * @brief Returns linear velocity estimate [m/s]
+ */
+float Controller::get_lin_vel()
+{
+	return to_float(lin_vel);
+}
+
+/**
+ * @brief Returns left motor voltage command [V]
+ */
+float Controller::get_motor_L_cmd()
+{
+	return to_float(v_cmd_L);
+}
+
+/**
+ * @brief Returns right motor voltage command [V]
+ */
+float Controller::get_motor_R_cmd()
+{
+	return to_float(v_cmd_R);
+}
+
+/**
+ * @brief Returns left motor voltage command [V, Q16.16]
+ */
+q16_t Controller::get_motor_L_cmd_q16()
+{
+	return v_cmd_L;
+}
+
+/**
+ * @brief Returns right motor voltage command [V, Q16.16]
+ */
+q16_t Controller::get_motor_R_cmd_q16()
+{
+	return v_cmd_R;
+}
+
+#else
+
 /**
  * @brief Returns linear velocity estimate [m/s]
  */
@@ -161,4 +522,6 @@ float Controller::get_motor_L_cmd()
 float Controller::get_motor_R_cmd()
 {
 	return v_cmd_R;
-}
\ No newline at end of file
+}
+
+#endif
\ No newline at end of file
@@ -4,20 +4,24 @@
  * @author Dan Oates (WPI Class of 2020)
  */
 #pragma once
+#if defined(BALBOT_FIXED_POINT)
+	#include <Fixed.h>
+#endif
 
 /**
  * Namespace Declaration
  */
 namespace Controller
 {
-	// Fields
-	extern const float f_ctrl;	// Control frequency [Hz]
-	extern const float t_ctrl;	// Control period [s]
-
-	// Methods
 	void init();
-	void update();
+	void update_balance();
+	void update_yaw();
 	float get_lin_vel();
 	float get_motor_L_cmd();
 	float get_motor_R_cmd();
+#if defined(BALBOT_FIXED_POINT)
+	Fixed::q16_t get_motor_L_cmd_q16();
+	Fixed::q16_t get_motor_R_cmd_q16();
+#endif
+	bool is_tipped();
 }
\ No newline at end of file
@@ -0,0 +1,299 @@
+/**
+ * @file Encoder.cpp
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#include <Encoder.h>
+#include <Seqlock.h>
+#include <Hal.h>
+
+/**
+ * Namespace Definitions
+ */
+namespace Encoder
+{
+	// Pins (all on port D)
+	const uint8_t pin_left_a = 2;
+	const uint8_t pin_left_b = 3;
+	const uint8_t pin_right_b = 4;
+	const uint8_t pin_right_a = 5;
+
+	// Count change by (previous state << 2 | new state), state = A << 1 | B
+	const int8_t transitions[16] = {
+		 0, -1, +1,  0,
+		+1,  0,  0, -1,
+		-1,  0,  0, +1,
+		 0, +1, -1,  0,
+	};
+
+	// Wheel states (written by ISRs)
+	Seqlock<edges_t> edges;					// Counts and edge times
+	uint8_t states[2] = {0, 0};				// Last channel states
+
+	// Rate estimator states
+	edges_t snapshot = {{0, 0}, {0, 0}};	// Edges at last update
+	uint16_t retries = 0;					// Snapshot reads retried
+	int32_t counts_prev[2] = {0, 0};		// Counts at last window edge [cnt]
+	uint32_t stamps_prev[2] = {0, 0};		// Last window edge times [Hal::stamp_res]
+#if defined(BALBOT_FIXED_POINT)
+	int32_t rates[2] = {0, 0};				// Count rates [cnt/stamp, Q8.24]
+	constexpr float rate_scale =
+		1.0f / (16777216.0f * Hal::stamp_res);	// Q8.24 [cnt/stamp] to [cnt/s]
+#else
+	float rates[2] = {0.0f, 0.0f};			// Count rates [cnt/s]
+#endif
+
+	// Init flag
+	bool init_complete = false;
+
+	// Private functions
+#if defined(BALBOT_FIXED_POINT)
+	int32_t rate_q24(int32_t counts, uint32_t stamps);
+#endif
+	int8_t decode(uint8_t& state, uint8_t state_new);
+	uint8_t state_left(uint8_t pind);
+	uint8_t state_right(uint8_t pind);
+	void isr_left();
+	void isr_right();
+}
+
+/**
+ * @brief Configures encoder inputs and edge interrupts
+ */
+void Encoder::init()
+{
+	if (!init_complete)
+	{
+		// Latch initial states
+		noInterrupts();
+		const uint8_t pind = Hal::port_d_read();
+		const uint32_t stamp = Hal::stamp();
+		interrupts();
+		states[left] = state_left(pind);
+		states[right] = state_right(pind);
+		edges_t& edges_init = edges.write_begin();
+		for (uint8_t side = left; side <= right; side++)
+		{
+			edges_init.stamps[side] = stamp;
+			stamps_prev[side] = stamp;
+		}
+		edges.write_end();
+		edges.read(snapshot);
+
+#if defined(PLATFORM_NATIVE)
+
+		// Attach edge ISRs
+		Hal::attach_isr(pin_left_a, isr_left);
+		Hal::attach_isr(pin_left_b, isr_left);
+		Hal::attach_isr(pin_right_a, isr_right);
+		Hal::attach_isr(pin_right_b, isr_right);
+
+#else
+
+		// INT0/INT1 on any edge, PCINT20/21 on port D
+		noInterrupts();
+		EICRA = _BV(ISC10) | _BV(ISC00);
+		EIFR = _BV(INTF1) | _BV(INTF0);
+		EIMSK |= _BV(INT1) | _BV(INT0);
+		PCMSK2 |= _BV(PCINT21) | _BV(PCINT20);
+		PCIFR = _BV(PCIF2);
+		PCICR |= _BV(PCIE2);
+		interrupts();
+
+#endif
+
+		// Set init flag
+		init_complete = true;
+	}
+}
+
+/**
+ * @brief Snapshots both wheels and updates count rate estimates (call once
+ * per sense step)
+ */
+void Encoder::update()
+{
+	// Snapshot ISR state
+	const uint8_t snapshot_retries = edges.read(snapshot);
+	retries = (retries > UINT16_MAX - snapshot_retries) ?
+		UINT16_MAX : retries + snapshot_retries;
+
+	// Estimate rates
+	for (uint8_t side = left; side <= right; side++)
+	{
+		const int32_t count = snapshot.counts[side];
+		const uint32_t stamp_edge = snapshot.stamps[side];
+		const int32_t counts_new = count - counts_prev[side];
+		if (counts_new != 0)
+		{
+			// Counts over time between last edges of each window
+			const uint32_t dt = stamp_edge - stamps_prev[side];
+#if defined(BALBOT_FIXED_POINT)
+			rates[side] = rate_q24(counts_new, dt);
+#else
+			rates[side] = (dt > 0) ? counts_new / (dt * Hal::stamp_res) : 0.0f;
+#endif
+			counts_prev[side] = count;
+			stamps_prev[side] = stamp_edge;
+		}
+		else
+		{
+			// Bound by one count since last edge
+			noInterrupts();
+			const uint32_t stamp_now = Hal::stamp();
+			interrupts();
+#if defined(BALBOT_FIXED_POINT)
+			const int32_t rate_max = rate_q24(1, stamp_now - stamps_prev[side]);
+#else
+			const float rate_max = 1.0f / ((stamp_now - stamps_prev[side]) * Hal::stamp_res);
+#endif
+			if (rates[side] > rate_max) rates[side] = rate_max;
+			else if (rates[side] < -rate_max) rates[side] = -rate_max;
+		}
+	}
+}
+
+/**
+ * @brief Returns edge state of both wheels at the last update()
+ */
+const Encoder::edges_t& Encoder::get_snapshot()
+{
+	return snapshot;
+}
+
+/**
+ * @brief Returns encoder count of given wheel at the last update() [cnt]
+ */
+int32_t Encoder::get_count(side_t side)
+{
+	return snapshot.counts[side];
+}
+
+#if defined(BALBOT_FIXED_POINT)
+
+/**
+ * @brief Returns count rate estimate of given wheel [cnt/s]
+ */
+float Encoder::get_rate(side_t side)
+{
+	return rates[side] * rate_scale;
+}
+
+/**
+ * @brief Returns count rate estimate of given wheel [cnt/stamp, Q8.24]
+ * 
+ * One count per stamp is far beyond any wheel speed, so the 24 fraction bits
+ * resolve 0.03 cnt/s. Scale by a precomputed [rad/cnt * cnt/stamp] constant
+ * to get a Q16.16 velocity with a single multiply.
+ */
+int32_t Encoder::get_rate_q24(side_t side)
+{
+	return rates[side];
+}
+
+/**
+ * @brief Returns counts / stamps [cnt/stamp, Q8.24] without division by zero
+ * 
+ * Windows of 128 counts or more, far beyond one sense step at full speed,
+ * drop to 16-bit quotient precision instead of overflowing.
+ */
+int32_t Encoder::rate_q24(int32_t counts, uint32_t stamps)
+{
+	if (stamps == 0) return 0;
+	const uint32_t n = (counts < 0) ? (0u - (uint32_t)counts) : (uint32_t)counts;
+	const uint32_t r = (n < 128) ? (n << 24) / stamps :
+		(n < 32768) ? ((n << 16) / stamps) << 8 : (uint32_t)INT32_MAX;
+	const int32_t rate = (r > (uint32_t)INT32_MAX) ? INT32_MAX : (int32_t)r;
+	return (counts < 0) ? -rate : rate;
+}
+
+#else
+
+/**
+ * @brief Returns count rate estimate of given wheel [cnt/s]
+ */
+float Encoder::get_rate(side_t side)
+{
+	return rates[side];
+}
+
+#endif
+
+/**
+ * @brief Returns number of snapshot reads retried because an edge ISR landed
+ * inside them (saturates)
+ */
+uint16_t Encoder::get_retries()
+{
+	return retries;
+}
+
+/**
+ * @brief Returns count change of transition to state_new and updates state
+ * 
+ * Invalid transitions (both channels changed) count as zero.
+ */
+inline int8_t Encoder::decode(uint8_t& state, uint8_t state_new)
+{
+	const int8_t delta = transitions[(state << 2) | state_new];
+	state = state_new;
+	return delta;
+}
+
+/**
+ * @brief Extracts left wheel state (A << 1 | B) from port D
+ */
+inline uint8_t Encoder::state_left(uint8_t pind)
+{
+	return ((pind >> 1) & 0x02) | ((pind >> 3) & 0x01);
+}
+
+/**
+ * @brief Extracts right wheel state (A << 1 | B) from port D
+ */
+inline uint8_t Encoder::state_right(uint8_t pind)
+{
+	return (pind >> 4) & 0x03;
+}
+
+/**
+ * @brief Left wheel edge ISR
+ */
+inline void Encoder::isr_left()
+{
+	edges_t& state = edges.write_begin();
+	state.counts[left] += decode(states[left], state_left(Hal::port_d_read()));
+	state.stamps[left] = Hal::stamp();
+	edges.write_end();
+}
+
+/**
+ * @brief Right wheel edge ISR
+ */
+inline void Encoder::isr_right()
+{
+	edges_t& state = edges.write_begin();
+	state.counts[right] += decode(states[right], state_right(Hal::port_d_read()));
+	state.stamps[right] = Hal::stamp();
+	edges.write_end();
+}
+
+#if !defined(PLATFORM_NATIVE)
+
+/**
+ * @brief Left wheel channel A and B ISRs
+ */
+ISR(INT0_vect)
+{
+	Encoder::isr_left();
+}
+ISR(INT1_vect, ISR_ALIASOF(INT0_vect));
+
+/**
+ * @brief Right wheel channel A and B ISR
+ */
+ISR(PCINT2_vect)
+{
+	Encoder::isr_right();
+}
+
+#endif
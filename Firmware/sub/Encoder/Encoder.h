@@ -0,0 +1,65 @@
+/**
+ * @file Encoder.h
+ * @brief Quadrature encoder driver for both drive motors
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * All four encoder channels sit on AVR port D (left A/B on pins 2/3, right
+ * B/A on pins 4/5). Each edge ISR reads both channels of its wheel with one
+ * PIND read and decodes the transition with a 16-entry table indexed by the
+ * previous and current 2-bit states. The left wheel uses INT0/INT1 and the
+ * right wheel uses PCINT2. Counts go up when channel A leads channel B.
+ *
+ * Each ISR also latches a Hal::stamp() of the edge. The counts and edge times
+ * of both wheels are published through one Seqlock, so update() takes a
+ * consistent snapshot of both wheels without masking the edge interrupts.
+ *
+ * Each edge costs 181 cycles for the left wheel and 176 for the right, about
+ * 11 us at 16 MHz. That includes the 7-cycle interrupt response and vector
+ * jump. The count is taken from an atmega328p listing of the two ISRs built
+ * with the LLVM 14 AVR backend at -O2, not from avr-gcc. Saving 15 registers
+ * and the 32-bit count and stamp writes take most of it. On the Uno, the
+ * "Encoder edge ISR" line of BENCH_SUBSYSTEMS times the INT0 vector itself.
+ *
+ * update() then estimates count rate with the M/T method: counts since the
+ * last update divided by the time between the last edges of each window. At
+ * high speed this is a count difference over almost exactly one period, and
+ * at low speed it becomes a period measurement between single edges. With no
+ * new edge the rate is bounded by one count over the time since the last
+ * edge, so it decays smoothly to zero instead of snapping. With
+ * BALBOT_FIXED_POINT the rate is an integer quotient in counts per stamp
+ * (get_rate_q24()) and only get_rate() converts it to float.
+ */
+#pragma once
+#include <stdint.h>
+
+/**
+ * Namespace Declaration
+ */
+namespace Encoder
+{
+	// Wheels
+	typedef enum
+	{
+		left = 0,
+		right,
+	}
+	side_t;
+
+	// Edge state of both wheels (written by ISRs)
+	typedef struct
+	{
+		int32_t counts[2];		// Encoder counts [cnt]
+		uint32_t stamps[2];		// Last edge times [Hal::stamp_res]
+	}
+	edges_t;
+
+	void init();
+	void update();
+	const edges_t& get_snapshot();
+	int32_t get_count(side_t side);
+	float get_rate(side_t side);
+#if defined(BALBOT_FIXED_POINT)
+	int32_t get_rate_q24(side_t side);
+#endif
+	uint16_t get_retries();
+}
@@ -0,0 +1,151 @@
+/**
+ * @file FastMath.cpp
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#include <FastMath.h>
+#include <Arduino.h>
+
+/**
+ * Namespace Definitions
+ */
+namespace FastMath
+{
+	// Angle constants
+	const float pi = 3.14159265f;
+	const float half_pi = 1.57079633f;
+	const float two_pi = 6.28318531f;
+	const float inv_two_pi = 0.15915494f;
+
+	// Table sizes
+	const uint16_t table_size = 129;	// Entries per table
+	const float sin_scale = (table_size - 1) / half_pi;
+	const float atan_scale = (table_size - 1);
+
+	/**
+	 * @brief Evaluates sin(x) for x in [0, pi/2] by Taylor series
+	 */
+	constexpr double sin_series(double x)
+	{
+		double term = x;
+		double sum = x;
+		for (int n = 1; n < 12; n++)
+		{
+			term *= -x * x / ((2 * n) * (2 * n + 1));
+			sum += term;
+		}
+		return sum;
+	}
+
+	/**
+	 * @brief Evaluates atan(t) for t in [0, 1] by Euler's series
+	 */
+	constexpr double atan_series(double t)
+	{
+		const double r = t * t / (1.0 + t * t);
+		double term = t / (1.0 + t * t);
+		double sum = term;
+		for (int n = 1; n < 48; n++)
+		{
+			term *= r * (2.0 * n) / (2.0 * n + 1.0);
+			sum += term;
+		}
+		return sum;
+	}
+
+	/**
+	 * @brief Lookup table of sin(x) on [0, pi/2]
+	 */
+	struct SinTable
+	{
+		constexpr SinTable() : v()
+		{
+			for (uint16_t i = 0; i < table_size; i++)
+			{
+				v[i] = (float)sin_series(1.5707963267948966 * i / (table_size - 1));
+			}
+		}
+		float v[table_size];
+	};
+
+	/**
+	 * @brief Lookup table of atan(t) on [0, 1]
+	 */
+	struct AtanTable
+	{
+		constexpr AtanTable() : v()
+		{
+			for (uint16_t i = 0; i < table_size; i++)
+			{
+				v[i] = (float)atan_series((double)i / (table_size - 1));
+			}
+		}
+		float v[table_size];
+	};
+
+	// Tables
+	constexpr SinTable sin_table PROGMEM = SinTable();
+	constexpr AtanTable atan_table PROGMEM = AtanTable();
+
+	// Private functions
+	float lerp(const float* table, float u);
+}
+
+/**
+ * @brief Sine of x [rad]
+ */
+float FastMath::sin(float x)
+{
+	// Reduce to [-pi, pi]
+	if (x > pi || x < -pi)
+	{
+		x -= two_pi * floorf((x + pi) * inv_two_pi);
+	}
+
+	// Fold to [0, pi/2]
+	const bool negative = (x < 0.0f);
+	if (negative) x = -x;
+	if (x > half_pi) x = pi - x;
+
+	// Interpolate table
+	const float y = lerp(sin_table.v, x * sin_scale);
+	return negative ? -y : y;
+}
+
+/**
+ * @brief Cosine of x [rad]
+ */
+float FastMath::cos(float x)
+{
+	return sin(x + half_pi);
+}
+
+/**
+ * @brief Four-quadrant arctangent of y / x [rad]
+ */
+float FastMath::atan2(float y, float x)
+{
+	// Reduce to first octant
+	const float ay = fabsf(y);
+	const float ax = fabsf(x);
+	if (ax == 0.0f && ay == 0.0f) return 0.0f;
+	const bool swap = (ay > ax);
+	const float t = swap ? (ax / ay) : (ay / ax);
+
+	// Interpolate table and unfold
+	float angle = lerp(atan_table.v, t * atan_scale);
+	if (swap) angle = half_pi - angle;
+	if (x < 0.0f) angle = pi - angle;
+	return (y < 0.0f) ? -angle : angle;
+}
+
+/**
+ * @brief Linearly interpolates program-memory table at index u
+ */
+float FastMath::lerp(const float* table, float u)
+{
+	uint16_t i = (uint16_t)u;
+	if (i > table_size - 2) i = table_size - 2;
+	const float y0 = pgm_read_float(table + i);
+	const float y1 = pgm_read_float(table + i + 1);
+	return y0 + (u - i) * (y1 - y0);
+}
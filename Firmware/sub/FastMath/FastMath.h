@@ -0,0 +1,26 @@
+/**
+ * @file FastMath.h
+ * @brief Table-driven trigonometry kernels for FPU-less targets
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * Sine and arctangent are read from 129-entry tables in program memory with
+ * linear interpolation. The tables are generated at compile time by constexpr
+ * series evaluation, so there is no startup cost or generator script.
+ *
+ * Worst-case absolute errors over the full input range:
+ * - sin, cos: 2.0e-5
+ * - atan2: 6.0e-6 rad
+ *
+ * test/test_fastmath sweeps both tables against libm to these bounds.
+ */
+#pragma once
+
+/**
+ * Namespace Declaration
+ */
+namespace FastMath
+{
+	float sin(float x);
+	float cos(float x);
+	float atan2(float y, float x);
+}
@@ -0,0 +1,131 @@
+/**
+ * @file Fixed.cpp
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#include <Fixed.h>
+
+/**
+ * Namespace Definitions
+ */
+namespace Fixed
+{
+	// Angle constants
+	const q16_t pi = to_q16(3.14159265f);
+	const q16_t half_pi = to_q16(1.57079633f);
+	const q16_t two_pi = to_q16(6.28318531f);
+	const q15_t inv_half_pi = to_q15(0.63661977f);
+
+	// atan(t) = t * poly(t^2) on [0, 1] [Q1.15]
+	const q15_t atan_c1 = to_q15(0.9998660f);
+	const q15_t atan_c3 = to_q15(-0.3302995f);
+	const q15_t atan_c5 = to_q15(0.1801410f);
+	const q15_t atan_c7 = to_q15(-0.0851330f);
+	const q15_t atan_c9 = to_q15(0.0208351f);
+
+	// sin(pi/2 * u) = u * poly(u^2) on [-1, 1] [Q2.14]
+	const q15_t sin_c1 = 25736;	// +1.5707963
+	const q15_t sin_c3 = -10583;	// -0.6459641
+	const q15_t sin_c5 = 1306;		// +0.0796926
+	const q15_t sin_c7 = -77;		// -0.0046818
+	const q15_t sin_c9 = 3;			// +0.0001604
+
+	// Private functions
+	uint32_t abs_u32(q16_t x);
+	q15_t atan_unit(q15_t t);
+}
+
+/**
+ * @brief Returns num / den in Q1.15 for num < den (saturates otherwise)
+ */
+Fixed::q15_t Fixed::ratio(uint32_t num, uint32_t den)
+{
+	if (num >= den) return q15_max;
+	while (den > 0xFFFF)
+	{
+		num >>= 1;
+		den >>= 1;
+	}
+	const uint32_t r = (num << 15) / den;
+	return (r > (uint32_t)q15_max) ? q15_max : (q15_t)r;
+}
+
+/**
+ * @brief Four-quadrant arctangent of y / x [rad]
+ *
+ * Octant reduction followed by a 9th-order odd polynomial for atan on [0, 1].
+ * Worst-case error is 1.0e-4 rad, dominated by Q1.15 rounding.
+ */
+Fixed::q16_t Fixed::atan2(q16_t y, q16_t x)
+{
+	const uint32_t ay = abs_u32(y);
+	const uint32_t ax = abs_u32(x);
+	if (ax == 0 && ay == 0) return 0;
+	const bool swap = ay > ax;
+	q16_t angle = q15_to_q16(atan_unit(swap ? ratio(ax, ay) : ratio(ay, ax)));
+	if (swap) angle = half_pi - angle;
+	if (x < 0) angle = pi - angle;
+	return (y < 0) ? -angle : angle;
+}
+
+/**
+ * @brief Sine of x [rad]
+ *
+ * Reduces x to [-pi/2, pi/2] and evaluates a 9th-order odd polynomial.
+ * Worst-case error is 1.5e-4, dominated by Q2.14 coefficient rounding.
+ */
+Fixed::q16_t Fixed::sin(q16_t x)
+{
+	// Reduce to [-pi, pi]
+	if (x > pi || x < -pi)
+	{
+		x %= two_pi;
+		if (x > pi) x -= two_pi;
+		else if (x < -pi) x += two_pi;
+	}
+
+	// Fold to [-pi/2, pi/2]
+	if (x > half_pi) x = pi - x;
+	else if (x < -half_pi) x = -pi - x;
+
+	// Normalize to u in [-1, 1] [Q1.15]
+	const q15_t u = q16_to_q15(mul(x, inv_half_pi));
+
+	// Horner evaluation [Q2.14]
+	const q15_t u2 = mul(u, u);
+	q15_t p = sin_c9;
+	p = sin_c7 + mul(u2, p);
+	p = sin_c5 + mul(u2, p);
+	p = sin_c3 + mul(u2, p);
+	p = sin_c1 + mul(u2, p);
+	return (q16_t)(((int32_t)u * p + 0x1000) >> 13);
+}
+
+/**
+ * @brief Cosine of x [rad]
+ */
+Fixed::q16_t Fixed::cos(q16_t x)
+{
+	return sin((x > 0) ? sub(x, two_pi - half_pi) : add(x, half_pi));
+}
+
+/**
+ * @brief Returns |x| as unsigned (exact for q16_min)
+ */
+uint32_t Fixed::abs_u32(q16_t x)
+{
+	return (x < 0) ? (0u - (uint32_t)x) : (uint32_t)x;
+}
+
+/**
+ * @brief Arctangent of t in [0, 1] [Q1.15]
+ */
+Fixed::q15_t Fixed::atan_unit(q15_t t)
+{
+	const q15_t t2 = mul(t, t);
+	q15_t p = atan_c9;
+	p = atan_c7 + mul(t2, p);
+	p = atan_c5 + mul(t2, p);
+	p = atan_c3 + mul(t2, p);
+	p = atan_c1 + mul(t2, p);
+	return mul(t, p);
+}
@@ -0,0 +1,209 @@
+/**
+ * @file Fixed.h
+ * @brief Saturating fixed-point arithmetic for FPU-less targets
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * Signals are stored in Q16.16 (q16_t) and unit-range values such as filter
+ * gains and trig results in Q1.15 (q15_t). Every multiply is built from
+ * 16x16-bit partial products so the AVR never calls the slow 64-bit libgcc
+ * routines, and host builds produce bit-identical results. All operations
+ * saturate instead of wrapping.
+ *
+ * Error bounds against double references are checked by test/test_fixed, and
+ * the closed-loop Imu and Controller outputs against the float build by
+ * test/test_chain. The cycle saving over soft-float on the AVR is not yet
+ * measured. On a host FPU (native_bench, x86-64) the integer chain is slower,
+ * about 120 vs 85 ns per Imu::update() and 35 vs 18 ns per
+ * Controller::update_balance(), so host timings say nothing about the Uno.
+ */
+#pragma once
+#include <stdint.h>
+
+/**
+ * Namespace Declaration
+ */
+namespace Fixed
+{
+	// Types
+	typedef int32_t q16_t;	// Q16.16 [-32768, 32768)
+	typedef int16_t q15_t;	// Q1.15 [-1, 1)
+
+	// Constants
+	const q16_t q16_max = 0x7FFFFFFF;
+	const q16_t q16_min = -q16_max - 1;
+	const q16_t q16_one = 0x00010000;
+	const q15_t q15_max = 0x7FFF;
+	const q15_t q15_min = -q15_max - 1;
+
+	/**
+	 * @brief Converts float to Q16.16 with rounding and saturation
+	 */
+	constexpr q16_t to_q16(float x)
+	{
+		return
+			(x >= 32767.0f) ? q16_max :
+			(x <= -32768.0f) ? q16_min :
+			(q16_t)(x * 65536.0f + (x >= 0.0f ? 0.5f : -0.5f));
+	}
+
+	/**
+	 * @brief Converts float to Q1.15 with rounding and saturation
+	 */
+	constexpr q15_t to_q15(float x)
+	{
+		return
+			(x >= 0.99997f) ? q15_max :
+			(x <= -1.0f) ? q15_min :
+			(q15_t)(x * 32768.0f + (x >= 0.0f ? 0.5f : -0.5f));
+	}
+
+	/**
+	 * @brief Converts Q16.16 to float
+	 */
+	inline float to_float(q16_t x)
+	{
+		return x * (1.0f / 65536.0f);
+	}
+
+	/**
+	 * @brief Converts Q1.15 to Q16.16
+	 */
+	inline q16_t q15_to_q16(q15_t x)
+	{
+		return (q16_t)x * 2;
+	}
+
+	/**
+	 * @brief Converts Q16.16 to Q1.15 with saturation
+	 */
+	inline q15_t q16_to_q15(q16_t x)
+	{
+		return
+			(x >= q16_one) ? q15_max :
+			(x <= -q16_one) ? q15_min : (q15_t)(x >> 1);
+	}
+
+	/**
+	 * @brief Saturating addition
+	 */
+	inline q16_t add(q16_t a, q16_t b)
+	{
+		q16_t r;
+		if (__builtin_add_overflow(a, b, &r)) return (a < 0) ? q16_min : q16_max;
+		return r;
+	}
+
+	/**
+	 * @brief Saturating unsigned addition
+	 */
+	inline uint32_t add(uint32_t a, uint32_t b)
+	{
+		uint32_t r;
+		if (__builtin_add_overflow(a, b, &r)) return 0xFFFFFFFF;
+		return r;
+	}
+
+	/**
+	 * @brief Saturating subtraction
+	 */
+	inline q16_t sub(q16_t a, q16_t b)
+	{
+		q16_t r;
+		if (__builtin_sub_overflow(a, b, &r)) return (a < 0) ? q16_min : q16_max;
+		return r;
+	}
+
+	/**
+	 * @brief Saturating negation
+	 */
+	inline q16_t neg(q16_t a)
+	{
+		return (a == q16_min) ? q16_max : -a;
+	}
+
+	/**
+	 * @brief Saturating absolute value
+	 */
+	inline q16_t abs(q16_t a)
+	{
+		return (a < 0) ? neg(a) : a;
+	}
+
+	/**
+	 * @brief Clamps x to range [lo, hi]
+	 */
+	inline q16_t clamp(q16_t x, q16_t lo, q16_t hi)
+	{
+		return (x < lo) ? lo : (x > hi) ? hi : x;
+	}
+
+	/**
+	 * @brief Saturating Q16.16 multiplication with rounding
+	 *
+	 * Computes (a * b) >> 16 from the four 16x16-bit partial products.
+	 */
+	inline q16_t mul(q16_t a, q16_t b)
+	{
+		const int16_t ah = (int16_t)(a >> 16);
+		const int16_t bh = (int16_t)(b >> 16);
+		const uint16_t al = (uint16_t)a;
+		const uint16_t bl = (uint16_t)b;
+		const int32_t hh = (int32_t)ah * bh;
+		const int32_t hl = (int32_t)ah * bl;
+		const int32_t lh = (int32_t)bh * al;
+		const uint32_t ll = (uint32_t)al * bl;
+		const uint32_t lo =
+			(uint32_t)(hl & 0xFFFF) +
+			(uint32_t)(lh & 0xFFFF) +
+			((ll + 0x8000u) >> 16);
+		const int32_t hi = hh + (hl >> 16) + (lh >> 16) + (int32_t)(lo >> 16);
+		if (hi > 0x7FFF) return q16_max;
+		if (hi < -0x8000) return q16_min;
+		return (q16_t)(((uint32_t)hi << 16) | (lo & 0xFFFF));
+	}
+
+	/**
+	 * @brief Saturating multiplication of Q16.16 by Q1.15 with rounding
+	 *
+	 * Computes (a * b) >> 15 from two 16x16-bit partial products.
+	 */
+	inline q16_t mul(q16_t a, q15_t b)
+	{
+		const int16_t ah = (int16_t)(a >> 16);
+		const uint16_t al = (uint16_t)a;
+		const int32_t hb = (int32_t)ah * b;
+		const int32_t lb = (int32_t)al * b;
+		q16_t r;
+		if (__builtin_add_overflow(hb, hb + ((lb + 0x4000) >> 15), &r))
+		{
+			return ((a < 0) != (b < 0)) ? q16_min : q16_max;
+		}
+		return r;
+	}
+
+	/**
+	 * @brief Saturating Q1.15 multiplication with rounding
+	 */
+	inline q15_t mul(q15_t a, q15_t b)
+	{
+		const int32_t r = ((int32_t)a * b + 0x4000) >> 15;
+		return (r > q15_max) ? q15_max : (q15_t)r;
+	}
+
+	/**
+	 * @brief Scales unsigned value by Q1.15 gain in [0, 1)
+	 */
+	inline uint32_t scale(uint32_t x, q15_t k)
+	{
+		const uint16_t xh = (uint16_t)(x >> 16);
+		const uint16_t xl = (uint16_t)x;
+		const uint16_t ku = (k < 0) ? 0 : (uint16_t)k;
+		return (((uint32_t)xh * ku) << 1) + (((uint32_t)xl * ku + 0x4000u) >> 15);
+	}
+
+	// Nonlinear functions
+	q15_t ratio(uint32_t num, uint32_t den);
+	q16_t atan2(q16_t y, q16_t x);
+	q16_t sin(q16_t x);
+	q16_t cos(q16_t x);
+}
@@ -0,0 +1,171 @@
+/**
+ * @file Gains.h
+ * @brief Compile-time model linearization and controller gain synthesis
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * Builds the linearized pitch-velocity model of the robot from MotorConfig
+ * and ModelConfig and places the closed-loop poles with Ackermann's formula.
+ * The yaw axis is first-order, so its proportional gain follows directly from
+ * the requested pole. Everything is constexpr, so the gains for the selected
+ * ES3011_BOT_ID are compile-time constants in Controller.cpp.
+ *
+ * The model state is [pitch, pitch velocity, linear velocity], matching the
+ * controller's measurements (MotorL and MotorR remove pitch from the encoder
+ * angle, so linear velocity is axle speed over ground). The input is the
+ * average motor voltage. Each motor applies Kt * (V - Kv * w) / R - b * w,
+ * where w is the wheel speed relative to the body, with rotor inertia
+ * reflected through tr^2.
+ *
+ * The design is continuous-time and ignores the one-period Imu pipeline, so
+ * keep the fastest pole well below the control frequency and check changes
+ * with the native_sim environment. With CTRL_PREDICTOR, Controller.cpp also
+ * uses A and B to carry the feedback states over the measured IMU latency,
+ * which adds delay margin at the same poles.
+ */
+#pragma once
+#include <MotorConfig.h>
+#include <ModelConfig.h>
+
+/**
+ * Namespace Declaration
+ */
+namespace Gains
+{
+	// Pitch-velocity state feedback (Controller.cpp k1, k2, k3)
+	typedef struct
+	{
+		double k1;	// Pitch velocity gain [V/(rad/s)]
+		double k2;	// Pitch gain [V/rad]
+		double k3;	// Linear velocity gain [V/(m/s)]
+	}
+	feedback_t;
+}
+
+/**
+ * Namespace Definitions
+ */
+namespace Gains
+{
+	// Drivetrain (both wheels)
+	constexpr double r = ModelConfig::r;
+	constexpr double Iw = 0.5 * ModelConfig::m * r * r;
+	constexpr double Jr = ModelConfig::J_rotor * MotorConfig::tr * MotorConfig::tr;
+	constexpr double kV = 2.0 * MotorConfig::Kt / MotorConfig::R;	// Torque per volt [N*m/V]
+	constexpr double kW = 2.0 * (MotorConfig::Kt * MotorConfig::Kv /
+		MotorConfig::R + ModelConfig::b);							// Torque per wheel rate [N*m/(rad/s)]
+
+	// Mass matrix [M11 -M12; -M12 M22] on axle travel and pitch
+	constexpr double M11 = ModelConfig::M + 2.0 * (ModelConfig::m + (Iw + Jr) / (r * r));
+	constexpr double M12 = ModelConfig::M * ModelConfig::l - 2.0 * Jr / r;
+	constexpr double M22 = ModelConfig::Ib + ModelConfig::M * ModelConfig::l * ModelConfig::l + 2.0 * Jr;
+	constexpr double det = M11 * M22 - M12 * M12;
+
+	// Accelerations per unit torque and per unit pitch
+	constexpr double a_p = (M12 / r + M11) / det;		// Pitch [rad/s^2/(N*m)]
+	constexpr double a_x = (M22 / r + M12) / det;		// Travel [m/s^2/(N*m)]
+	constexpr double g_det = ModelConfig::M * ModelConfig::g * ModelConfig::l / det;
+
+	// Linearized model dx/dt = A * x + B * u
+	// x = [pitch, pitch velocity, linear velocity], u = average voltage
+	// Wheel speed relative to body is linear velocity / r + pitch velocity
+	constexpr double A[3][3] = {
+		{0.0, 1.0, 0.0},
+		{M11 * g_det, -a_p * kW, -a_p * kW / r},
+		{M12 * g_det, -a_x * kW, -a_x * kW / r},
+	};
+	constexpr double B[3] = {0.0, a_p * kV, a_x * kV};
+
+	// Yaw axis
+	constexpr double Iz = ModelConfig::Iz + 2.0 * ModelConfig::d * ModelConfig::d *
+		(ModelConfig::m + (Iw + Jr) / (r * r));
+	constexpr double yaw_a = ModelConfig::d * ModelConfig::d * kW / (r * r * Iz);	// Yaw damping [1/s]
+	constexpr double yaw_b = ModelConfig::d * kV / (r * Iz);						// Yaw accel per volt [rad/(s^2*V)]
+
+	/**
+	 * @brief Returns pitch-velocity gains placing closed-loop poles at -p
+	 * @param p1 First pole magnitude [1/s]
+	 * @param p2 Second pole magnitude [1/s]
+	 * @param p3 Third pole magnitude [1/s]
+	 *
+	 * Ackermann's formula K = [0 0 1] * inv([B AB A^2B]) * phi(A), where phi is
+	 * the desired characteristic polynomial (s + p1)(s + p2)(s + p3).
+	 */
+	constexpr feedback_t place(double p1, double p2, double p3)
+	{
+		// Controllability matrix C = [B AB A^2B]
+		double C[3][3] = {};
+		for (int i = 0; i < 3; i++) C[i][0] = B[i];
+		for (int col = 1; col < 3; col++)
+			for (int i = 0; i < 3; i++)
+				for (int j = 0; j < 3; j++)
+					C[i][col] += A[i][j] * C[j][col - 1];
+
+		// Last row of inv(C) from cofactors
+		const double det_C =
+			C[0][0] * (C[1][1] * C[2][2] - C[1][2] * C[2][1]) -
+			C[0][1] * (C[1][0] * C[2][2] - C[1][2] * C[2][0]) +
+			C[0][2] * (C[1][0] * C[2][1] - C[1][1] * C[2][0]);
+		const double w[3] = {
+			(C[1][0] * C[2][1] - C[1][1] * C[2][0]) / det_C,
+			(C[0][1] * C[2][0] - C[0][0] * C[2][1]) / det_C,
+			(C[0][0] * C[1][1] - C[0][1] * C[1][0]) / det_C,
+		};
+
+		// phi(A) = A^3 + c2 * A^2 + c1 * A + c0 * I
+		const double c[3] = {p1 * p2 * p3, p1 * p2 + p2 * p3 + p1 * p3, p1 + p2 + p3};
+		double phi[3][3] = {};
+		double pow_A[3][3] = {};
+		for (int i = 0; i < 3; i++) pow_A[i][i] = 1.0;
+		for (int n = 0; n < 4; n++)
+		{
+			const double coef = (n < 3) ? c[n] : 1.0;
+			double next[3][3] = {};
+			for (int i = 0; i < 3; i++)
+			{
+				for (int j = 0; j < 3; j++)
+				{
+					phi[i][j] += coef * pow_A[i][j];
+					for (int k = 0; k < 3; k++) next[i][j] += pow_A[i][k] * A[k][j];
+				}
+			}
+			for (int i = 0; i < 3; i++)
+				for (int j = 0; j < 3; j++)
+					pow_A[i][j] = next[i][j];
+		}
+
+		// K = w * phi(A), state order [pitch, pitch velocity, linear velocity]
+		double K[3] = {};
+		for (int j = 0; j < 3; j++)
+			for (int i = 0; i < 3; i++)
+				K[j] += w[i] * phi[i][j];
+		const feedback_t fb = {K[1], K[0], K[2]};
+		return fb;
+	}
+
+	/**
+	 * @brief Returns voltage holding a linear velocity upright [V/(m/s)]
+	 */
+	constexpr double lin_vel_ff()
+	{
+		return kW / (kV * r);
+	}
+
+	/**
+	 * @brief Returns differential voltage holding a yaw velocity [V/(rad/s)]
+	 */
+	constexpr double yaw_vel_ff()
+	{
+		return yaw_a / yaw_b;
+	}
+
+	/**
+	 * @brief Returns yaw velocity proportional gain [V/(rad/s)]
+	 * @param pole Closed-loop yaw velocity pole [1/s]
+	 *
+	 * Returns zero if the open-loop yaw damping is already faster.
+	 */
+	constexpr double yaw_kp(double pole)
+	{
+		return (pole > yaw_a) ? (pole - yaw_a) / yaw_b : 0.0;
+	}
+}
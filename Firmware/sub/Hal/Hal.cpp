@@ -0,0 +1,421 @@
+/**
+ * @file Hal.cpp
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#include <Hal.h>
+#if defined(PLATFORM_NATIVE)
+	#include <Sim.h>
+	#include <Wire.h>
+#endif
+
+/**
+ * Namespace Definitions
+ */
+namespace Hal
+{
+	// I2C transaction
+	volatile bool i2c_active = false;	// Transaction in progress
+	volatile bool i2c_success = true;	// Last transaction acknowledged
+#if !defined(PLATFORM_NATIVE)
+	uint8_t i2c_address;				// Device address
+	uint8_t i2c_reg;					// Start register
+	uint8_t* i2c_data;					// Read or write data
+	volatile uint8_t i2c_size;			// Data size [bytes]
+	volatile uint8_t i2c_pos;			// Data position [bytes]
+	volatile bool i2c_reading;			// Read (true) or write (false)
+	volatile bool i2c_addressed;		// Register pointer sent
+	uint8_t i2c_write_data;				// Single-byte write buffer
+	void (*volatile i2c_done)() = nullptr;	// Read completion callback
+
+	// Private functions
+	void i2c_start(uint8_t address, uint8_t reg, uint8_t* data, uint8_t size, bool read);
+	void i2c_stop(bool success);
+#endif
+
+	// Serial
+	HardwareSerial* const serial = &Serial;
+
+	// Motor PWM
+	const uint8_t pin_pwm_a = 9;	// OC1A
+	const uint8_t pin_pwm_b = 10;	// OC1B
+	const uint16_t pwm_guard = 16;	// Counts around TOP to avoid [cnt]
+
+	// Periodic tick
+	void (*tick_isr)() = nullptr;
+	volatile uint32_t stamp_base = 0;
+
+#if !defined(PLATFORM_NATIVE)
+	// Pin-change interrupts (port B, pins 8-13)
+	const uint8_t pcint_first_pin = 8;
+	const uint8_t pcint_num_pins = 6;
+	void (*pcint_isrs[pcint_num_pins])() = {nullptr};
+	int pcint_modes[pcint_num_pins];
+	uint8_t pcint_levels = 0;
+#endif
+}
+
+/**
+ * @brief Initializes I2C bus at i2c_freq
+ */
+void Hal::i2c_init()
+{
+#if defined(PLATFORM_NATIVE)
+	Wire.begin();
+	Wire.setClock(i2c_freq);
+#else
+	pinMode(SDA, INPUT_PULLUP);
+	pinMode(SCL, INPUT_PULLUP);
+	TWSR = 0;
+	TWBR = ((F_CPU / i2c_freq) - 16) / 2;
+	TWCR = _BV(TWEN);
+#endif
+}
+
+/**
+ * @brief Writes value to device register (blocking)
+ * @return True if device acknowledged
+ */
+bool Hal::i2c_write(uint8_t address, uint8_t reg, uint8_t value)
+{
+#if defined(PLATFORM_NATIVE)
+	Wire.beginTransmission(address);
+	Wire.write(reg);
+	Wire.write(value);
+	i2c_success = (Wire.endTransmission() == 0);
+#else
+	while (i2c_active);
+	i2c_write_data = value;
+	i2c_start(address, reg, &i2c_write_data, 1, false);
+	while (i2c_active);
+#endif
+	return i2c_success;
+}
+
+/**
+ * @brief Reads size registers from device starting at reg (blocking)
+ * @return True if device acknowledged
+ */
+bool Hal::i2c_read(uint8_t address, uint8_t reg, uint8_t* data, uint8_t size)
+{
+	i2c_read_start(address, reg, data, size);
+	while (i2c_busy());
+	return i2c_ok();
+}
+
+/**
+ * @brief Starts background read of size registers from device at reg
+ * 
+ * Data must stay valid until i2c_busy() returns false. Waits for any previous
+ * transaction to finish first. If the read is acknowledged, done is called
+ * from the TWI interrupt (inline on a host) with i2c_busy() already false.
+ */
+void Hal::i2c_read_start(uint8_t address, uint8_t reg, uint8_t* data, uint8_t size,
+	void (*done)())
+{
+#if defined(PLATFORM_NATIVE)
+	Wire.beginTransmission(address);
+	Wire.write(reg);
+	i2c_success =
+		(Wire.endTransmission(false) == 0) &&
+		(Wire.requestFrom(address, size) == size);
+	for (uint8_t i = 0; i < size; i++)
+	{
+		data[i] = (uint8_t)Wire.read();
+	}
+	if (i2c_success && done) done();
+#else
+	while (i2c_active);
+	i2c_done = done;
+	i2c_start(address, reg, data, size, true);
+#endif
+}
+
+/**
+ * @brief Returns true while an I2C transaction is in progress
+ */
+bool Hal::i2c_busy()
+{
+	return i2c_active;
+}
+
+/**
+ * @brief Returns true if the last I2C transaction was acknowledged
+ */
+bool Hal::i2c_ok()
+{
+	return i2c_success;
+}
+
+/**
+ * @brief Configures pin as digital output
+ */
+void Hal::pin_init_output(uint8_t pin)
+{
+	pinMode(pin, OUTPUT);
+}
+
+/**
+ * @brief Sets digital output level
+ */
+void Hal::pin_write(uint8_t pin, bool level)
+{
+	digitalWrite(pin, level ? HIGH : LOW);
+}
+
+/**
+ * @brief Attaches ISR to edges of a digital input
+ * 
+ * Mode is CHANGE (default), RISING, or FALLING. On the Uno this serves pins
+ * 8-13 from the port B pin-change interrupt; pins 2-5 belong to Encoder.
+ */
+void Hal::attach_isr(uint8_t pin, void (*isr)(), int mode)
+{
+#if defined(PLATFORM_NATIVE)
+	attachInterrupt(digitalPinToInterrupt(pin), isr, mode);
+#else
+	const uint8_t bit = pin - pcint_first_pin;
+	if (bit >= pcint_num_pins) return;
+	noInterrupts();
+	pcint_isrs[bit] = isr;
+	pcint_modes[bit] = mode;
+	pcint_levels = PINB;
+	PCMSK0 |= _BV(bit);
+	PCIFR = _BV(PCIF0);
+	PCICR |= _BV(PCIE0);
+	interrupts();
+#endif
+}
+
+/**
+ * @brief Starts Timer1 phase-correct PWM at pwm_freq on pins 9 and 10
+ * 
+ * Mode 10 (TOP = ICR1) with no prescaler gives pwm_freq = 16 MHz / (2 * TOP)
+ * and pwm_top + 1 duty steps, so 20 kHz has 401 steps and 7.8 kHz has 1024.
+ * Both outputs start at zero duty.
+ */
+void Hal::pwm_init()
+{
+	pin_init_output(pin_pwm_a);
+	pin_init_output(pin_pwm_b);
+#if defined(PLATFORM_NATIVE)
+	pwm_write_pair(0, 0);
+#else
+	noInterrupts();
+	TCCR1B = 0;
+	TCNT1 = 0;
+	ICR1 = pwm_top;
+	OCR1A = 0;
+	OCR1B = 0;
+	TCCR1A = _BV(COM1A1) | _BV(COM1B1) | _BV(WGM11);
+	TCCR1B = _BV(WGM13) | _BV(CS10);
+	interrupts();
+#endif
+}
+
+/**
+ * @brief Sets duty of pins 9 and 10 [0, pwm_top] for the same PWM period
+ * 
+ * OCR1A and OCR1B are double-buffered and latch at TOP. Both are written in
+ * one critical section outside a short guard band around TOP, so they never
+ * latch in different periods. The wait is at most 2 * pwm_guard timer counts
+ * (2 us).
+ */
+void Hal::pwm_write_pair(uint16_t duty_9, uint16_t duty_10)
+{
+	if (duty_9 > pwm_top) duty_9 = pwm_top;
+	if (duty_10 > pwm_top) duty_10 = pwm_top;
+#if defined(PLATFORM_NATIVE)
+	Sim::set_pwm(pin_pwm_a, (float)duty_9 / pwm_top);
+	Sim::set_pwm(pin_pwm_b, (float)duty_10 / pwm_top);
+#else
+	noInterrupts();
+	while (TCNT1 > pwm_top - pwm_guard);
+	OCR1A = duty_9;
+	OCR1B = duty_10;
+	interrupts();
+#endif
+}
+
+/**
+ * @brief Returns microseconds since startup
+ */
+uint32_t Hal::micros()
+{
+	return ::micros();
+}
+
+/**
+ * @brief Calls isr at tick_freq from a timer interrupt
+ * 
+ * On the Uno this runs Timer2 in CTC mode at 16 MHz / 32 / 250 = 2 kHz, which
+ * divides evenly into every supported control rate. Timer2 is otherwise only
+ * used for PWM on pins 3 and 11, which BalBot does not use.
+ */
+void Hal::tick_start(void (*isr)())
+{
+	tick_isr = isr;
+#if defined(PLATFORM_NATIVE)
+	Sim::start_timer(1000000ul / tick_freq, isr);
+#else
+	noInterrupts();
+	TCCR2A = _BV(WGM21);
+	TCCR2B = _BV(CS21) | _BV(CS20);
+	TCNT2 = 0;
+	OCR2A = 249;
+	TIFR2 = _BV(OCF2A);
+	TIMSK2 = _BV(OCIE2A);
+	interrupts();
+#endif
+}
+
+/**
+ * @brief Stops program execution
+ * 
+ * Spins forever on the Uno, and exits the process on a host so that native
+ * diagnostic builds terminate.
+ */
+void Hal::halt()
+{
+	serial->flush();
+#if defined(PLATFORM_NATIVE)
+	exit(0);
+#else
+	while(1);
+#endif
+}
+
+#if !defined(PLATFORM_NATIVE)
+
+/**
+ * @brief Starts interrupt-driven TWI transaction
+ * 
+ * Writes reg, then either writes data or issues a repeated start and reads
+ * data. The TWI ISR advances the transaction one bus event at a time.
+ */
+void Hal::i2c_start(uint8_t address, uint8_t reg, uint8_t* data, uint8_t size, bool read)
+{
+	while (TWCR & _BV(TWSTO));
+	i2c_address = address;
+	i2c_reg = reg;
+	i2c_data = data;
+	i2c_size = size;
+	i2c_pos = 0;
+	i2c_reading = read;
+	i2c_addressed = false;
+	i2c_active = true;
+	TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWIE) | _BV(TWSTA);
+}
+
+/**
+ * @brief Sends stop condition, ends transaction and runs read callback
+ */
+void Hal::i2c_stop(bool success)
+{
+	TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWSTO);
+	i2c_success = success;
+	i2c_active = false;
+	void (*done)() = i2c_done;
+	i2c_done = nullptr;
+	if (success && done) done();
+}
+
+/**
+ * @brief TWI state machine ISR
+ */
+ISR(TWI_vect)
+{
+	using namespace Hal;
+	const uint8_t twcr_next = _BV(TWINT) | _BV(TWEN) | _BV(TWIE);
+	switch (TWSR & 0xF8)
+	{
+		// Start or repeated start sent
+		case 0x08:
+		case 0x10:
+			TWDR = (i2c_address << 1) | (i2c_addressed ? 1 : 0);
+			TWCR = twcr_next;
+			break;
+
+		// SLA+W acknowledged
+		case 0x18:
+			TWDR = i2c_reg;
+			TWCR = twcr_next;
+			break;
+
+		// Data byte sent and acknowledged
+		case 0x28:
+			if (!i2c_addressed)
+			{
+				i2c_addressed = true;
+				if (i2c_reading)
+				{
+					TWCR = twcr_next | _BV(TWSTA);
+					break;
+				}
+			}
+			if (i2c_pos < i2c_size)
+			{
+				TWDR = i2c_data[i2c_pos++];
+				TWCR = twcr_next;
+			}
+			else
+			{
+				i2c_stop(true);
+			}
+			break;
+
+		// SLA+R acknowledged
+		case 0x40:
+			TWCR = (i2c_size > 1) ? (twcr_next | _BV(TWEA)) : twcr_next;
+			break;
+
+		// Data byte received and acknowledged
+		case 0x50:
+			i2c_data[i2c_pos++] = TWDR;
+			TWCR = (i2c_pos < i2c_size - 1) ? (twcr_next | _BV(TWEA)) : twcr_next;
+			break;
+
+		// Last data byte received
+		case 0x58:
+			i2c_data[i2c_pos++] = TWDR;
+			i2c_stop(true);
+			break;
+
+		// NACK, arbitration lost, or bus error
+		default:
+			i2c_stop(false);
+			break;
+	}
+}
+
+/**
+ * @brief Port B pin-change ISR which dispatches edges to attached ISRs
+ */
+ISR(PCINT0_vect)
+{
+	using namespace Hal;
+	const uint8_t levels = PINB;
+	const uint8_t changed = (levels ^ pcint_levels) & PCMSK0;
+	pcint_levels = levels;
+	for (uint8_t bit = 0; bit < pcint_num_pins; bit++)
+	{
+		const uint8_t mask = _BV(bit);
+		if (!(changed & mask)) continue;
+		const int mode = pcint_modes[bit];
+		const bool rising = levels & mask;
+		if ((mode == CHANGE) || (mode == RISING && rising) || (mode == FALLING && !rising))
+		{
+			pcint_isrs[bit]();
+		}
+	}
+}
+
+/**
+ * @brief Timer2 compare-match ISR
+ */
+ISR(TIMER2_COMPA_vect)
+{
+	Hal::stamp_base += 250;
+	Hal::tick_isr();
+}
+
+#endif
\ No newline at end of file
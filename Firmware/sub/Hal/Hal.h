@@ -0,0 +1,106 @@
+/**
+ * @file Hal.h
+ * @brief Hardware abstraction layer for BalBot subsystems
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * All subsystem access to I2C, GPIO and pin interrupts, PWM, serial, the
+ * system clock, and the periodic tick goes through this namespace. On the Uno
+ * it maps onto the Arduino core (and the AVR registers where the core has no
+ * non-blocking interface), and with PLATFORM_NATIVE it maps onto the Linux
+ * stand-ins in Firmware/native so the full firmware can run on a host.
+ *
+ * I2C register reads can run in the background: i2c_read_start() returns
+ * immediately and the TWI interrupt fills the buffer while the caller works.
+ * An optional done callback runs from the TWI interrupt when the read is
+ * acknowledged, and may start a follow-on read to chain transfers without
+ * the caller. On a host the read (and callback) completes before
+ * i2c_read_start() returns.
+ */
+#pragma once
+#include <Arduino.h>
+
+/**
+ * Namespace Declaration
+ */
+namespace Hal
+{
+	// I2C
+	const uint32_t i2c_freq = 400000;	// Bus clock [Hz]
+	void i2c_init();
+	bool i2c_write(uint8_t address, uint8_t reg, uint8_t value);
+	bool i2c_read(uint8_t address, uint8_t reg, uint8_t* data, uint8_t size);
+	void i2c_read_start(uint8_t address, uint8_t reg, uint8_t* data, uint8_t size,
+		void (*done)() = nullptr);
+	bool i2c_busy();
+	bool i2c_ok();
+
+	// Serial
+	extern HardwareSerial* const serial;
+
+	// GPIO
+	void pin_init_output(uint8_t pin);
+	void pin_write(uint8_t pin, bool level);
+	void attach_isr(uint8_t pin, void (*isr)(), int mode = CHANGE);
+
+	/**
+	 * @brief Returns levels of digital pins 0-7 as one byte (bit n = pin n)
+	 */
+	inline uint8_t port_d_read()
+	{
+#if defined(PLATFORM_NATIVE)
+		uint8_t levels = 0;
+		for (uint8_t pin = 0; pin < 8; pin++)
+		{
+			if (digitalRead(pin)) levels |= (1 << pin);
+		}
+		return levels;
+#else
+		return PIND;
+#endif
+	}
+
+	// Motor PWM (Timer1 phase-correct on pins 9 and 10)
+	const uint32_t cpu_freq = 16000000;	// Timer1 clock [Hz]
+#if defined(MOTOR_PWM_HZ)
+	const uint32_t pwm_freq = MOTOR_PWM_HZ;	// PWM frequency [Hz]
+#else
+	const uint32_t pwm_freq = 20000;		// PWM frequency [Hz]
+#endif
+	constexpr uint16_t pwm_top = cpu_freq / (2 * pwm_freq);	// Full duty [cnt]
+	static_assert(pwm_top >= 255 && pwm_top <= 1023,
+		"MOTOR_PWM_HZ must give 8 to 10 bits of duty (7.8-31 kHz)");
+	void pwm_init();
+	void pwm_write_pair(uint16_t duty_9, uint16_t duty_10);
+
+	// Clock
+	uint32_t micros();
+
+	// Periodic tick
+	const uint16_t tick_freq = 2000;	// Tick frequency [Hz]
+	void tick_start(void (*isr)());
+
+	// Tick timer timestamps
+	constexpr float stamp_res = 2.0e-6f;	// Timestamp resolution [s]
+	extern volatile uint32_t stamp_base;
+
+	/**
+	 * @brief Returns tick timer timestamp [stamp_res]
+	 * 
+	 * Reads Timer2 directly so it is cheap enough for edge ISRs. Must be
+	 * called with interrupts disabled. Only advances once tick_start() runs.
+	 */
+	inline uint32_t stamp()
+	{
+#if defined(PLATFORM_NATIVE)
+		return ::micros() / 2;
+#else
+		const uint8_t count = TCNT2;
+		uint32_t base = stamp_base;
+		if ((TIFR2 & _BV(OCF2A)) && count < 125) base += 250;
+		return base + count;
+#endif
+	}
+
+	// Program control
+	void halt();
+}
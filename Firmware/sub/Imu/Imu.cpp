@@ -3,27 +3,106 @@
  * @author Dan Oates (WPI Class of 2020)
  */
 #include <Imu.h>
+#include <ImuCal.h>
 #include <ImuConfig.h>
-#include <MPU6050.h>
-#include <Controller.h>
-#include <DigitalOut.h>
+#include <RateConfig.h>
+#include <Mpu.h>
+#include <Hal.h>
 #include <GRV.h>
-using Controller::t_ctrl;
+#if defined(IMU_FAST_MATH)
+	#include <FastMath.h>
+#endif
+using RateConfig::t_sense;
+#if defined(BALBOT_FIXED_POINT)
+	using namespace Fixed;
+#endif
+#if defined(IMU_KALMAN) && defined(BALBOT_FIXED_POINT)
+	#error "IMU_KALMAN applies to the float estimator only"
+#endif
 
 namespace Imu
 {
-	// IMU Hardware Interface
-	TwoWire* const wire = &Wire;
-	MPU6050 imu(wire);
+	// Calibration
+#if defined(MPU6050_CAL_SAMPLES)
+	const uint16_t cal_samples = MPU6050_CAL_SAMPLES;
+#else
+	const uint16_t cal_samples = 100;
+#endif
 
 	// State Variables
 	bool first_frame = true;
+	bool i2c_ok = true;			// Last IMU read acknowledged
+#if defined(BALBOT_FIXED_POINT)
+	q16_t pitch = 0;			// Pitch estimate [rad]
+	q16_t pitch_vel = 0;		// Pitch velocity [rad/s]
+	q16_t yaw_vel = 0;			// Yaw velocity [rad/s]
+	q15_t pitch_cos = q15_max;	// Cosine of pitch estimate
+	q15_t pitch_sin = 0;		// Sine of pitch estimate
+	constexpr q16_t t_sense_q16 = to_q16(t_sense);	// Sense period [s]
+	constexpr q16_t gyr_scale_q16 =
+		to_q16(Mpu::gyr_scale * 65536.0f);			// Gyro scale [(rad/s)/LSB * 2^16]
+	q16_t gyr_x_cal_q16;		// Gyro x offset [rad/s]
+	q16_t gyr_y_cal_q16;		// Gyro y offset [rad/s]
+	q16_t gyr_z_cal_q16;		// Gyro z offset [rad/s]
+
+	// Variances [var_unit]
+	// var_unit is chosen so that one step of gyro integration adds gyr_var,
+	// keeping every variance in the loop well inside 32 bits.
+	const uint32_t gyr_var = 256;	// Gyro integration variance
+	uint32_t pitch_var;				// Pitch estimate variance
+	uint32_t acc_y_var;				// Y-accel variance / g^2
+	uint32_t acc_z_var;				// Z-accel variance / g^2
+	const float g = 9.81f;			// Gravity [m/s^2]
+
+	// Private Functions
+	uint32_t to_var_units(float var, float var_unit);
+	q16_t to_gyr_q16(int16_t gyr, q16_t gyr_cal);
+#elif defined(IMU_KALMAN)
+	float pitch = 0.0f;			// Pitch estimate [rad]
+	float pitch_vel = 0.0f;		// Pitch velocity [rad/s]
+	float gyr_bias = 0.0f;		// Gyro x bias beyond gyr_x_cal [rad/s]
+	float yaw_vel;				// Yaw velocity [rad/s]
+
+	// Kalman model and steady-state gain
+	// Larger bias walk lets acceleration-corrupted pitch leak into the bias
+	const float gyr_bias_walk = 1.0e-5f;	// Gyro bias random walk [(rad/s)/sqrt(s)]
+	const float g = 9.81f;					// Gravity [m/s^2]
+	float k_pitch;							// Pitch gain
+	float k_bias;							// Gyro bias gain [1/s]
+	bool gain_ready = false;				// Gain matches calibrated variances
+#if defined(IMU_KALMAN_FULL)
+	// Covariance [pitch, bias] until the gain reaches steady state
+	// Early gains are large, so hold the robot still until gain_steady
+	const float gyr_bias_std_init = 0.002f;	// Initial bias uncertainty [rad/s]
+	const float gain_tol = 0.01f;			// Relative gain tolerance
+	float k_pitch_ss, k_bias_ss;			// Steady-state gains
+	float P_pp, P_pb, P_bb;					// Posterior covariance
+	bool gain_steady = false;
+#endif
+
+	// 2x2 matrix [a b; c d]
+	typedef struct
+	{
+		float a, b, c, d;
+	}
+	mat2_t;
+
+	// Private Functions
+	void kalman_init();
+	mat2_t mat2_add(const mat2_t& x, const mat2_t& y);
+	mat2_t mat2_mul(const mat2_t& x, const mat2_t& y);
+	mat2_t mat2_tr(const mat2_t& x);
+	mat2_t mat2_inv(const mat2_t& x);
+#else
 	GRV pitch, pitch_vel;
 	float yaw_vel;
+#endif
+
+	// Private Functions
+	void load_cal();
 
 	// Error LED
 	const uint8_t pin_led = 13;
-	DigitalOut led(pin_led);
 
 	// Init Flag
 	bool init_complete = false;
@@ -36,16 +115,15 @@ void Imu::init()
 {
 	if (!init_complete)
 	{
-		// Init I2CC
-		wire->begin();
-
 		// Init IMU
-		bool success = imu.init();
-		led = !success;
-		if (!success) while(1);
-		imu.gyr_x_cal = ImuConfig::gyr_x_cal;
-		imu.gyr_y_cal = ImuConfig::gyr_y_cal;
-		imu.gyr_z_cal = ImuConfig::gyr_z_cal;
+		bool success = Mpu::init();
+		Hal::pin_init_output(pin_led);
+		Hal::pin_write(pin_led, !success);
+		if (!success) Hal::halt();
+
+		// Load calibration (or wait for boot calibration)
+		ImuCal::init();
+		if (ImuCal::is_ready()) load_cal();
 
 		// Set init flag
 		init_complete = true;
@@ -58,17 +136,146 @@ void Imu::init()
 void Imu::update()
 {
 	// Get new readings from IMU
-	imu.update();
-	const float acc_y = imu.get_acc_y();
-	const float acc_z = imu.get_acc_z();
-	const float gyr_x = imu.get_gyr_x();
-	const float gyr_y = imu.get_gyr_y();
-	const float gyr_z = imu.get_gyr_z();
+	i2c_ok = Mpu::update();
+	const Mpu::frame_t& frame = Mpu::get_frame();
+
+	// Track calibration, holding estimates until it is ready
+	if (ImuCal::update(frame)) load_cal();
+	if (!ImuCal::is_ready()) return;
+
+#if defined(BALBOT_FIXED_POINT)
+
+	// Convert readings
+	// Accels stay in LSB since only their ratio is used
+	const q16_t acc_y = frame.acc_y;
+	const q16_t acc_z = frame.acc_z;
+	const q16_t gyr_x = to_gyr_q16(frame.gyr_x, gyr_x_cal_q16);
+	const q16_t gyr_y = to_gyr_q16(frame.gyr_y, gyr_y_cal_q16);
+	const q16_t gyr_z = to_gyr_q16(frame.gyr_z, gyr_z_cal_q16);
 
 	// Estimate pitch from accelerometer
-	GRV grv_acc_y(acc_y, ImuConfig::acc_y_var);
-	GRV grv_acc_z(acc_z, ImuConfig::acc_z_var);
+	// Variance of atan2 linearized about the last pitch estimate
+	const q16_t pitch_acc = Fixed::atan2(acc_y, acc_z);
+	const uint32_t pitch_acc_var = add(
+		scale(acc_y_var, mul(pitch_cos, pitch_cos)),
+		scale(acc_z_var, mul(pitch_sin, pitch_sin)));
+
+	// Check special first frame condition
+	if(first_frame)
+	{
+		// Use accelerometer only
+		first_frame = false;
+		pitch = pitch_acc;
+		pitch_var = pitch_acc_var;
+	}
+	else
+	{
+		// Fuse accelerometer and gyro integration
+		pitch_vel = gyr_x;
+		const q16_t pitch_gyr = add(pitch, mul(pitch_vel, t_sense_q16));
+		const uint32_t pitch_gyr_var = add(pitch_var, gyr_var);
+		const q15_t k = ratio(pitch_gyr_var, add(pitch_gyr_var, pitch_acc_var));
+		pitch = add(pitch_gyr, mul(sub(pitch_acc, pitch_gyr), k));
+		pitch_var = pitch_gyr_var - scale(pitch_gyr_var, k);
+	}
+
+	// Yaw velocity estimation
+	pitch_cos = q16_to_q15(Fixed::cos(pitch));
+	pitch_sin = q16_to_q15(Fixed::sin(pitch));
+	yaw_vel = add(mul(gyr_z, pitch_cos), mul(gyr_y, pitch_sin));
+
+#elif defined(IMU_KALMAN)
+
+	// Convert readings
+	const ImuCal::cal_t& cal = ImuCal::get_cal();
+	const float acc_y = frame.acc_y * Mpu::acc_scale;
+	const float acc_z = frame.acc_z * Mpu::acc_scale;
+	const float gyr_x = frame.gyr_x * Mpu::gyr_scale - cal.gyr_cal[0];
+	const float gyr_y = frame.gyr_y * Mpu::gyr_scale - cal.gyr_cal[1];
+	const float gyr_z = frame.gyr_z * Mpu::gyr_scale - cal.gyr_cal[2];
+
+	// Estimate pitch from accelerometer
+#if defined(IMU_FAST_MATH)
+	const float pitch_acc = FastMath::atan2(acc_y, acc_z);
+#else
+	const float pitch_acc = atan2f(acc_y, acc_z);
+#endif
+
+	// Check special first frame condition
+	if (first_frame)
+	{
+		// Use accelerometer only
+		first_frame = false;
+		pitch = pitch_acc;
+	}
+	else
+	{
+#if defined(IMU_KALMAN_FULL)
+		// Propagate covariance until the gain settles
+		if (!gain_steady)
+		{
+			const float q_pitch = cal.gyr_var[0] * t_sense * t_sense;
+			const float q_bias = gyr_bias_walk * gyr_bias_walk * t_sense;
+			const float r_acc = cal.acc_var[1] / (g * g);
+			const float pp = P_pp - t_sense * (2.0f * P_pb - t_sense * P_bb) + q_pitch;
+			const float pb = P_pb - t_sense * P_bb;
+			const float bb = P_bb + q_bias;
+			const float k_p = pp / (pp + r_acc);
+			const float k_b = pb / (pp + r_acc);
+			P_pp = (1.0f - k_p) * pp;
+			P_pb = (1.0f - k_p) * pb;
+			P_bb = bb - k_b * pb;
+			gain_steady =
+				fabsf(k_p - k_pitch_ss) <= gain_tol * k_pitch_ss &&
+				fabsf(k_b - k_bias_ss) <= gain_tol * fabsf(k_bias_ss);
+			k_pitch = gain_steady ? k_pitch_ss : k_p;
+			k_bias = gain_steady ? k_bias_ss : k_b;
+		}
+#endif
+
+		// Predict with bias-corrected gyro, correct with accelerometer
+		pitch_vel = gyr_x - gyr_bias;
+		const float pitch_gyr = pitch + pitch_vel * t_sense;
+		const float innovation = pitch_acc - pitch_gyr;
+		pitch = pitch_gyr + k_pitch * innovation;
+		gyr_bias += k_bias * innovation;
+	}
+
+	// Yaw velocity estimation
+#if defined(IMU_FAST_MATH)
+	yaw_vel =
+		gyr_z * FastMath::cos(pitch) +
+		gyr_y * FastMath::sin(pitch);
+#else
+	yaw_vel =
+		gyr_z * cosf(pitch) +
+		gyr_y * sinf(pitch);
+#endif
+
+#else
+
+	// Convert readings
+	const ImuCal::cal_t& cal = ImuCal::get_cal();
+	const float acc_y = frame.acc_y * Mpu::acc_scale;
+	const float acc_z = frame.acc_z * Mpu::acc_scale;
+	const float gyr_x = frame.gyr_x * Mpu::gyr_scale - cal.gyr_cal[0];
+	const float gyr_y = frame.gyr_y * Mpu::gyr_scale - cal.gyr_cal[1];
+	const float gyr_z = frame.gyr_z * Mpu::gyr_scale - cal.gyr_cal[2];
+
+	// Estimate pitch from accelerometer
+#if defined(IMU_FAST_MATH)
+	const float acc_y_sq = acc_y * acc_y;
+	const float acc_z_sq = acc_z * acc_z;
+	const float acc_yz_sq = acc_y_sq + acc_z_sq;
+	GRV pitch_acc(
+		FastMath::atan2(acc_y, acc_z),
+		(acc_z_sq * cal.acc_var[1] + acc_y_sq * cal.acc_var[2]) /
+		(acc_yz_sq * acc_yz_sq));
+#else
+	GRV grv_acc_y(acc_y, cal.acc_var[1]);
+	GRV grv_acc_z(acc_z, cal.acc_var[2]);
 	GRV pitch_acc = atan2(grv_acc_y, grv_acc_z);
+#endif
 
 	// Check special first frame condition
 	if(first_frame)
@@ -80,17 +287,183 @@ void Imu::update()
 	else
 	{
 		// Fuse accelerometer and gyro integration
-		pitch_vel = GRV(gyr_x, ImuConfig::gyr_x_var);
-		GRV pitch_gyr = pitch + pitch_vel * t_ctrl;
+		pitch_vel = GRV(gyr_x, cal.gyr_var[0]);
+		GRV pitch_gyr = pitch + pitch_vel * t_sense;
 		pitch = fuse(pitch_gyr, pitch_acc);
 	}
 
 	// Yaw velocity estimation
+#if defined(IMU_FAST_MATH)
+	yaw_vel =
+		gyr_z * FastMath::cos(pitch.mean) +
+		gyr_y * FastMath::sin(pitch.mean);
+#else
 	yaw_vel =
 		gyr_z * cosf(pitch.mean) +
 		gyr_y * sinf(pitch.mean);
+#endif
+
+#endif
 }
 
+#if defined(BALBOT_FIXED_POINT)
+
+/**
+ * @brief Returns IMU pitch estimate computed via Kalman filter
+ */
+float Imu::get_pitch()
+{
+	return to_float(pitch);
+}
+
+/**
+ * @brief Returns IMU pitch velocity measurement
+ */
+float Imu::get_pitch_vel()
+{
+	return to_float(pitch_vel);
+}
+
+/**
+ * @brief Returns IMU yaw velocity estimate
+ */
+float Imu::get_yaw_vel()
+{
+	return to_float(yaw_vel);
+}
+
+/**
+ * @brief Returns IMU pitch estimate [rad, Q16.16]
+ */
+q16_t Imu::get_pitch_q16()
+{
+	return pitch;
+}
+
+/**
+ * @brief Returns IMU pitch velocity measurement [rad/s, Q16.16]
+ */
+q16_t Imu::get_pitch_vel_q16()
+{
+	return pitch_vel;
+}
+
+/**
+ * @brief Returns IMU yaw velocity estimate [rad/s, Q16.16]
+ */
+q16_t Imu::get_yaw_vel_q16()
+{
+	return yaw_vel;
+}
+
+/**
+ * @brief Converts variance to var_unit with saturation
+ */
+uint32_t Imu::to_var_units(float var, float var_unit)
+{
+	const float units = var / var_unit;
+	return (units < 1.0e9f) ? (uint32_t)units : 1000000000ul;
+}
+
+/**
+ * @brief Converts raw gyro reading to calibrated rate [rad/s, Q16.16]
+ */
+q16_t Imu::to_gyr_q16(int16_t gyr, q16_t gyr_cal)
+{
+	return sub(mul((q16_t)gyr, gyr_scale_q16), gyr_cal);
+}
+
+#elif defined(IMU_KALMAN)
+
+/**
+ * @brief Returns IMU pitch estimate computed via Kalman filter
+ */
+float Imu::get_pitch()
+{
+	return pitch;
+}
+
+/**
+ * @brief Returns bias-corrected IMU pitch velocity
+ */
+float Imu::get_pitch_vel()
+{
+	return pitch_vel;
+}
+
+/**
+ * @brief Returns IMU yaw velocity estimate
+ */
+float Imu::get_yaw_vel()
+{
+	return yaw_vel;
+}
+
+/**
+ * @brief Computes the steady-state Kalman gain
+ * 
+ * The model is pitch[k+1] = pitch[k] + (gyr_x - bias) * t_sense with a
+ * random-walk bias, observed through the accelerometer pitch with variance
+ * acc_y_var / g^2 (linearized about level). The prior covariance solves the
+ * filter Riccati equation, found by the structure-preserving doubling
+ * algorithm: each pass squares the closed-loop transition, so 20 passes
+ * cover 2^20 frames of covariance propagation.
+ */
+void Imu::kalman_init()
+{
+	const ImuCal::cal_t& cal = ImuCal::get_cal();
+	const float q_pitch = cal.gyr_var[0] * t_sense * t_sense;
+	const float q_bias = gyr_bias_walk * gyr_bias_walk * t_sense;
+	const float r_acc = cal.acc_var[1] / (g * g);
+	const mat2_t I = {1.0f, 0.0f, 0.0f, 1.0f};
+	mat2_t A = {1.0f, 0.0f, -t_sense, 1.0f};		// Transition transpose
+	mat2_t G = {1.0f / r_acc, 0.0f, 0.0f, 0.0f};	// H' R^-1 H
+	mat2_t H = {q_pitch, 0.0f, 0.0f, q_bias};		// Converges to prior covariance
+	for (uint8_t i = 0; i < 20; i++)
+	{
+		const mat2_t W = mat2_inv(mat2_add(I, mat2_mul(G, H)));
+		const mat2_t WA = mat2_mul(W, A);
+		const mat2_t G_next = mat2_add(G, mat2_mul(A, mat2_mul(W, mat2_mul(G, mat2_tr(A)))));
+		H = mat2_add(H, mat2_mul(mat2_tr(A), mat2_mul(H, WA)));
+		A = mat2_mul(A, WA);
+		G = G_next;
+	}
+	k_pitch = H.a / (H.a + r_acc);
+	k_bias = H.c / (H.a + r_acc);
+#if defined(IMU_KALMAN_FULL)
+	k_pitch_ss = k_pitch;
+	k_bias_ss = k_bias;
+	P_pp = r_acc;
+	P_pb = 0.0f;
+	P_bb = gyr_bias_std_init * gyr_bias_std_init;
+#endif
+}
+
+/**
+ * @brief 2x2 matrix helpers for kalman_init()
+ */
+Imu::mat2_t Imu::mat2_add(const mat2_t& x, const mat2_t& y)
+{
+	return {x.a + y.a, x.b + y.b, x.c + y.c, x.d + y.d};
+}
+Imu::mat2_t Imu::mat2_mul(const mat2_t& x, const mat2_t& y)
+{
+	return {
+		x.a * y.a + x.b * y.c, x.a * y.b + x.b * y.d,
+		x.c * y.a + x.d * y.c, x.c * y.b + x.d * y.d};
+}
+Imu::mat2_t Imu::mat2_tr(const mat2_t& x)
+{
+	return {x.a, x.c, x.b, x.d};
+}
+Imu::mat2_t Imu::mat2_inv(const mat2_t& x)
+{
+	const float det = x.a * x.d - x.b * x.c;
+	return {x.d / det, -x.b / det, -x.c / det, x.a / det};
+}
+
+#else
+
 /**
  * @brief Returns IMU pitch estimate computed via Kalman filter
  */
@@ -115,20 +488,109 @@ float Imu::get_yaw_vel()
 	return yaw_vel;
 }
 
+#endif
+
+/**
+ * @brief Returns true once the IMU calibration is ready
+ */
+bool Imu::is_calibrated()
+{
+	return ImuCal::is_ready();
+}
+
+/**
+ * @brief Returns true if the last IMU read was acknowledged
+ */
+bool Imu::get_i2c_ok()
+{
+	return i2c_ok;
+}
+
+/**
+ * @brief Loads constants derived from the ImuCal values
+ */
+void Imu::load_cal()
+{
+#if defined(BALBOT_FIXED_POINT)
+
+	// Variances and offsets in fixed point
+	const ImuCal::cal_t& cal = ImuCal::get_cal();
+	const float var_unit = cal.gyr_var[0] * t_sense * t_sense / gyr_var;
+	acc_y_var = to_var_units(cal.acc_var[1] / (g * g), var_unit);
+	acc_z_var = to_var_units(cal.acc_var[2] / (g * g), var_unit);
+	gyr_x_cal_q16 = to_q16(cal.gyr_cal[0]);
+	gyr_y_cal_q16 = to_q16(cal.gyr_cal[1]);
+	gyr_z_cal_q16 = to_q16(cal.gyr_cal[2]);
+
+#elif defined(IMU_KALMAN)
+
+	// Steady-state Kalman gain (variances only change at boot)
+	if (!gain_ready)
+	{
+		kalman_init();
+		gain_ready = true;
+	}
+
+#endif
+}
+
 /**
  * @brief Calibrates IMU and prints values to Serial
+ * 
+ * Samples are taken at ImuConfig::f_cal so the variances are those of frames
+ * FIFO-averaged over 1 / f_cal, as ImuConfig expects. Gyro offsets are sample means and
+ * variances use sums of deviations from the first sample to avoid
+ * cancellation in float.
  */
 void Imu::calibrate()
 {
-	imu.calibrate();
-	Serial.println("IMU Calibration Code:");
-	Serial.println("const float gyr_x_cal = " + String(imu.gyr_x_cal, 13) + "f;");
-	Serial.println("const float gyr_y_cal = " + String(imu.gyr_y_cal, 13) + "f;");
-	Serial.println("const float gyr_z_cal = " + String(imu.gyr_z_cal, 13) + "f;");
-	Serial.println("const float gyr_x_var = " + String(imu.get_gyr_x_var(), 14) + "f;");
-	Serial.println("const float gyr_y_var = " + String(imu.get_gyr_y_var(), 14) + "f;");
-	Serial.println("const float gyr_z_var = " + String(imu.get_gyr_z_var(), 14) + "f;");
-	Serial.println("const float acc_x_var = " + String(imu.get_acc_x_var(), 14) + "f;");
-	Serial.println("const float acc_y_var = " + String(imu.get_acc_y_var(), 14) + "f;");
-	Serial.println("const float acc_z_var = " + String(imu.get_acc_z_var(), 14) + "f;");
+	// Accumulate samples
+	const uint32_t t_cal_ms = (uint32_t)(1000.0f / ImuConfig::f_cal + 0.5f);
+	const uint8_t num_axes = 6;
+	int16_t ref[num_axes];
+	float sum[num_axes] = {0.0f};
+	float sum_sq[num_axes] = {0.0f};
+	Mpu::update();
+	for (uint16_t n = 0; n <= cal_samples; n++)
+	{
+		delay(t_cal_ms);
+		Mpu::update();
+		const Mpu::frame_t& frame = Mpu::get_frame();
+		const int16_t sample[num_axes] = {
+			frame.gyr_x, frame.gyr_y, frame.gyr_z,
+			frame.acc_x, frame.acc_y, frame.acc_z };
+		for (uint8_t i = 0; i < num_axes; i++)
+		{
+			if (n == 0)
+			{
+				ref[i] = sample[i];
+				continue;
+			}
+			const float dev = (float)(sample[i] - ref[i]);
+			sum[i] += dev;
+			sum_sq[i] += dev * dev;
+		}
+	}
+
+	// Compute means and variances
+	float mean[num_axes], var[num_axes];
+	for (uint8_t i = 0; i < num_axes; i++)
+	{
+		const float scale = (i < 3) ? Mpu::gyr_scale : Mpu::acc_scale;
+		const float dev_mean = sum[i] / cal_samples;
+		mean[i] = (ref[i] + dev_mean) * scale;
+		var[i] = (sum_sq[i] - sum[i] * dev_mean) / (cal_samples - 1) * scale * scale;
+	}
+
+	// Print calibration code
+	Hal::serial->println("IMU Calibration Code:");
+	Hal::serial->println("const float gyr_x_cal = " + String(mean[0], 13) + "f;");
+	Hal::serial->println("const float gyr_y_cal = " + String(mean[1], 13) + "f;");
+	Hal::serial->println("const float gyr_z_cal = " + String(mean[2], 13) + "f;");
+	Hal::serial->println("const float gyr_x_var = " + String(var[0], 14) + "f;");
+	Hal::serial->println("const float gyr_y_var = " + String(var[1], 14) + "f;");
+	Hal::serial->println("const float gyr_z_var = " + String(var[2], 14) + "f;");
+	Hal::serial->println("const float acc_x_var = " + String(var[3], 14) + "f;");
+	Hal::serial->println("const float acc_y_var = " + String(var[4], 14) + "f;");
+	Hal::serial->println("const float acc_z_var = " + String(var[5], 14) + "f;");
 }
\ No newline at end of file
@@ -4,6 +4,9 @@
  * @author Dan Oates (WPI Class of 2020)
  */
 #pragma once
+#if defined(BALBOT_FIXED_POINT)
+	#include <Fixed.h>
+#endif
 
 /**
  * Namespace Declaration
@@ -15,5 +18,12 @@ namespace Imu
 	float get_pitch();
 	float get_pitch_vel();
 	float get_yaw_vel();
+	bool is_calibrated();
+	bool get_i2c_ok();
+#if defined(BALBOT_FIXED_POINT)
+	Fixed::q16_t get_pitch_q16();
+	Fixed::q16_t get_pitch_vel_q16();
+	Fixed::q16_t get_yaw_vel_q16();
+#endif
 	void calibrate();
 }
\ No newline at end of file
@@ -0,0 +1,250 @@
+/**
+ * @file ImuCal.cpp
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#include <ImuCal.h>
+#include <ImuConfig.h>
+#include <RateConfig.h>
+#include <math.h>
+
+/**
+ * Namespace Definitions
+ */
+namespace ImuCal
+{
+	// Calibration State
+	cal_t cal;
+	bool ready = false;
+
+#if defined(IMU_BOOT_CAL)
+
+	// Sample counts
+#if defined(MPU6050_CAL_SAMPLES)
+	const uint16_t cal_samples = MPU6050_CAL_SAMPLES;
+#else
+	const uint16_t cal_samples = 100;
+#endif
+
+	// Rest detection and drift tracking
+	const float gyr_rest = 0.05f;		// Boot gyro deviation limit [rad/s]
+	const float acc_rest = 0.5f;		// Boot accel deviation limit [m/s^2]
+	const float var_rest = 4.0f;		// Window to boot gyro variance limit
+	const float gyr_drift = 0.005f;		// Window mean to offset limit [rad/s]
+	const float drift_gain = 0.1f;		// Offset blend per rest window
+
+	// Running statistics of gyro x, y, z then accel x, y, z
+	const uint8_t num_axes = 6;
+	typedef struct
+	{
+		uint16_t n;				// Sample count
+		float mean[num_axes];	// Sample means
+		float m2[num_axes];		// Sums of squared deviations
+	}
+	stats_t;
+	stats_t stats;
+
+	// Private Functions
+	void stats_reset();
+	void stats_add(const float sample[num_axes]);
+	float stats_var(uint8_t axis, float scale);
+	bool boot_update(const float sample[num_axes]);
+	bool drift_update(const float sample[num_axes]);
+
+#endif
+
+	// Init Flag
+	bool init_complete = false;
+}
+
+/**
+ * @brief Loads ImuConfig values or starts the boot calibration
+ */
+void ImuCal::init()
+{
+	if (!init_complete)
+	{
+#if defined(IMU_BOOT_CAL)
+
+		// Wait for the robot to be still
+		stats_reset();
+		ready = false;
+
+#else
+
+		// Per-robot constants (measured at f_cal)
+		static_assert(RateConfig::f_sense == ImuConfig::f_cal,
+			"ImuConfig variances are measured at f_cal, use IMU_BOOT_CAL at other sense rates");
+		cal.gyr_cal[0] = ImuConfig::gyr_x_cal;
+		cal.gyr_cal[1] = ImuConfig::gyr_y_cal;
+		cal.gyr_cal[2] = ImuConfig::gyr_z_cal;
+		cal.gyr_var[0] = ImuConfig::gyr_x_var;
+		cal.gyr_var[1] = ImuConfig::gyr_y_var;
+		cal.gyr_var[2] = ImuConfig::gyr_z_var;
+		cal.acc_var[0] = ImuConfig::acc_x_var;
+		cal.acc_var[1] = ImuConfig::acc_y_var;
+		cal.acc_var[2] = ImuConfig::acc_z_var;
+		ready = true;
+
+#endif
+
+		// Set init flag
+		init_complete = true;
+	}
+}
+
+/**
+ * @brief Adds one IMU frame to the calibration
+ * @param frame Latest Mpu frame (one per sense step)
+ * @return True if the calibration values changed
+ */
+bool ImuCal::update(const Mpu::frame_t& frame)
+{
+#if defined(IMU_BOOT_CAL)
+
+	// Convert to SI units
+	const float sample[num_axes] = {
+		frame.gyr_x * Mpu::gyr_scale,
+		frame.gyr_y * Mpu::gyr_scale,
+		frame.gyr_z * Mpu::gyr_scale,
+		frame.acc_x * Mpu::acc_scale,
+		frame.acc_y * Mpu::acc_scale,
+		frame.acc_z * Mpu::acc_scale };
+
+	// Estimate at boot, then track drift
+	return ready ? drift_update(sample) : boot_update(sample);
+
+#else
+
+	(void)frame;
+	return false;
+
+#endif
+}
+
+/**
+ * @brief Returns true once offsets and variances are valid
+ */
+bool ImuCal::is_ready()
+{
+	return ready;
+}
+
+/**
+ * @brief Returns current calibration values
+ */
+const ImuCal::cal_t& ImuCal::get_cal()
+{
+	return cal;
+}
+
+#if defined(IMU_BOOT_CAL)
+
+/**
+ * @brief Clears running statistics
+ */
+void ImuCal::stats_reset()
+{
+	stats.n = 0;
+	for (uint8_t i = 0; i < num_axes; i++)
+	{
+		stats.mean[i] = 0.0f;
+		stats.m2[i] = 0.0f;
+	}
+}
+
+/**
+ * @brief Adds sample to running statistics (Welford's method)
+ */
+void ImuCal::stats_add(const float sample[num_axes])
+{
+	stats.n++;
+	const float n_inv = 1.0f / stats.n;
+	for (uint8_t i = 0; i < num_axes; i++)
+	{
+		const float dev = sample[i] - stats.mean[i];
+		stats.mean[i] += dev * n_inv;
+		stats.m2[i] += dev * (sample[i] - stats.mean[i]);
+	}
+}
+
+/**
+ * @brief Returns sample variance of axis
+ * @param axis Index into stats_t arrays
+ * @param scale Sensor resolution [units/LSB]
+ *
+ * Floored at the quantization variance so a quiet channel never gets a zero
+ * variance (and an infinite weight) in the estimator.
+ */
+float ImuCal::stats_var(uint8_t axis, float scale)
+{
+	const float var = stats.m2[axis] / (stats.n - 1);
+	const float var_min = scale * scale / 12.0f;
+	return (var > var_min) ? var : var_min;
+}
+
+/**
+ * @brief Accumulates the boot calibration
+ * @return True when the calibration becomes ready
+ *
+ * Any sample too far from the running mean means the robot moved, so the
+ * estimate restarts from that sample.
+ */
+bool ImuCal::boot_update(const float sample[num_axes])
+{
+	// Restart if moved
+	for (uint8_t i = 0; i < num_axes && stats.n > 0; i++)
+	{
+		const float rest = (i < 3) ? gyr_rest : acc_rest;
+		if (fabsf(sample[i] - stats.mean[i]) > rest) stats_reset();
+	}
+	stats_add(sample);
+	if (stats.n < cal_samples) return false;
+
+	// Offsets and variances
+	for (uint8_t i = 0; i < 3; i++)
+	{
+		cal.gyr_cal[i] = stats.mean[i];
+		cal.gyr_var[i] = stats_var(i, Mpu::gyr_scale);
+		cal.acc_var[i] = stats_var(i + 3, Mpu::acc_scale);
+	}
+	stats_reset();
+	ready = true;
+	return true;
+}
+
+/**
+ * @brief Tracks gyro offset drift in windows of rest
+ * @return True if the offsets changed
+ *
+ * A window counts as rest if every gyro variance is within var_rest of its
+ * boot value and every mean is within gyr_drift of its offset, which rejects
+ * balancing sway and deliberate turns.
+ */
+bool ImuCal::drift_update(const float sample[num_axes])
+{
+	// Fill window
+	stats_add(sample);
+	if (stats.n < cal_samples) return false;
+
+	// Check for rest
+	bool rest = true;
+	for (uint8_t i = 0; i < 3; i++)
+	{
+		rest = rest &&
+			stats_var(i, Mpu::gyr_scale) <= var_rest * cal.gyr_var[i] &&
+			fabsf(stats.mean[i] - cal.gyr_cal[i]) <= gyr_drift;
+	}
+
+	// Blend window means into offsets
+	if (rest)
+	{
+		for (uint8_t i = 0; i < 3; i++)
+		{
+			cal.gyr_cal[i] += drift_gain * (stats.mean[i] - cal.gyr_cal[i]);
+		}
+	}
+	stats_reset();
+	return rest;
+}
+
+#endif
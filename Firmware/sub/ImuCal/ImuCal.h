@@ -0,0 +1,42 @@
+/**
+ * @file ImuCal.h
+ * @brief Subsystem for IMU offset and variance calibration
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * Holds the gyro offsets and sensor variances of frames at the sense rate
+ * (RateConfig::f_sense), as used by Imu. Without IMU_BOOT_CAL these are the
+ * per-robot ImuConfig constants and update() does nothing. Those are measured
+ * on frames at ImuConfig::f_cal, so builds whose sense rate differs must use
+ * IMU_BOOT_CAL.
+ *
+ * With IMU_BOOT_CAL, update() takes one Mpu frame per sense step and keeps
+ * running means and variances (Welford's method) of all six channels, so no
+ * step does more than one sample's work. The boot estimate restarts whenever
+ * a sample strays from the running mean by more than a rest threshold, and is
+ * ready once MPU6050_CAL_SAMPLES consecutive samples were at rest. After that,
+ * each window of MPU6050_CAL_SAMPLES gyro samples whose variances stay near
+ * the boot variances and whose means stay near the offsets is blended into
+ * the offsets, tracking slow bias drift while the robot is still.
+ */
+#pragma once
+#include <Mpu.h>
+
+/**
+ * Namespace Declaration
+ */
+namespace ImuCal
+{
+	// Calibration values
+	typedef struct
+	{
+		float gyr_cal[3];	// Gyro x, y, z offsets [rad/s]
+		float gyr_var[3];	// Gyro x, y, z variances [(rad/s)^2]
+		float acc_var[3];	// Accel x, y, z variances [(m/s^2)^2]
+	}
+	cal_t;
+
+	void init();
+	bool update(const Mpu::frame_t& frame);
+	bool is_ready();
+	const cal_t& get_cal();
+}
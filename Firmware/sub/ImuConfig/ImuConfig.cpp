@@ -50,7 +50,9 @@ namespace ImuConfig
 	const float acc_y_var = 0.00118071350000f;
 	const float acc_z_var = 0.00219102880000f;
 #elif ES3011_BOT_ID <= 20
+#if !defined(IMU_BOOT_CAL)
 	#warning "Not calibrated!"
+#endif
 	const float gyr_x_cal = 0.0f;
 	const float gyr_y_cal = 0.0f;
 	const float gyr_z_cal = 0.0f;
@@ -10,6 +10,9 @@
  */
 namespace ImuConfig
 {
+	// Variances are of MPU frames averaged at this rate (Imu::calibrate)
+	constexpr float f_cal = 100.0f;	// Calibration frame rate [Hz]
+
 	const extern float gyr_x_cal;	// Gyroscope x offset [rad/s]
 	const extern float gyr_y_cal;	// Gyroscope y offset [rad/s]
 	const extern float gyr_z_cal;	// Gyroscope z offset [rad/s]
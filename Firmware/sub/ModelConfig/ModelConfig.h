@@ -0,0 +1,35 @@
+/**
+ * @file ModelConfig.h
+ * @brief Namespace for body and wheel constants
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * Mass properties are estimates, not measurements. Gains.h builds the
+ * controller design model from these and the MotorConfig constants, and the
+ * native Plant uses them as nominal values.
+ */
+#pragma once
+
+/**
+ * Namespace Declaration
+ */
+namespace ModelConfig
+{
+	// Body
+	constexpr float M = 1.00f;			// Body mass [kg]
+	constexpr float l = 0.080f;			// Axle to body COM [m]
+	constexpr float Ib = 0.0040f;		// Body pitch inertia about COM [kg*m^2]
+	constexpr float Iz = 0.0060f;		// Body yaw inertia [kg*m^2]
+	constexpr float h_imu = 0.060f;		// Axle to IMU [m]
+
+	// Wheels
+	constexpr float m = 0.030f;			// Wheel mass (each) [kg]
+	constexpr float r = 0.040f;			// Wheel radius [m]
+	constexpr float d = 0.085f;			// Half wheel track [m]
+
+	// Drivetrain
+	constexpr float J_rotor = 5.0e-8f;	// Motor rotor inertia [kg*m^2]
+	constexpr float b = 5.0e-4f;		// Gearbox viscous friction [N*m/(rad/s)]
+
+	// Environment
+	constexpr float g = 9.81f;			// Gravity [m/s^2]
+}
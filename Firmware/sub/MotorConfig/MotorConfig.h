@@ -2,6 +2,9 @@
  * @file MotorConfig.h
  * @brief Namespace for motor constants
  * @author Dan Oates (WPI Class of 2020)
+ *
+ * Constants are constexpr so Gains.h can synthesize controller gains from
+ * them at compile time.
  */
 #pragma once
 
@@ -10,10 +13,27 @@
  */
 namespace MotorConfig
 {
-	const extern float Vb;			// Battery voltage [V]
-	const extern float R;			// Resistance [Ohm]
-	const extern float Kv;			// Voltage constant [V/(rad/s)]
-	const extern float Kt;			// Torque constant [N*m/A]
-	const extern float direction;	// Motor direction [+1, -1]
-	const extern float enc_cpr;		// Encoder resolution [cnt/rev]
-}
\ No newline at end of file
+	// Universal Constants
+	constexpr float Vb = 12.0f;		// Battery voltage [V]
+	constexpr float i_ST = 1.0f;	// Stall current [A]
+	constexpr float i_NL = 0.12f;	// No-load current [A]
+	constexpr float R = 5.4f;		// Resistance [Ohm]
+
+	// Robot-Specific Constants
+	// direction = Motor direction [+1, -1]
+	// tr = Torque ratio [(N*m)/(N*m)]
+	#if ES3011_BOT_ID <= 1
+		constexpr float direction = +1.0f;
+		constexpr float tr = +30.0f;
+	#else
+		constexpr float direction = -1.0f;
+		constexpr float tr = +56.0f;
+	#endif
+
+	// Derived Constants
+	constexpr float w_NL = 1047.0f / tr;			// No-load speed [rad/s]
+	constexpr float t_ST = 0.015f * tr;				// Stall torque [N*m]
+	constexpr float Kv = (Vb - R * i_NL) / w_NL;	// Voltage constant [V/(rad/s)]
+	constexpr float Kt = t_ST * R / Vb;				// Torque constant [N*m/A]
+	constexpr float enc_cpr = 44.0 * tr;			// Encoder resolution [cnt/rev]
+}
@@ -4,14 +4,13 @@
  */
 #include <MotorL.h>
 #include <MotorConfig.h>
-#include <Controller.h>
 #include <Imu.h>
-#include <HBridge.h>
-#include <QuadEncoder.h>
-#include <LTIFilter.h>
-using Controller::f_ctrl;
-using MotorConfig::Vb;
+#include <Hal.h>
+#include <Encoder.h>
 using MotorConfig::enc_cpr;
+#if defined(BALBOT_FIXED_POINT)
+	using namespace Fixed;
+#endif
 
 /**
  * Namespace Definitions
@@ -19,35 +18,33 @@ using MotorConfig::enc_cpr;
 namespace MotorL
 {
 	// Pin Definitions
-	const uint8_t pin_enable = 8;	// H-bridge enable
-	const uint8_t pin_pwm = 9;		// H-bridge PWM
-	const uint8_t pin_fwd = 6;		// H-bridge forward enable
-	const uint8_t pin_rev = 7;		// H-bridge reverse enable
-	const uint8_t pin_enc_a = 2;	// Encoder channel A
-	const uint8_t pin_enc_b = 3;	// Encoder channel B
-
-	// Hardware Interfaces
-	PwmOut out_pwm(pin_pwm);
-	DigitalOut out_fwd(pin_fwd);
-	DigitalOut out_rev(pin_rev);
-	HBridge motor(&out_pwm, &out_fwd, &out_rev, Vb);
-	DigitalIn in_enc_a(pin_enc_a);
-	DigitalIn in_enc_b(pin_enc_b);
-	QuadEncoder encoder(&in_enc_a, &in_enc_b, enc_cpr);
-
-	// Digital Filters
-	LTIFilter angle_diff = LTIFilter::make_dif(f_ctrl);
+	const uint8_t pin_enable = 8;	// H-bridge enable (PWM and direction in MotorPwm)
 
+	// Encoder
+	const Encoder::side_t side = Encoder::left;
+	float rad_per_cnt;	// Encoder angle per count [rad/cnt]
+
+#if defined(BALBOT_FIXED_POINT)
+	// Encoder scales with motor direction
+	constexpr float dir_rad_per_cnt = MotorConfig::direction * 2.0f * M_PI / enc_cpr;
+	constexpr q16_t angle_scale_q16 =
+		to_q16(dir_rad_per_cnt * 65536.0f);				// Angle [rad/cnt * 2^16]
+	constexpr q16_t velocity_scale_q16 =
+		to_q16(dir_rad_per_cnt / (256.0f * Hal::stamp_res));	// Velocity [rad/cnt * cnt/stamp / 2^8]
+#endif
+
+#if defined(BALBOT_FIXED_POINT)
+	// State Variables
+	q16_t angle = 0;		// Encoder angle [rad]
+	q16_t velocity = 0;		// Angular velocity [rad/s]
+#else
 	// State Variables
 	float angle;		// Encoder angle [rad]
 	float velocity;		// Angular velocity [rad/s]
+#endif
 
 	// Init Flag
 	bool init_complete = false;
-
-	// Private Functions
-	void isr_A();
-	void isr_B();
 }
 
 /**
@@ -60,12 +57,12 @@ void MotorL::init()
 	if (!init_complete)
 	{
 		// Enable motor driver
-		pinMode(pin_enable, OUTPUT);
-		digitalWrite(pin_enable, HIGH);
+		Hal::pin_init_output(pin_enable);
+		Hal::pin_write(pin_enable, true);
 
-		// Init encoder interrupts
-		attachInterrupt(digitalPinToInterrupt(pin_enc_a), isr_A, CHANGE);
-		attachInterrupt(digitalPinToInterrupt(pin_enc_b), isr_B, CHANGE);
+		// Init encoder
+		Encoder::init();
+		rad_per_cnt = 2.0f * M_PI / enc_cpr;
 
 		// Set init flag
 		init_complete = true;
@@ -74,49 +71,69 @@ void MotorL::init()
 
 /**
  * @brief Updates motor state estimates
+ * 
+ * Wheel angle and velocity are relative to the ground, so body pitch and
+ * pitch rate are removed from the encoder readings. Uses the snapshot from
+ * the last Encoder::update().
  */
 void MotorL::update()
 {
-	angle = MotorConfig::direction * encoder.get_angle() - Imu::get_pitch();
-	velocity = angle_diff.update(angle);
+#if defined(BALBOT_FIXED_POINT)
+	const q16_t angle_enc = mul((q16_t)Encoder::get_count(side), angle_scale_q16);
+	const q16_t velocity_enc = mul(Encoder::get_rate_q24(side), velocity_scale_q16);
+	angle = sub(angle_enc, Imu::get_pitch_q16());
+	velocity = sub(velocity_enc, Imu::get_pitch_vel_q16());
+#else
+	const float dir_rad_per_cnt = MotorConfig::direction * rad_per_cnt;
+	const float angle_enc = dir_rad_per_cnt * Encoder::get_count(side);
+	const float velocity_enc = dir_rad_per_cnt * Encoder::get_rate(side);
+	angle = angle_enc - Imu::get_pitch();
+	velocity = velocity_enc - Imu::get_pitch_vel();
+#endif
 }
 
-/**
- * @brief Sends given voltage command to motor
- */
-void MotorL::set_voltage(float v_cmd)
-{
-	motor.set_voltage(MotorConfig::direction * v_cmd);
-}
+#if defined(BALBOT_FIXED_POINT)
 
 /**
  * @brief Returns encoder angle estimate
  */
 float MotorL::get_angle()
 {
-	return angle;
+	return to_float(angle);
 }
 
 /**
  * @brief Returns encoder velocity estimate
  */
 float MotorL::get_velocity()
+{
+	return to_float(velocity);
+}
+
+/**
+ * @brief Returns encoder velocity estimate [rad/s, Q16.16]
+ */
+q16_t MotorL::get_velocity_q16()
 {
 	return velocity;
 }
 
+#else
+
 /**
- * @brief Motor encoder A ISR
+ * @brief Returns encoder angle estimate
  */
-void MotorL::isr_A()
+float MotorL::get_angle()
 {
-	encoder.interrupt_A();
+	return angle;
 }
 
 /**
- * @brief Motor encoder B ISR
+ * @brief Returns encoder velocity estimate
  */
-void MotorL::isr_B()
+float MotorL::get_velocity()
 {
-	encoder.interrupt_B();
-}
\ No newline at end of file
+	return velocity;
+}
+
+#endif
@@ -4,6 +4,9 @@
  * @author Dan Oates (WPI Class of 2020)
  */
 #pragma once
+#if defined(BALBOT_FIXED_POINT)
+	#include <Fixed.h>
+#endif
 
 /**
  * Namespace Declaration
@@ -12,7 +15,9 @@ namespace MotorL
 {
 	void init();
 	void update();
-	void set_voltage(float v_cmd);
 	float get_angle();
 	float get_velocity();
+#if defined(BALBOT_FIXED_POINT)
+	Fixed::q16_t get_velocity_q16();
+#endif
 }
\ No newline at end of file
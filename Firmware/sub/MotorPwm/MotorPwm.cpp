@@ -0,0 +1,145 @@
+/**
+ * @file MotorPwm.cpp
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#include <MotorPwm.h>
+#include <MotorConfig.h>
+#include <Hal.h>
+using MotorConfig::Vb;
+#if defined(BALBOT_FIXED_POINT)
+	using namespace Fixed;
+#endif
+
+/**
+ * Namespace Definitions
+ */
+namespace MotorPwm
+{
+	// Pin Definitions (PWM on pins 9 and 10 in Hal)
+	const uint8_t pin_fwd_L = 6;	// Left H-bridge forward enable
+	const uint8_t pin_rev_L = 7;	// Left H-bridge reverse enable
+	const uint8_t pin_fwd_R = 12;	// Right H-bridge forward enable
+	const uint8_t pin_rev_R = 13;	// Right H-bridge reverse enable
+
+	// Duty per volt [cnt/V]
+	constexpr float duty_per_volt = Hal::pwm_top / Vb;
+
+#if defined(BALBOT_FIXED_POINT)
+	// Duty per volt [cnt/V * 2^8] applied to Q20.12 voltages
+	constexpr q16_t Vb_q16 = to_q16(Vb);
+	constexpr uint32_t duty_per_volt_q8 = (uint32_t)(duty_per_volt * 256.0f + 0.5f);
+	static_assert((uint64_t)(Vb_q16 >> 4) * duty_per_volt_q8 < (1ull << 32),
+		"Duty product overflows 32 bits");
+#endif
+
+	// Direction States [-1, 0, +1]
+	int8_t dir_L = 0;
+	int8_t dir_R = 0;
+
+	// Init Flag
+	bool init_complete = false;
+
+	// Private Functions
+	void set_direction(int8_t& dir, int8_t dir_new, uint8_t pin_fwd, uint8_t pin_rev);
+	uint16_t to_duty(float v);
+#if defined(BALBOT_FIXED_POINT)
+	uint16_t to_duty_q16(q16_t v);
+#endif
+}
+
+/**
+ * @brief Initializes direction pins and Timer1 PWM with both motors off
+ */
+void MotorPwm::init()
+{
+	if (!init_complete)
+	{
+		// Direction pins
+		Hal::pin_init_output(pin_fwd_L);
+		Hal::pin_init_output(pin_rev_L);
+		Hal::pin_init_output(pin_fwd_R);
+		Hal::pin_init_output(pin_rev_R);
+		Hal::pin_write(pin_fwd_L, false);
+		Hal::pin_write(pin_rev_L, false);
+		Hal::pin_write(pin_fwd_R, false);
+		Hal::pin_write(pin_rev_R, false);
+		dir_L = 0;
+		dir_R = 0;
+
+		// PWM outputs
+		Hal::pwm_init();
+
+		// Set init flag
+		init_complete = true;
+	}
+}
+
+/**
+ * @brief Sends voltage commands to both motors [V]
+ */
+void MotorPwm::set_voltages(float v_L, float v_R)
+{
+	v_L *= MotorConfig::direction;
+	v_R *= MotorConfig::direction;
+	set_direction(dir_L, (v_L > 0.0f) - (v_L < 0.0f), pin_fwd_L, pin_rev_L);
+	set_direction(dir_R, (v_R > 0.0f) - (v_R < 0.0f), pin_fwd_R, pin_rev_R);
+	Hal::pwm_write_pair(to_duty(v_L), to_duty(v_R));
+}
+
+#if defined(BALBOT_FIXED_POINT)
+
+/**
+ * @brief Sends voltage commands to both motors [V, Q16.16]
+ */
+void MotorPwm::set_voltages_q16(q16_t v_L, q16_t v_R)
+{
+	if (MotorConfig::direction < 0.0f)
+	{
+		v_L = neg(v_L);
+		v_R = neg(v_R);
+	}
+	set_direction(dir_L, (v_L > 0) - (v_L < 0), pin_fwd_L, pin_rev_L);
+	set_direction(dir_R, (v_R > 0) - (v_R < 0), pin_fwd_R, pin_rev_R);
+	Hal::pwm_write_pair(to_duty_q16(v_L), to_duty_q16(v_R));
+}
+
+#endif
+
+/**
+ * @brief Writes H-bridge direction pins if direction changed
+ */
+inline void MotorPwm::set_direction(int8_t& dir, int8_t dir_new, uint8_t pin_fwd, uint8_t pin_rev)
+{
+	if (dir_new != dir)
+	{
+		Hal::pin_write(pin_fwd, dir_new > 0);
+		Hal::pin_write(pin_rev, dir_new < 0);
+		dir = dir_new;
+	}
+}
+
+/**
+ * @brief Returns duty counts of voltage magnitude, saturated at Vb
+ */
+inline uint16_t MotorPwm::to_duty(float v)
+{
+	const float duty = fabsf(v) * duty_per_volt;
+	return (duty < Hal::pwm_top) ? (uint16_t)duty : Hal::pwm_top;
+}
+
+#if defined(BALBOT_FIXED_POINT)
+
+/**
+ * @brief Returns duty counts of voltage magnitude, saturated at Vb
+ * 
+ * Drops the voltage to Q20.12 so the product with the Q8 reciprocal fits
+ * in 32 bits.
+ */
+inline uint16_t MotorPwm::to_duty_q16(q16_t v)
+{
+	const uint32_t v_abs = Fixed::abs(v);
+	if (v_abs >= (uint32_t)Vb_q16) return Hal::pwm_top;
+	return (uint16_t)(((v_abs >> 4) * duty_per_volt_q8) >> 20);
+}
+
+#endif
@@ -0,0 +1,28 @@
+/**
+ * @file MotorPwm.h
+ * @brief Subsystem for the voltage outputs of both drive motors
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * Drives both H-bridges from Timer1 (Hal::pwm_init), so the PWM frequency is
+ * set by MOTOR_PWM_HZ rather than the Arduino 490 Hz default. Voltages are
+ * converted to duty counts with a precomputed counts-per-volt reciprocal of
+ * the battery voltage, in integer Q16.16 math for BALBOT_FIXED_POINT builds,
+ * and both duties are written for the same PWM period. Direction pins are
+ * only written when a motor changes direction.
+ */
+#pragma once
+#if defined(BALBOT_FIXED_POINT)
+	#include <Fixed.h>
+#endif
+
+/**
+ * Namespace Declaration
+ */
+namespace MotorPwm
+{
+	void init();
+	void set_voltages(float v_L, float v_R);
+#if defined(BALBOT_FIXED_POINT)
+	void set_voltages_q16(Fixed::q16_t v_L, Fixed::q16_t v_R);
+#endif
+}
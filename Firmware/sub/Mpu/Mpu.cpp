@@ -0,0 +1,296 @@
+/**
+ * @file Mpu.cpp
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#include <Mpu.h>
+#include <Hal.h>
+#include <RateConfig.h>
+
+/**
+ * Namespace Definitions
+ */
+namespace Mpu
+{
+	// Bus address and data-ready pin
+	const uint8_t address = 0x68;
+	const uint8_t pin_int = 11;		// MPU6050 INT wired to D11 (PCINT3)
+
+	// Sampling configuration
+#if defined(MPU6050_SMPLRT_DIV)
+	const uint8_t smplrt_div = MPU6050_SMPLRT_DIV;
+#else
+	const uint8_t smplrt_div = 1;
+#endif
+#if defined(MPU6050_DLPF_CFG)
+	const uint8_t dlpf_cfg = MPU6050_DLPF_CFG;
+#else
+	const uint8_t dlpf_cfg = 2;
+#endif
+	static_assert(dlpf_cfg >= 1 && dlpf_cfg <= 6,
+		"MPU6050_DLPF_CFG must be 1-6 (1 kHz gyro output rate)");
+
+	// Registers
+	const uint8_t reg_smplrt_div = 0x19;
+	const uint8_t reg_config = 0x1A;
+	const uint8_t reg_gyro_config = 0x1B;
+	const uint8_t reg_accel_config = 0x1C;
+	const uint8_t reg_fifo_en = 0x23;
+	const uint8_t reg_int_pin_cfg = 0x37;
+	const uint8_t reg_int_enable = 0x38;
+	const uint8_t reg_accel_xout_h = 0x3B;
+	const uint8_t reg_user_ctrl = 0x6A;
+	const uint8_t reg_pwr_mgmt_1 = 0x6B;
+	const uint8_t reg_fifo_count_h = 0x72;
+	const uint8_t reg_fifo_r_w = 0x74;
+	const uint8_t reg_who_am_i = 0x75;
+
+	// Register values
+	const uint8_t pwr_clk_pll_x = 0x01;		// Wake with X-gyro PLL clock
+	const uint8_t gyro_fs_250 = 0x00;		// +-250 deg/s
+	const uint8_t accel_fs_2g = 0x00;		// +-2 g
+	const uint8_t fifo_en_acc_gyr = 0x78;	// Gyro XYZ and accel to FIFO
+	const uint8_t user_fifo_en = 0x40;		// Enable FIFO
+	const uint8_t user_fifo_reset = 0x04;	// Reset FIFO
+	const uint8_t int_latch_rd_clear = 0x30;	// Hold INT high until any read
+	const uint8_t int_data_rdy = 0x01;		// Data-ready interrupt
+
+	// FIFO samples
+	const uint8_t sample_size = 12;		// Accel XYZ then gyro XYZ [bytes]
+	const uint16_t fifo_size = 1024;	// Sensor FIFO capacity [bytes]
+	const uint8_t max_samples = 8;		// Max samples per burst
+	static_assert(1000.0f / (1 + smplrt_div) <= max_samples * RateConfig::f_sense,
+		"MPU6050 samples per sense period exceed max_samples, raise MPU6050_SMPLRT_DIV");
+	const int32_t sample_stamps =
+		(int32_t)((1 + smplrt_div) * 1.0e-3f / Hal::stamp_res + 0.5f);	// Sample period [Hal::stamp_res]
+	volatile uint32_t ready_stamp = 0;	// Newest data-ready edge [Hal::stamp_res]
+	volatile bool fifo_bad = false;		// Count misaligned, overflowed or backlogged
+	uint8_t fifo_count[2];				// FIFO_COUNT_H/L (big-endian)
+	uint8_t fifo_left = 0;				// Samples left in sensor FIFO by last burst
+	uint32_t fifo_stamp = 0;			// Newest sample in sensor FIFO [Hal::stamp_res]
+
+	// Raw burst buffers (big-endian)
+	uint8_t raw[2][max_samples * sample_size];
+	uint8_t raw_back = 0;				// Buffer being filled by bus
+	volatile uint8_t raw_samples = 0;	// Samples in back buffer
+	uint32_t raw_stamp[2];				// Newest sample of each buffer [Hal::stamp_res]
+
+	// Latest averaged frame
+	frame_t frame = {0, 0, 0, 0, 0, 0};
+	uint8_t frame_samples = 0;
+	uint32_t frame_stamp = 0;
+
+	// Private functions
+	bool fifo_reset();
+	void drain_start();
+	void burst_start();
+	void decode(const uint8_t* bytes, uint8_t samples);
+	int16_t decode16(const uint8_t* bytes);
+	void isr_data_ready();
+}
+
+/**
+ * @brief Configures MPU6050 sampling, FIFO and latched data-ready interrupt
+ * 
+ * The first frame is read directly from the data registers so estimators have
+ * a valid sample before the FIFO fills.
+ * @return True if device responded with correct identity
+ */
+bool Mpu::init()
+{
+	// Check identity
+	Hal::i2c_init();
+	uint8_t who_am_i = 0;
+	if (!Hal::i2c_read(address, reg_who_am_i, &who_am_i, 1)) return false;
+	if (who_am_i != address) return false;
+
+	// Configure sampling
+	if (!Hal::i2c_write(address, reg_pwr_mgmt_1, pwr_clk_pll_x)) return false;
+	if (!Hal::i2c_write(address, reg_config, dlpf_cfg)) return false;
+	if (!Hal::i2c_write(address, reg_smplrt_div, smplrt_div)) return false;
+	if (!Hal::i2c_write(address, reg_gyro_config, gyro_fs_250)) return false;
+	if (!Hal::i2c_write(address, reg_accel_config, accel_fs_2g)) return false;
+
+	// Read first frame
+	uint8_t bytes[14];
+	if (!Hal::i2c_read(address, reg_accel_xout_h, bytes, sizeof(bytes))) return false;
+	frame.acc_x = decode16(bytes + 0);
+	frame.acc_y = decode16(bytes + 2);
+	frame.acc_z = decode16(bytes + 4);
+	frame.gyr_x = decode16(bytes + 8);
+	frame.gyr_y = decode16(bytes + 10);
+	frame.gyr_z = decode16(bytes + 12);
+	frame_samples = 1;
+
+	// Start FIFO and data-ready stamping
+	if (!Hal::i2c_write(address, reg_fifo_en, fifo_en_acc_gyr)) return false;
+	if (!Hal::i2c_write(address, reg_int_pin_cfg, int_latch_rd_clear)) return false;
+	Hal::attach_isr(pin_int, isr_data_ready, RISING);
+	if (!fifo_reset()) return false;
+	if (!Hal::i2c_write(address, reg_int_enable, int_data_rdy)) return false;
+	drain_start();
+	return true;
+}
+
+/**
+ * @brief Averages the pending FIFO burst and starts the next one
+ * 
+ * Only blocks if the previous burst has not finished yet. If no samples
+ * arrived, the previous frame is held and get_samples() returns 0.
+ * @return True if the averaged burst was acknowledged
+ */
+bool Mpu::update()
+{
+	// Wait for pending burst
+	while (Hal::i2c_busy());
+	const bool success = Hal::i2c_ok();
+
+	// Swap buffers and start next burst
+	const uint8_t done = raw_back;
+	const uint8_t samples = success ? raw_samples : 0;
+	raw_back ^= 1;
+	if (!success || fifo_bad) fifo_reset();
+	drain_start();
+
+	// Average finished buffer
+	frame_samples = samples;
+	if (samples > 0)
+	{
+		decode(raw[done], samples);
+		frame_stamp = raw_stamp[done];
+	}
+	return success;
+}
+
+/**
+ * @brief Returns latest averaged frame
+ */
+const Mpu::frame_t& Mpu::get_frame()
+{
+	return frame;
+}
+
+/**
+ * @brief Returns number of samples averaged into latest frame
+ */
+uint8_t Mpu::get_samples()
+{
+	return frame_samples;
+}
+
+/**
+ * @brief Returns tick timestamp of newest sample in latest frame [Hal::stamp_res]
+ * 
+ * Extrapolated from the latched data-ready edge, so it is accurate to about a
+ * sample period, and the age of the frame includes the burst pipeline. Zero
+ * until the first FIFO frame.
+ */
+uint32_t Mpu::get_stamp()
+{
+	return frame_stamp;
+}
+
+/**
+ * @brief Clears sensor FIFO (blocking)
+ */
+bool Mpu::fifo_reset()
+{
+	const bool success = Hal::i2c_write(
+		address, reg_user_ctrl, user_fifo_en | user_fifo_reset);
+	fifo_bad = false;
+	fifo_left = 0;
+	return success;
+}
+
+/**
+ * @brief Starts background FIFO count read, which then starts the burst
+ */
+void Mpu::drain_start()
+{
+	raw_samples = 0;
+	Hal::i2c_read_start(address, reg_fifo_count_h, fifo_count, 2, burst_start);
+}
+
+/**
+ * @brief Starts background burst sized by the FIFO count just read
+ * 
+ * Runs from the TWI interrupt on the Uno. A count that is not a whole number
+ * of samples means the FIFO overflowed (the full count, 1024, is not) and is
+ * no longer frame-aligned, and a backlog beyond two bursts is stale, so both
+ * flag the FIFO for reset by the next update() instead.
+ * 
+ * The latched interrupt only rises on the first sample after each read, so
+ * the newest queued sample is stamped from that edge and the sample period.
+ */
+void Mpu::burst_start()
+{
+	const uint16_t count = ((uint16_t)fifo_count[0] << 8) | fifo_count[1];
+	const uint8_t queued = (uint8_t)((count < fifo_size ? count : fifo_size) / sample_size);
+	if (count >= fifo_size || count % sample_size != 0 || queued > 2 * max_samples)
+	{
+		fifo_bad = true;
+		return;
+	}
+
+	// Stamp newest queued sample
+	if (queued > fifo_left)
+	{
+		const uint32_t now = Hal::stamp();
+		fifo_stamp = ready_stamp + (queued - fifo_left - 1) * sample_stamps;
+		if ((int32_t)(now - fifo_stamp) < 0) fifo_stamp = now;
+	}
+
+	// Burst oldest samples
+	const uint8_t samples = (queued > max_samples) ? max_samples : queued;
+	fifo_left = queued - samples;
+	raw_stamp[raw_back] = fifo_stamp - fifo_left * sample_stamps;
+	raw_samples = samples;
+	if (samples > 0)
+	{
+		Hal::i2c_read_start(address, reg_fifo_r_w,
+			raw[raw_back], samples * sample_size);
+	}
+}
+
+/**
+ * @brief Averages samples of raw FIFO burst into frame
+ */
+void Mpu::decode(const uint8_t* bytes, uint8_t samples)
+{
+	int32_t sums[6] = {0, 0, 0, 0, 0, 0};
+	for (uint8_t s = 0; s < samples; s++)
+	{
+		for (uint8_t i = 0; i < 6; i++)
+		{
+			sums[i] += decode16(bytes);
+			bytes += 2;
+		}
+	}
+	const int32_t half = samples / 2;
+	int16_t avg[6];
+	for (uint8_t i = 0; i < 6; i++)
+	{
+		avg[i] = (int16_t)((sums[i] + (sums[i] < 0 ? -half : half)) / samples);
+	}
+	frame.acc_x = avg[0];
+	frame.acc_y = avg[1];
+	frame.acc_z = avg[2];
+	frame.gyr_x = avg[3];
+	frame.gyr_y = avg[4];
+	frame.gyr_z = avg[5];
+}
+
+/**
+ * @brief Decodes big-endian 16-bit register pair
+ */
+int16_t Mpu::decode16(const uint8_t* bytes)
+{
+	return (int16_t)(((uint16_t)bytes[0] << 8) | bytes[1]);
+}
+
+/**
+ * @brief Stamps first sample queued since the last read
+ */
+void Mpu::isr_data_ready()
+{
+	ready_stamp = Hal::stamp();
+}
@@ -0,0 +1,47 @@
+/**
+ * @file Mpu.h
+ * @brief Register-level MPU6050 driver with background FIFO reads
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * The sensor samples at 1 kHz / (1 + MPU6050_SMPLRT_DIV) through its digital
+ * low-pass filter (MPU6050_DLPF_CFG) and queues accel and gyro samples in its
+ * FIFO. Each burst is sized by a FIFO count read chained ahead of it in the
+ * background, and a count that shows overflow or misalignment resets the
+ * FIFO. update() waits for the burst started by the previous call, averages
+ * its samples into the current frame, and immediately starts the next count
+ * and burst into the other buffer so the bus transfers overlap the rest of
+ * the loop. The data-ready interrupt on pin_int is latched until the next
+ * read, so no edge is lost to its short pulse, and stamps the first sample
+ * after each read; get_stamp() extrapolates from it to the newest sample.
+ *
+ * The MPU6050 INT pin must be wired to D11. Frames are still read without it,
+ * but their stamps never advance, so the CTRL_PREDICTOR horizon saturates at
+ * its limit and the PROFILE_LOOP IMU latency trace is meaningless. Builds check that one sense period holds at most
+ * max_samples samples, so a burst never falls behind the FIFO.
+ */
+#pragma once
+#include <stdint.h>
+
+/**
+ * Namespace Declaration
+ */
+namespace Mpu
+{
+	// Raw sample [LSB]
+	typedef struct
+	{
+		int16_t acc_x, acc_y, acc_z;
+		int16_t gyr_x, gyr_y, gyr_z;
+	}
+	frame_t;
+
+	// Scale factors at +-2 g and +-250 deg/s full scale
+	constexpr float acc_scale = 9.81f / 16384.0f;			// [(m/s^2)/LSB]
+	constexpr float gyr_scale = 3.14159265f / (180.0f * 131.0f);	// [(rad/s)/LSB]
+
+	bool init();
+	bool update();
+	const frame_t& get_frame();
+	uint8_t get_samples();
+	uint32_t get_stamp();
+}
@@ -0,0 +1,170 @@
+/**
+ * @file Profiler.cpp
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#include <Profiler.h>
+#if defined(PROFILE_LOOP)
+#include <Hal.h>
+
+/**
+ * Namespace Definitions
+ */
+namespace Profiler
+{
+	// Span histograms
+	hist_t hists[num_spans];
+
+	// Control cycle counter
+	uint32_t cycle = 0;
+
+	// Trace point stamps [Hal::stamp_res]
+	const uint32_t stamp_us = (uint32_t)(Hal::stamp_res * 1.0e6f + 0.5f);
+	const span_t point_spans[num_points] = {
+		span_imu_pwm, span_encoder_pwm, span_control_pwm };
+	uint32_t point_stamps[num_points];
+	uint8_t point_mask = 0;		// Points traced at least once
+
+	// Init flag
+	bool init_complete = false;
+
+	// Private functions
+	uint32_t stamp();
+	void record(span_t span, uint32_t t_span);
+}
+
+/**
+ * @brief Returns start time for first span [us]
+ */
+uint32_t Profiler::start()
+{
+	if (!init_complete)
+	{
+		reset();
+		init_complete = true;
+	}
+	return Hal::micros();
+}
+
+/**
+ * @brief Records span since t_start and returns start time of next span [us]
+ */
+uint32_t Profiler::lap(span_t span, uint32_t t_start)
+{
+	const uint32_t t_now = Hal::micros();
+	record(span, t_now - t_start);
+	return t_now;
+}
+
+/**
+ * @brief Advances the control cycle counter
+ */
+void Profiler::end_cycle()
+{
+	cycle++;
+}
+
+/**
+ * @brief Stamps trace point now
+ */
+void Profiler::trace(point_t point)
+{
+	trace_at(point, stamp());
+}
+
+/**
+ * @brief Sets trace point to given tick timestamp [Hal::stamp_res]
+ */
+void Profiler::trace_at(point_t point, uint32_t stamp)
+{
+	point_stamps[point] = stamp;
+	point_mask |= (1u << point);
+}
+
+/**
+ * @brief Records the latency from each trace point to the PWM update
+ */
+void Profiler::trace_pwm()
+{
+	const uint32_t t_pwm = stamp();
+	for (uint8_t p = 0; p < num_points; p++)
+	{
+		if (point_mask & (1u << p))
+		{
+			record(point_spans[p], (t_pwm - point_stamps[p]) * stamp_us);
+		}
+	}
+}
+
+/**
+ * @brief Clears all histograms
+ */
+void Profiler::reset()
+{
+	for (uint8_t s = 0; s < num_spans; s++)
+	{
+		hist_t& hist = hists[s];
+		hist.min = 0xFFFF;
+		hist.max = 0;
+		hist.sum = 0;
+		hist.count = 0;
+		hist.max_cycle = 0;
+		for (uint8_t b = 0; b < num_bins; b++)
+		{
+			hist.bins[b] = 0;
+		}
+	}
+}
+
+/**
+ * @brief Returns histogram of given span
+ */
+const Profiler::hist_t& Profiler::get_hist(span_t span)
+{
+	return hists[span];
+}
+
+/**
+ * @brief Returns tick timestamp [Hal::stamp_res]
+ */
+uint32_t Profiler::stamp()
+{
+	noInterrupts();
+	const uint32_t t = Hal::stamp();
+	interrupts();
+	return t;
+}
+
+/**
+ * @brief Adds span t_span [us] to histogram (counts saturate)
+ */
+void Profiler::record(span_t span, uint32_t t_span)
+{
+	hist_t& hist = hists[span];
+	const uint16_t t = (t_span > 0xFFFF) ? 0xFFFF : (uint16_t)t_span;
+
+	// Update stats
+	if (t < hist.min) hist.min = t;
+	if (t >= hist.max)
+	{
+		hist.max = t;
+		hist.max_cycle = cycle;
+	}
+	if (hist.sum <= 0xFFFFFFFF - t)
+	{
+		hist.sum += t;
+		hist.count++;
+	}
+
+	// Bin by floor(log2(t)) - 2
+	uint8_t bin = 0;
+	for (uint16_t x = t; x >= 8 && bin < num_bins - 1; x >>= 1)
+	{
+		bin++;
+	}
+	if (hist.bins[bin] < 0xFFFF)
+	{
+		hist.bins[bin]++;
+	}
+}
+
+#endif
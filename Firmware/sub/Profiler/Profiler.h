@@ -0,0 +1,91 @@
+/**
+ * @file Profiler.h
+ * @brief Subsystem for control loop timing histograms
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * Each span is timed with micros() and binned into a log2 histogram with
+ * min, max, sum, and the cycle of the worst case. Bin 0 holds spans under
+ * 8 us and bin k holds [2^(k+2), 2^(k+3)) us, with the last bin open-ended.
+ * All spans take 440 bytes of SRAM.
+ *
+ * The latency spans follow one balance step from sensor to actuator. Trace
+ * points store tick timestamps (Hal::stamp) when the IMU sample was latched,
+ * the encoder snapshot was taken, and the control was computed, and
+ * trace_pwm() records the time from each point to the PWM update. Points keep
+ * their last stamp, so a step reusing an older IMU frame counts its full age.
+ *
+ * Without PROFILE_LOOP the timing calls are empty inlines and compile out.
+ */
+#pragma once
+#include <stdint.h>
+
+/**
+ * Namespace Declaration
+ */
+namespace Profiler
+{
+	// Timed spans
+	typedef enum
+	{
+		span_bluetooth = 0,	// Bluetooth::update
+		span_imu,			// Imu::update
+		span_encoder,		// Encoder::update
+		span_motor_l,		// MotorL::update
+		span_motor_r,		// MotorR::update
+		span_controller,	// Controller::update_balance
+		span_yaw,			// Controller::update_yaw
+		span_step,			// Full Scheduler frame
+		span_imu_pwm,		// IMU sample latched to PWM applied
+		span_encoder_pwm,	// Encoder snapshot to PWM applied
+		span_control_pwm,	// Control computed to PWM applied
+		num_spans,
+	}
+	span_t;
+
+	// Latency trace points
+	typedef enum
+	{
+		point_imu = 0,		// IMU sample latched (Mpu::get_stamp)
+		point_encoder,		// Encoder snapshot taken
+		point_control,		// Control computed
+		num_points,
+	}
+	point_t;
+
+	// Histogram bins
+	const uint8_t num_bins = 12;
+
+	// Span histogram
+	typedef struct
+	{
+		uint16_t min;			// Min span [us]
+		uint16_t max;			// Max span [us]
+		uint32_t sum;			// Sum of spans [us]
+		uint32_t count;			// Span count
+		uint32_t max_cycle;		// Cycle of max span
+		uint16_t bins[num_bins];	// Bin counts
+	}
+	hist_t;
+
+#if defined(PROFILE_LOOP)
+
+	uint32_t start();
+	uint32_t lap(span_t span, uint32_t t_start);
+	void end_cycle();
+	void trace(point_t point);
+	void trace_at(point_t point, uint32_t stamp);
+	void trace_pwm();
+	void reset();
+	const hist_t& get_hist(span_t span);
+
+#else
+
+	inline uint32_t start() { return 0; }
+	inline uint32_t lap(span_t, uint32_t) { return 0; }
+	inline void end_cycle() {}
+	inline void trace(point_t) {}
+	inline void trace_at(point_t, uint32_t) {}
+	inline void trace_pwm() {}
+
+#endif
+}
@@ -0,0 +1,208 @@
+/**
+ * @file Protocol.cpp
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#include <Protocol.h>
+#include <string.h>
+#include <math.h>
+#if defined(ARDUINO) || defined(PLATFORM_NATIVE)
+	#include <Arduino.h>
+#else
+	#define PROGMEM
+	#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+	#define pgm_read_float(addr) (*(const float*)(addr))
+#endif
+
+/**
+ * Namespace Definitions
+ */
+namespace Protocol
+{
+	// CRC-16/CCITT-FALSE nibble table (poly 0x1021)
+	const uint16_t crc_table[16] PROGMEM = {
+		0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+		0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+	};
+
+	// Telemetry channel scales (full scale in comments)
+	const float channel_scales[num_channels] PROGMEM = {
+		10000.0f,	// Pitch [+-3.3 rad]
+		1000.0f,	// Pitch velocity [+-33 rad/s]
+		10000.0f,	// Linear velocity [+-3.3 m/s]
+		1000.0f,	// Yaw velocity [+-33 rad/s]
+		1000.0f,	// Left motor voltage [+-33 V]
+		1000.0f,	// Right motor voltage [+-33 V]
+		100.0f,		// Left wheel velocity [+-330 rad/s]
+		100.0f,		// Right wheel velocity [+-330 rad/s]
+		10000.0f,	// Linear velocity command [+-3.3 m/s]
+		1000.0f,	// Yaw velocity command [+-33 rad/s]
+	};
+
+	// Buffer check results
+	typedef enum
+	{
+		check_incomplete = 0,
+		check_complete,		// Header valid and frame buffered, CRC unchecked
+		check_invalid,
+	}
+	check_t;
+
+	// CRC checks per parsed byte (rescans beyond this wait for later bytes)
+	const uint8_t max_crc_checks = 1;
+
+	// Private functions
+	check_t check(const parser_t& parser);
+	bool crc_ok(const parser_t& parser);
+	void discard(parser_t& parser, uint8_t count);
+}
+
+/**
+ * @brief Clears parser buffer and error count
+ */
+void Protocol::reset(parser_t& parser)
+{
+	parser.raw_len = 0;
+	parser.errors = 0;
+}
+
+/**
+ * @brief Adds byte to parser
+ * @return True if a valid frame completed (available in parser.frame)
+ */
+bool Protocol::parse(parser_t& parser, uint8_t byte)
+{
+	// Skip bytes until sync
+	if (parser.raw_len == 0 && byte != sync) return false;
+	parser.raw[parser.raw_len++] = byte;
+
+	// Check buffer, rescanning from the next sync after each rejection
+	// Header rejections are cheap, but each complete candidate costs a CRC
+	// over up to max_frame bytes. Once the per-byte CRC budget is spent, the
+	// rest of a rescan waits for later bytes (unless the buffer is full).
+	uint8_t crc_checks = 0;
+	while (true)
+	{
+		switch (check(parser))
+		{
+			case check_incomplete:
+				return false;
+
+			case check_complete:
+				if (crc_checks == max_crc_checks && parser.raw_len < max_frame)
+				{
+					return false;
+				}
+				crc_checks++;
+				if (crc_ok(parser))
+				{
+					frame_t& frame = parser.frame;
+					frame.id = parser.raw[2];
+					frame.seq = parser.raw[3];
+					frame.len = parser.raw[4];
+					memcpy(frame.payload, parser.raw + header_size, frame.len);
+					discard(parser, header_size + frame.len + crc_size);
+					return true;
+				}
+				parser.errors++;
+				discard(parser, 1);
+				break;
+
+			case check_invalid:
+				parser.errors++;
+				discard(parser, 1);
+				break;
+		}
+	}
+}
+
+/**
+ * @brief Writes frame to buf (at least header_size + len + crc_size bytes)
+ * @return Frame size [bytes]
+ */
+uint8_t Protocol::encode(uint8_t* buf, uint8_t id, uint8_t seq, const void* payload, uint8_t len)
+{
+	buf[0] = sync;
+	buf[1] = version;
+	buf[2] = id;
+	buf[3] = seq;
+	buf[4] = len;
+	memcpy(buf + header_size, payload, len);
+	const uint16_t crc = crc16(buf + 1, header_size - 1 + len);
+	buf[header_size + len + 0] = (uint8_t)crc;
+	buf[header_size + len + 1] = (uint8_t)(crc >> 8);
+	return header_size + len + crc_size;
+}
+
+/**
+ * @brief Returns CRC-16/CCITT-FALSE of data
+ */
+uint16_t Protocol::crc16(const uint8_t* data, uint8_t size)
+{
+	uint16_t crc = 0xFFFF;
+	while (size--)
+	{
+		const uint8_t byte = *data++;
+		crc = (crc << 4) ^ pgm_read_word(&crc_table[(crc >> 12) ^ (byte >> 4)]);
+		crc = (crc << 4) ^ pgm_read_word(&crc_table[(crc >> 12) ^ (byte & 0x0F)]);
+	}
+	return crc;
+}
+
+/**
+ * @brief Returns value as scaled and saturated telemetry channel count
+ * 
+ * NaN maps to channel_nan, which saturation never produces.
+ */
+int16_t Protocol::to_channel(uint8_t channel, float value)
+{
+	const float count = value * pgm_read_float(&channel_scales[channel]);
+	if (isnan(count)) return channel_nan;
+	if (count < -32767.0f) return -32767;
+	if (count > 32767.0f) return 32767;
+	return (int16_t)lroundf(count);
+}
+
+/**
+ * @brief Checks whether buffer starts with a complete frame (CRC unchecked)
+ */
+Protocol::check_t Protocol::check(const parser_t& parser)
+{
+	const uint8_t* raw = parser.raw;
+	const uint8_t raw_len = parser.raw_len;
+	if (raw_len == 0) return check_incomplete;
+	if (raw[0] != sync) return check_invalid;
+	if (raw_len < header_size) return check_incomplete;
+	if (raw[1] != version || raw[4] > max_payload) return check_invalid;
+	const uint8_t frame_size = header_size + raw[4] + crc_size;
+	return (raw_len < frame_size) ? check_incomplete : check_complete;
+}
+
+/**
+ * @brief Returns true if the complete frame at the buffer start has a valid CRC
+ */
+bool Protocol::crc_ok(const parser_t& parser)
+{
+	const uint8_t* raw = parser.raw;
+	const uint8_t frame_size = header_size + raw[4] + crc_size;
+	const uint16_t crc = crc16(raw + 1, frame_size - crc_size - 1);
+	const uint16_t crc_rx = raw[frame_size - 2] | ((uint16_t)raw[frame_size - 1] << 8);
+	return crc == crc_rx;
+}
+
+/**
+ * @brief Drops count bytes then any bytes before the next sync
+ */
+void Protocol::discard(parser_t& parser, uint8_t count)
+{
+	while (count < parser.raw_len && parser.raw[count] != sync)
+	{
+		count++;
+	}
+	if (count >= parser.raw_len)
+	{
+		parser.raw_len = 0;
+		return;
+	}
+	parser.raw_len -= count;
+	memmove(parser.raw, parser.raw + count, parser.raw_len);
+}
@@ -0,0 +1,101 @@
+/**
+ * @file Protocol.h
+ * @brief Framed serial protocol shared by the robot and host tools
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * Frame layout (multi-byte fields little-endian):
+ *
+ *   sync | version | id | seq | len | payload[len] | crc16
+ *
+ * The CRC is CRC-16/CCITT-FALSE over version through payload. parse() takes
+ * one byte at a time and does at most one CRC per byte (two once its buffer
+ * is full), the same work as completing a frame. After a corrupt or truncated
+ * frame it rescans the buffered bytes for the next sync, so a valid frame
+ * following the damage is never lost; a rescan needing more CRCs finishes
+ * over the following bytes, which can delay such a frame by a few bytes.
+ * Unknown message IDs parse normally and are left for the receiver to
+ * ignore, which keeps the protocol open to new message types without a
+ * version bump.
+ *
+ * Telemetry frames carry a loop counter, a channel mask, and one int16 per
+ * set mask bit in channel order. Each int16 is the value times its channel
+ * scale, saturated to +-32767; -32768 marks NaN. The stream decimation and
+ * the loop counter both count balance steps (100 Hz at the default
+ * RateConfig). Version 2 made balance steps the decimation unit.
+ */
+#pragma once
+#include <stdint.h>
+
+/**
+ * Namespace Declaration
+ */
+namespace Protocol
+{
+	// Framing
+	const uint8_t sync = 0xA5;			// Start-of-frame byte
+	const uint8_t version = 2;			// Protocol version
+	const uint8_t header_size = 5;		// Sync through len [bytes]
+	const uint8_t crc_size = 2;			// CRC [bytes]
+	const uint8_t max_payload = 48;		// Max payload [bytes]
+	const uint8_t max_frame = header_size + max_payload + crc_size;
+
+	// Message IDs (host to robot < 0x80 <= robot to host)
+	typedef enum
+	{
+		id_cmd_vel = 0x01,		// Velocity commands [float lin_vel, float yaw_vel]
+		id_profile_req = 0x02,	// Profile dump request [empty]
+		id_stream_cfg = 0x03,	// Telemetry config [uint8 decimation (0 = off), uint16 mask]
+		id_record_req = 0x04,	// Recorder command [uint8 (0 = freeze and download, 1 = rearm)]
+		id_state = 0x81,		// State reply [float pitch, lin_vel, yaw_vel, volts_L, volts_R]
+		id_profile = 0x82,		// Profile span [uint8 span, uint8 num_spans, Profiler::hist_t]
+		id_telemetry = 0x83,	// Telemetry [uint32 loop, uint16 mask, int16 channels...]
+		id_record_info = 0x84,	// Recorder info [uint8 reason, uint32 last loop, uint8 blocks]
+		id_record_data = 0x85,	// Recorder block part [uint8 block (0 = oldest), uint8 part, uint8 data[32]]
+	}
+	id_t;
+
+	// Telemetry channels (mask bit = channel)
+	typedef enum
+	{
+		ch_pitch = 0,		// Pitch [rad]
+		ch_pitch_vel,		// Pitch velocity [rad/s]
+		ch_lin_vel,			// Linear velocity [m/s]
+		ch_yaw_vel,			// Yaw velocity [rad/s]
+		ch_volts_L,			// Left motor voltage [V]
+		ch_volts_R,			// Right motor voltage [V]
+		ch_wheel_vel_L,		// Left wheel velocity [rad/s]
+		ch_wheel_vel_R,		// Right wheel velocity [rad/s]
+		ch_lin_vel_cmd,		// Linear velocity command [m/s]
+		ch_yaw_vel_cmd,		// Yaw velocity command [rad/s]
+		num_channels,
+	}
+	channel_t;
+	extern const float channel_scales[num_channels];	// Counts per unit
+	const int16_t channel_nan = -32768;					// Count for NaN
+
+	// Decoded frame
+	typedef struct
+	{
+		uint8_t id;						// Message ID
+		uint8_t seq;					// Sequence number
+		uint8_t len;					// Payload length [bytes]
+		uint8_t payload[max_payload];	// Payload
+	}
+	frame_t;
+
+	// Incremental parser
+	typedef struct
+	{
+		uint8_t raw[max_frame];		// Buffered frame bytes
+		uint8_t raw_len;			// Buffered byte count
+		uint16_t errors;			// Rejected frame count
+		frame_t frame;				// Last valid frame
+	}
+	parser_t;
+
+	void reset(parser_t& parser);
+	bool parse(parser_t& parser, uint8_t byte);
+	uint8_t encode(uint8_t* buf, uint8_t id, uint8_t seq, const void* payload, uint8_t len);
+	uint16_t crc16(const uint8_t* data, uint8_t size);
+	int16_t to_channel(uint8_t channel, float value);
+}
@@ -0,0 +1,153 @@
+/**
+ * @file RateConfig.h
+ * @brief Namespace for the static rate-group schedule
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * The Scheduler releases one minor frame every 1 / f_frame seconds. Each rate
+ * group runs in the frames where (frame - phase) is a multiple of its divider,
+ * so its period is div / f_frame. Dividers must divide frames_per_cycle, the
+ * length of the repeating schedule, and phases spread the slow groups over
+ * different frames.
+ *
+ * Sense and balance run every frame, so the frame rate is the balance rate.
+ * It defaults to 100 Hz, the control rate the single-rate loop was measured
+ * to sustain on the Uno (GET_MAX_CTRL_FREQ), and can be set with
+ * -D RATE_FRAME_HZ. It must divide Hal::tick_freq. Yaw and comms run at half
+ * the balance rate in alternate frames, so no frame does both. Every rate and
+ * period below is constexpr, so discretization constants in the subsystems
+ * fold at compile time, and the group rates scale with the frame rate.
+ *
+ * Each group has a worst-case time budget. Uno builds check at compile time
+ * that the groups due in any frame fit within frame_budget, which leaves
+ * headroom for ISRs and background serial work. The budgets are estimates
+ * for the Uno, not measurements; replace them with the PROFILE_LOOP span
+ * maxima (Profiler.h) of an Uno build before raising the frame rate, and
+ * measure headroom with BENCH_LOOP (Bench.h).
+ */
+#pragma once
+#include <stdint.h>
+
+/**
+ * Namespace Declaration
+ */
+namespace RateConfig
+{
+	// Rate groups
+	typedef enum
+	{
+		group_sense = 0,	// Imu, MotorL, MotorR updates
+		group_balance,		// Pitch-velocity control, motor outputs, recorder, telemetry
+		group_yaw,			// Yaw velocity control
+		group_comms,		// Bluetooth commands and replies
+		num_groups,
+	}
+	group_t;
+
+	// Rate group schedule entry
+	typedef struct
+	{
+		uint16_t div;		// Frames per period
+		uint16_t phase;		// First frame in cycle
+		uint16_t budget;	// Worst-case time budget [us]
+	}
+	entry_t;
+}
+
+/**
+ * Namespace Definitions
+ */
+namespace RateConfig
+{
+	// Minor frame
+#if defined(RATE_FRAME_HZ)
+	constexpr float f_frame = RATE_FRAME_HZ;			// Frame rate [Hz]
+#else
+	constexpr float f_frame = 100.0f;					// Frame rate [Hz]
+#endif
+	constexpr float t_frame = 1.0f / f_frame;			// Frame period [s]
+	constexpr uint16_t frames_per_cycle = 8;			// Schedule length [frames]
+	constexpr uint16_t frame_budget =
+		(uint16_t)(0.8f * 1.0e6f * t_frame);			// Usable time per frame [us]
+
+	// Schedule (indexed by group_t)
+	constexpr entry_t schedule[num_groups] = {
+		{1, 0, 1200},	// Sense (100 Hz at default f_frame)
+		{1, 0, 800},	// Balance (100 Hz)
+		{2, 0, 300},	// Yaw (50 Hz)
+		{2, 1, 600},	// Comms (50 Hz)
+	};
+
+	/**
+	 * @brief Returns rate of group [Hz]
+	 */
+	constexpr float f_group(group_t group)
+	{
+		return f_frame / schedule[group].div;
+	}
+
+	/**
+	 * @brief Returns period of group [s]
+	 */
+	constexpr float t_group(group_t group)
+	{
+		return schedule[group].div / f_frame;
+	}
+
+	// Group rates [Hz] and periods [s]
+	constexpr float f_sense = f_group(group_sense);
+	constexpr float t_sense = t_group(group_sense);
+	constexpr float f_balance = f_group(group_balance);
+	constexpr float t_balance = t_group(group_balance);
+	constexpr float f_yaw = f_group(group_yaw);
+	constexpr float t_yaw = t_group(group_yaw);
+	constexpr float f_comms = f_group(group_comms);
+	constexpr float t_comms = t_group(group_comms);
+
+	/**
+	 * @brief Returns true if group runs in frame
+	 * @param group Rate group
+	 * @param frame Frame index in cycle [0, frames_per_cycle)
+	 */
+	constexpr bool due(group_t group, uint16_t frame)
+	{
+		return (frame % schedule[group].div) == schedule[group].phase;
+	}
+
+	/**
+	 * @brief Returns true if every divider and phase fits the cycle
+	 */
+	constexpr bool schedule_valid()
+	{
+		for (uint8_t g = 0; g < num_groups; g++)
+		{
+			const entry_t& e = schedule[g];
+			if (e.div == 0 || frames_per_cycle % e.div != 0) return false;
+			if (e.phase >= e.div) return false;
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Returns the largest total budget of any frame in the cycle [us]
+	 */
+	constexpr uint32_t frame_load_max()
+	{
+		uint32_t load_max = 0;
+		for (uint16_t f = 0; f < frames_per_cycle; f++)
+		{
+			uint32_t load = 0;
+			for (uint8_t g = 0; g < num_groups; g++)
+			{
+				if (due((group_t)g, f)) load += schedule[g].budget;
+			}
+			if (load > load_max) load_max = load;
+		}
+		return load_max;
+	}
+
+	// Compile-time schedule checks
+	static_assert(schedule_valid(), "Rate group divider or phase does not fit the cycle");
+#if !defined(PLATFORM_NATIVE)
+	static_assert(frame_load_max() <= frame_budget, "Rate group budgets exceed a frame");
+#endif
+}
@@ -0,0 +1,237 @@
+/**
+ * @file Recorder.cpp
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#include <Recorder.h>
+#if defined(FLIGHT_RECORDER)
+#include <Hal.h>
+#include <Protocol.h>
+#include <Imu.h>
+#include <MotorL.h>
+#include <MotorR.h>
+#include <Controller.h>
+#include <Scheduler.h>
+#include <RateConfig.h>
+#include <string.h>
+
+/**
+ * Namespace Definitions
+ */
+namespace Recorder
+{
+	// Protocol channel of each recorded channel
+	const uint8_t channels[num_channels] = {
+		Protocol::ch_pitch,
+		Protocol::ch_pitch_vel,
+		Protocol::ch_wheel_vel_L,
+		Protocol::ch_wheel_vel_R,
+		Protocol::ch_volts_L,
+		Protocol::ch_volts_R,
+	};
+
+	// Adaptive delta coding
+	const uint8_t nibbles_per_step = num_channels + 1;
+	const uint8_t shift_max = 15;
+	const int16_t resync_error = 1024;	// Error forcing a keyframe [counts]
+	const uint8_t key_bin = 2 * num_channels + 3;	// Keyframe step bin index
+	const uint8_t key_steps = key_bin + 1;			// Block step count index
+
+	// Block ring
+	static_assert(num_blocks * block_steps * RateConfig::t_balance >= min_seconds,
+		"Recorder ring is too short at this balance rate, raise RECORDER_BLOCKS");
+	uint8_t blocks[num_blocks][block_size];
+	uint8_t block_head = 0;		// Block being written
+	uint8_t block_count = 0;	// Blocks holding data
+	uint8_t head_steps = 0;		// Steps in block being written
+
+	// Encoder state
+	int16_t recon[num_channels];	// Reconstructed values
+	uint8_t shifts[num_channels];	// Delta shifts
+
+	// Trigger state
+	reason_t reason = reason_none;
+	uint32_t last_loop = 0;			// Loop count of newest step
+	uint32_t t_start = 0;			// Step start time [us]
+	uint16_t overruns = 0;			// Last seen overrun count
+	bool tipped = false;			// Last seen tip-over state
+
+	// Private functions
+	uint8_t step_bin(uint32_t t_step);
+	void set_nibble(uint8_t* data, uint16_t index, uint8_t value);
+}
+
+/**
+ * @brief Marks start of control step
+ */
+void Recorder::start()
+{
+	t_start = Hal::micros();
+}
+
+/**
+ * @brief Records control step and freezes on any fault
+ *
+ * Call at the end of each control step after start().
+ */
+void Recorder::record(uint32_t loop_count)
+{
+	if (reason != reason_none) return;
+	const uint8_t bin = step_bin(Hal::micros() - t_start);
+
+	// Sample channels
+	int16_t values[num_channels];
+	values[0] = Protocol::to_channel(channels[0], Imu::get_pitch());
+	values[1] = Protocol::to_channel(channels[1], Imu::get_pitch_vel());
+	values[2] = Protocol::to_channel(channels[2], MotorL::get_velocity());
+	values[3] = Protocol::to_channel(channels[3], MotorR::get_velocity());
+	values[4] = Protocol::to_channel(channels[4], Controller::get_motor_L_cmd());
+	values[5] = Protocol::to_channel(channels[5], Controller::get_motor_R_cmd());
+
+	// Code deltas against reconstruction
+	bool keyframe = (block_count == 0) || (head_steps == block_steps);
+	uint8_t codes[num_channels];
+	int16_t recon_next[num_channels];
+	for (uint8_t c = 0; c < num_channels && !keyframe; c++)
+	{
+		const uint8_t shift = shifts[c];
+		const int32_t diff = (int32_t)values[c] - recon[c];
+		int32_t code = shift ? ((diff + (1l << (shift - 1))) >> shift) : diff;
+		if (code < -8) code = -8;
+		if (code > 7) code = 7;
+		int32_t next = recon[c] + (code << shift);
+		if (next < -32768) next = -32768;
+		if (next > 32767) next = 32767;
+		const int32_t error = (int32_t)values[c] - next;
+		keyframe = (error > resync_error) || (error < -resync_error);
+		codes[c] = (uint8_t)code & 0x0F;
+		recon_next[c] = (int16_t)next;
+	}
+
+	// Start new block with keyframe
+	if (keyframe)
+	{
+		if (block_count > 0) block_head = (block_head + 1) % num_blocks;
+		if (block_count < num_blocks) block_count++;
+		uint8_t* block = blocks[block_head];
+		memcpy(block, values, sizeof(values));
+		for (uint8_t c = 0; c < num_channels; c++)
+		{
+			recon[c] = values[c];
+			set_nibble(block + 2 * num_channels, c, shifts[c]);
+		}
+		block[key_bin] = bin;
+		block[key_steps] = 1;
+		head_steps = 1;
+	}
+
+	// Append delta codes and adapt shifts
+	else
+	{
+		uint8_t* block = blocks[block_head];
+		const uint16_t nibble = (uint16_t)(head_steps - 1) * nibbles_per_step;
+		for (uint8_t c = 0; c < num_channels; c++)
+		{
+			recon[c] = recon_next[c];
+			set_nibble(block + key_size, nibble + c, codes[c]);
+			const int8_t code = (codes[c] & 0x08) ? (int8_t)codes[c] - 16 : codes[c];
+			if ((code >= 4 || code <= -4) && shifts[c] < shift_max) shifts[c]++;
+			if ((code <= 1 && code >= -1) && shifts[c] > 0) shifts[c]--;
+		}
+		set_nibble(block + key_size, nibble + num_channels, bin);
+		block[key_steps] = ++head_steps;
+	}
+
+	// Check triggers (the triggering step is the last one kept)
+	const bool tipped_now = Controller::is_tipped();
+	const uint16_t overruns_now = Scheduler::get_overruns();
+	if (tipped_now && !tipped) freeze(reason_tip);
+	else if (!Imu::get_i2c_ok()) freeze(reason_i2c);
+	else if (overruns_now != overruns) freeze(reason_overrun);
+	tipped = tipped_now;
+	overruns = overruns_now;
+	last_loop = loop_count;
+}
+
+/**
+ * @brief Stops recording, keeping the steps before the freeze
+ */
+void Recorder::freeze(reason_t cause)
+{
+	if (reason == reason_none) reason = cause;
+}
+
+/**
+ * @brief Clears recording and starts recording again
+ */
+void Recorder::rearm()
+{
+	block_head = 0;
+	block_count = 0;
+	head_steps = 0;
+	for (uint8_t c = 0; c < num_channels; c++)
+	{
+		shifts[c] = 0;
+	}
+	tipped = Controller::is_tipped();
+	overruns = Scheduler::get_overruns();
+	reason = reason_none;
+}
+
+/**
+ * @brief Returns freeze reason (reason_none while recording)
+ */
+Recorder::reason_t Recorder::get_reason()
+{
+	return reason;
+}
+
+/**
+ * @brief Returns loop count of newest recorded step
+ */
+uint32_t Recorder::get_last_loop()
+{
+	return last_loop;
+}
+
+/**
+ * @brief Returns number of blocks holding data
+ */
+uint8_t Recorder::get_num_blocks()
+{
+	return block_count;
+}
+
+/**
+ * @brief Returns block by age (0 = oldest)
+ */
+const uint8_t* Recorder::get_block(uint8_t index)
+{
+	const uint8_t oldest = (block_head + num_blocks + 1 - block_count) % num_blocks;
+	return blocks[(oldest + index) % num_blocks];
+}
+
+/**
+ * @brief Returns 4-bit log2 bin of step time
+ */
+uint8_t Recorder::step_bin(uint32_t t_step)
+{
+	uint8_t bin = 0;
+	t_step >>= 3;
+	while (t_step && bin < 15)
+	{
+		t_step >>= 1;
+		bin++;
+	}
+	return bin;
+}
+
+/**
+ * @brief Writes 4-bit value at nibble index (low nibble first)
+ */
+void Recorder::set_nibble(uint8_t* data, uint16_t index, uint8_t value)
+{
+	uint8_t& byte = data[index >> 1];
+	byte = (index & 1) ? ((byte & 0x0F) | (value << 4)) : ((byte & 0xF0) | value);
+}
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ * @file Recorder.h
+ * @brief Subsystem for the on-board black-box flight recorder
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * Records every control step into a ring of fixed-size blocks and freezes on
+ * tip-over, I2C failure, or scheduler overrun so the steps leading up to the
+ * fault can be downloaded afterwards.
+ *
+ * The ring spans num_blocks * block_steps balance steps, 2.24 s with the
+ * default 7 blocks at the default 100 Hz balance rate (RateConfig.h), less
+ * any blocks cut short by a resync. Builds check that it spans at least
+ * min_seconds; a faster balance rate needs more RECORDER_BLOCKS, at 128 bytes
+ * of SRAM each.
+ *
+ * Each channel is quantized with its telemetry scale (Protocol.h). A block
+ * starts with a keyframe of the raw int16 channel values, then stores each
+ * following step as one 4-bit code per channel. A code c adds c << shift to
+ * the previous reconstructed value; the encoder tracks the reconstruction so
+ * errors never accumulate, and the per-channel shift adapts after every code
+ * (up if |c| >= 4, down if |c| <= 1). A step which the codes cannot follow
+ * within resync_error counts, such as the motor cutoff at tip-over, starts a
+ * new block early so it is stored exactly. Step time is stored as a 4-bit
+ * log2 bin (0 under 8 us, k in [2^(k+2), 2^(k+3)) us, as in Profiler.h).
+ *
+ * Block layout (128 bytes, up to 32 steps):
+ *
+ *   int16 values[6] | uint8 shifts[3] | uint8 step_bin | uint8 steps | uint8 codes[109] | pad
+ *
+ * Shifts and codes are packed as nibbles, low nibble first. Codes are stored
+ * step by step, 7 nibbles per step (6 channels, then step bin).
+ *
+ * Without FLIGHT_RECORDER the recording calls are empty inlines and the
+ * buffer takes no SRAM.
+ */
+#pragma once
+#include <stdint.h>
+
+/**
+ * Namespace Declaration
+ */
+namespace Recorder
+{
+	// Recorded channels (each maps to a Protocol channel and scale)
+	const uint8_t num_channels = 6;
+
+	// Block layout
+	const uint8_t block_size = 128;		// Block size [bytes]
+	const uint8_t block_steps = 32;		// Max steps per block
+	const uint8_t key_size = 17;		// Keyframe size [bytes]
+
+	// Freeze reasons
+	typedef enum
+	{
+		reason_none = 0,	// Recording
+		reason_tip,			// Pitch exceeded controller limit
+		reason_i2c,			// IMU read failed
+		reason_overrun,		// Scheduler overrun
+		reason_host,		// Download requested
+	}
+	reason_t;
+
+#if defined(FLIGHT_RECORDER)
+
+	// Ring size
+#if defined(RECORDER_BLOCKS)
+	const uint8_t num_blocks = RECORDER_BLOCKS;
+#else
+	const uint8_t num_blocks = 7;
+#endif
+	constexpr float min_seconds = 2.0f;	// Min recorded time [s]
+
+	void start();
+	void record(uint32_t loop_count);
+	void freeze(reason_t cause);
+	void rearm();
+	reason_t get_reason();
+	uint32_t get_last_loop();
+	uint8_t get_num_blocks();
+	const uint8_t* get_block(uint8_t index);
+
+#else
+
+	inline void start() {}
+	inline void record(uint32_t) {}
+
+#endif
+}
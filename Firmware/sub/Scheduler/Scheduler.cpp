@@ -0,0 +1,118 @@
+/**
+ * @file Scheduler.cpp
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#include <Scheduler.h>
+#include <RateConfig.h>
+#include <Controller.h>
+#include <Hal.h>
+#include <Arduino.h>
+using RateConfig::frames_per_cycle;
+
+/**
+ * Namespace Definitions
+ */
+namespace Scheduler
+{
+	// Tick divider
+	constexpr uint16_t ticks_per_frame = (uint16_t)(Hal::tick_freq / RateConfig::f_frame);
+	static_assert(ticks_per_frame * RateConfig::f_frame == Hal::tick_freq,
+		"Frame rate must divide Hal::tick_freq");
+
+	// Interrupt state
+	volatile uint16_t tick_count = 0;		// Ticks since last release
+	volatile bool released = false;			// Frame released
+	volatile bool running = false;			// Frame running
+	volatile uint16_t overruns = 0;			// Missed releases
+	volatile uint16_t frame_next = 0;		// Index of next release
+	volatile uint16_t frame_released = 0;	// Index of pending release
+
+	// Running frame index
+	uint16_t frame = 0;
+
+	// Init flag
+	bool init_complete = false;
+
+	// Private functions
+	void tick();
+}
+
+/**
+ * @brief Starts the control tick interrupt
+ */
+void Scheduler::init()
+{
+	if (!init_complete)
+	{
+		// Init dependent subsystems
+		Controller::init();
+
+		// Start tick
+		Hal::tick_start(tick);
+
+		// Set init flag
+		init_complete = true;
+	}
+}
+
+/**
+ * @brief Returns true once per frame period when the frame is released
+ */
+bool Scheduler::ready()
+{
+	noInterrupts();
+	const bool release = released;
+	if (release)
+	{
+		released = false;
+		running = true;
+		frame = frame_released;
+	}
+	interrupts();
+	return release;
+}
+
+/**
+ * @brief Returns index of the running frame [0, frames_per_cycle)
+ */
+uint16_t Scheduler::get_frame()
+{
+	return frame;
+}
+
+/**
+ * @brief Marks the current frame as complete
+ */
+void Scheduler::done()
+{
+	running = false;
+}
+
+/**
+ * @brief Returns number of frame releases which overran
+ */
+uint16_t Scheduler::get_overruns()
+{
+	noInterrupts();
+	const uint16_t count = overruns;
+	interrupts();
+	return count;
+}
+
+/**
+ * @brief Tick ISR which releases the next frame every period
+ */
+void Scheduler::tick()
+{
+	if (++tick_count >= ticks_per_frame)
+	{
+		tick_count = 0;
+		if (released || running)
+		{
+			overruns++;
+		}
+		released = true;
+		frame_released = frame_next;
+		if (++frame_next >= frames_per_cycle) frame_next = 0;
+	}
+}
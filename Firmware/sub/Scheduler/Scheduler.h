@@ -0,0 +1,27 @@
+/**
+ * @file Scheduler.h
+ * @brief Subsystem for timer-driven control loop release
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * The Hal tick interrupt releases one minor frame every RateConfig::t_frame.
+ * The main loop runs background work (serial commands) until the next
+ * release, then runs the rate groups due in that frame (RateConfig::due) and
+ * marks it done. A release which arrives while the previous frame is still
+ * pending or running is counted as an overrun; the tick phase is never
+ * shifted, so the frame period does not stretch, and get_frame() follows the
+ * release count so a late frame does not shift the group phases.
+ */
+#pragma once
+#include <stdint.h>
+
+/**
+ * Namespace Declaration
+ */
+namespace Scheduler
+{
+	void init();
+	bool ready();
+	uint16_t get_frame();
+	void done();
+	uint16_t get_overruns();
+}
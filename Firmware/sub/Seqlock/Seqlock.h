@@ -0,0 +1,97 @@
+/**
+ * @file Seqlock.h
+ * @brief Lock-free snapshot of state written by an ISR
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * The writer makes the sequence count odd, changes the state, then makes it
+ * even again. The reader copies the state between two reads of the count and
+ * retries if they differ or are odd, so it always returns a state which was
+ * whole at some instant without masking interrupts. Reads only retry when an
+ * ISR lands inside the copy, which costs the loop a few cycles instead of
+ * delaying the ISR.
+ *
+ * The count is a single byte, so it is read and written atomically on the
+ * AVR. Writers must not nest or run concurrently (ISRs do not nest on the
+ * AVR, and the native stand-in runs pin ISRs on the thread driving the pin).
+ * The fences are GCC builtins, as <atomic> is not available on the AVR; there
+ * they only stop the compiler reordering, and on the host they also order the
+ * simulated ISR thread against the loop.
+ *
+ * On the host the reader copies the state byte by byte with relaxed atomic
+ * loads, so the compiler can neither tear nor cache the copy. The writer
+ * still modifies the state with plain stores, which the C++ memory model
+ * counts as a race with those loads; the host path is best-effort in that
+ * sense, and test_seqlock checks it under a writer thread. T must be
+ * trivially copyable.
+ */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Class Declaration
+ */
+template <typename T>
+class Seqlock
+{
+public:
+	Seqlock() : seq(0), state() {}
+
+	/**
+	 * @brief Starts a write and returns the state to modify (writer only)
+	 */
+	T& write_begin()
+	{
+		__atomic_store_n(&seq, (uint8_t)(seq + 1), __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		return state;
+	}
+
+	/**
+	 * @brief Publishes the state modified since write_begin() (writer only)
+	 */
+	void write_end()
+	{
+		__atomic_store_n(&seq, (uint8_t)(seq + 1), __ATOMIC_RELEASE);
+	}
+
+	/**
+	 * @brief Copies a consistent state (reader only)
+	 * @return Number of retries
+	 */
+	uint8_t read(T& copy) const
+	{
+		uint8_t retries = 0;
+		while (true)
+		{
+			const uint8_t seq_start = __atomic_load_n(&seq, __ATOMIC_ACQUIRE);
+#if defined(PLATFORM_NATIVE)
+			copy_relaxed(copy);
+#else
+			copy = state;
+#endif
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			const uint8_t seq_end = __atomic_load_n(&seq, __ATOMIC_RELAXED);
+			if (seq_start == seq_end && !(seq_start & 1)) return retries;
+			if (retries < UINT8_MAX) retries++;
+		}
+	}
+protected:
+#if defined(PLATFORM_NATIVE)
+	/**
+	 * @brief Copies state with relaxed atomic byte loads (host only)
+	 */
+	void copy_relaxed(T& copy) const
+	{
+		const uint8_t* src = (const uint8_t*)&state;
+		uint8_t* dst = (uint8_t*)&copy;
+		for (size_t i = 0; i < sizeof(T); i++)
+		{
+			dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+		}
+	}
+#endif
+
+	uint8_t seq;	// Sequence count (odd while writing)
+	T state;		// Shared state
+};
@@ -0,0 +1,75 @@
+/**
+ * @file reference.h
+ * @brief Float build outputs of test_chain (TEST_CHAIN_RECORD)
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#pragma once
+#include <stdint.h>
+
+const int ref_bot_id = 2;			// ES3011_BOT_ID
+const float ref_f_balance = 100.0f;	// Balance rate [Hz]
+const uint32_t ref_rows = 60;		// Decimated balance steps
+
+// [pitch, pitch_vel, yaw_vel, lin_vel, volts_L, volts_R]
+const float ref[ref_rows][6] = {
+	{0.0500071608, 0, 2.41257621e-05, -0, -0.919142067, -0.919183791},
+	{0.011286716, -0.138905168, 0.00148879294, -0.0171558298, -0.364481509, -0.367289603},
+	{0.00682771252, -0.150762737, -0.0018357198, -0.052625183, -1.01226544, -1.00909448},
+	{0.00537950359, -0.105197661, -0.000240789479, -0.0518670455, -1.03627682, -1.03217506},
+	{-0.000189398183, -0.144234419, 0.00135769311, -0.0671397895, -1.19442832, -1.19677365},
+	{-0.00396021176, -0.111859225, 0.0026860307, -0.0702371076, -1.23725939, -1.23913527},
+	{-0.00727573875, -0.118787251, 0.00121841172, -0.0757455081, -1.28169334, -1.28379786},
+	{-0.0104909381, -0.110393681, 0.00254950137, -0.0784640983, -1.29283786, -1.29284024},
+	{-0.0134048462, -0.100001641, 0.000956035045, -0.0794931799, -1.27510595, -1.27675748},
+	{-0.0152762178, -0.0756203309, 0.000148358231, -0.0783717409, -1.25658834, -1.25014079},
+	{-0.0166203156, -0.0658944473, 0.00255417242, -0.0766730607, -1.20492661, -1.20933855},
+	{-0.0180705208, -0.0457765311, 0.00201147282, -0.0727915838, -1.12669671, -1.12977326},
+	{-0.0183363818, -0.0347183347, 0.000400569988, -0.0701255202, -1.08311713, -1.08380902},
+	{-0.0187698565, -0.0345851034, -0.00330231548, -0.0661014467, -0.989958048, -0.992614746},
+	{-0.0181141533, -0.00847177953, 0.0037914305, -0.0622660331, -0.957481563, -0.964030683},
+	{-0.0182290133, -0.0263247713, -0.00316679268, -0.0590748489, -0.868237019, -0.86341536},
+	{-0.0175143369, -0.00567393005, 0.00094383338, -0.0534573197, -0.790265679, -0.791895986},
+	{-0.0165074766, -0.00260961056, -0.00190688064, -0.0503456295, -0.747615695, -0.749914289},
+	{-0.015522833, 0.000721171498, -0.0017106114, -0.0461700633, -0.685590386, -0.682635546},
+	{-0.0147219114, 0.008981511, 0.00112438644, -0.0421882421, -0.625751913, -0.628838718},
+	{-0.0137178367, 0.00724950433, -0.000514894142, -0.0385793783, -0.56799072, -0.5671013},
+	{-0.0134502184, -0.0191302821, 0.124381498, -0.0393272825, -1.38883901, -0.0704161525},
+	{-0.019226322, -0.174211442, 0.5765692, -0.0556263775, -2.20243263, 0.272191644},
+	{-0.0307042655, -0.270404398, 0.963788688, -0.0539312959, -2.20983648, 0.602280974},
+	{-0.0407863781, -0.205654025, 1.00357425, -0.0335464738, -1.81178188, 0.792894363},
+	{-0.0498732217, -0.227503955, 0.991952419, -0.0226647947, -1.62471068, 1.01038897},
+	{-0.059319701, -0.205654025, 0.998491943, 0.00618623942, -0.911737204, 1.70171809},
+	{-0.0607367717, -0.022860758, 0.991628587, 0.0436568968, -0.373795509, 2.25763845},
+	{-0.0579275638, 0.0265680328, 0.995230019, 0.0667238683, -0.00711238384, 2.61197758},
+	{-0.0542508923, 0.0420228541, 1.00085151, 0.0899776146, 0.397361994, 3.00299048},
+	{-0.048797898, 0.0941162705, 1.00120628, 0.117399149, 0.795179844, 3.4039464},
+	{-0.0421797447, 0.106773242, 1.00098205, 0.135715216, 1.03716981, 3.65029669},
+	{-0.0361184217, 0.0966476649, 1.00126898, 0.150935665, 1.26191354, 3.87057185},
+	{-0.0302928928, 0.101843685, 0.999681115, 0.166815788, 1.47746634, 4.09194756},
+	{-0.0248042159, 0.094782427, 1.00035977, 0.178769678, 1.63967073, 4.24989939},
+	{-0.0200476758, 0.0914516449, 0.999135435, 0.191571161, 1.82661426, 4.43476295},
+	{-0.0153696928, 0.0830580741, 1.00148988, 0.201697886, 1.96513772, 4.5734148},
+	{-0.0109995492, 0.0873214751, 0.999372125, 0.211580276, 2.08434415, 4.69574642},
+	{-0.00723358802, 0.0698681846, 0.999007165, 0.216477811, 2.1425705, 4.75513601},
+	{-0.00426836824, 0.0682694092, 0.999873042, 0.224163845, 2.25189877, 4.86385727},
+	{-0.00121106592, 0.0637395456, 1.00008357, 0.228722245, 2.29850769, 4.90921354},
+	{0.00163760991, 0.0716001913, 0.876531303, 0.239060163, 3.29063368, 4.58268309},
+	{0.0102614453, 0.226947814, 0.416297257, 0.259587616, 4.13383484, 4.28238297},
+	{0.0228720978, 0.276376605, 0.028001966, 0.260929704, 4.25437355, 4.06053448},
+	{0.0356945395, 0.286502182, -0.00426957104, 0.25691995, 4.04395437, 4.05132914},
+	{0.0483922884, 0.290099412, 0.00192587997, 0.24672389, 3.82614684, 3.81352162},
+	{0.0597965643, 0.259189785, 0.00053202454, 0.224985003, 3.24446511, 3.24354625},
+	{0.0638087317, 0.0702678785, -0.00171311712, 0.188709751, 2.68377781, 2.68289089},
+	{0.0624707602, 0.00871504843, 0.00105438684, 0.166189834, 2.32574511, 2.32392359},
+	{0.0595213175, -0.0255253837, -0.000501849456, 0.144639298, 1.97627831, 1.97709203},
+	{0.0547194891, -0.0710904673, 0.00283414964, 0.123618565, 1.69256401, 1.68766832},
+	{0.0495612212, -0.0781517252, -0.000434472342, 0.107371993, 1.45546806, 1.45334303},
+	{0.0444346294, -0.0738883242, -0.000460822397, 0.0920382887, 1.22044146, 1.22123754},
+	{0.0393461734, -0.0820154324, 0.000551599602, 0.0778029338, 1.02669966, 1.02845085},
+	{0.0346225463, -0.0817489699, -0.000792939798, 0.065872103, 0.863085866, 0.864455581},
+	{0.0301187299, -0.0760200247, -0.00162972009, 0.0552359484, 0.717105091, 0.713216484},
+	{0.0259218551, -0.0708240047, -0.000418384472, 0.0452048667, 0.574011326, 0.574733973},
+	{0.0223441031, -0.0593661144, 0.00216176594, 0.0370625407, 0.454038143, 0.451443553},
+	{0.0190954972, -0.0548362508, -0.000256974105, 0.029063778, 0.337893575, 0.338337451},
+	{0.0159944016, -0.0497734696, 0.00294695026, 0.0216630436, 0.232131451, 0.232967168},
+};
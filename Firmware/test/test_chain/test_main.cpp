@@ -0,0 +1,260 @@
+/**
+ * @file test_main.cpp
+ * @brief Closed-loop signal chain of the real subsystems against the float build
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * Runs the unmodified Imu, Encoder, Motor and Controller subsystems against
+ * the Plant model over the Sim stand-ins, one Scheduler frame at a time as in
+ * loop(), and compares the estimator and controller outputs of each balance
+ * step with reference.h, recorded from the float build. The float build must
+ * reproduce the reference to rounding. The BALBOT_FIXED_POINT build runs the
+ * Q16.16 paths of Imu::update() and Controller::update_balance() in the same
+ * loop and must stay within the quantization bounds below.
+ *
+ * After changing gains, rates, or the plant, regenerate reference.h from the
+ * float build with -D TEST_CHAIN_RECORD, which prints it instead of testing.
+ * The plant noise comes from std::normal_distribution, so the reference holds
+ * for the libstdc++ of the GNU toolchain used by the native envs.
+ *
+ * Run with: pio test -e native_test -e native_test_fixed -f test_chain
+ */
+#include <unity.h>
+#include <Sim.h>
+#include <Plant.h>
+#include <Protocol.h>
+#include <Bluetooth.h>
+#include <Imu.h>
+#include <Mpu.h>
+#include <Encoder.h>
+#include <MotorL.h>
+#include <MotorR.h>
+#include <MotorPwm.h>
+#include <Controller.h>
+#include <RateConfig.h>
+#include <math.h>
+#include <stdio.h>
+#if !defined(TEST_CHAIN_RECORD)
+	#include "reference.h"
+#endif
+using RateConfig::due;
+using RateConfig::frames_per_cycle;
+
+/**
+ * Test Constants
+ */
+const float t_run = 3.0f;				// Simulated time [s]
+const float t_cmd_on = 1.0f;			// Command step on [s]
+const float t_cmd_off = 2.0f;			// Command step off [s]
+const float lin_cmd = 0.2f;				// Linear velocity command [m/s]
+const float yaw_cmd = 1.0f;				// Yaw velocity command [rad/s]
+const float pitch0 = 0.05f;				// Initial lean [rad]
+const uint32_t seed = 1;				// Plant noise seed
+const uint32_t cmd_steps = 5;			// Frames per command frame
+const uint32_t ref_decimation = 5;		// Balance steps per reference row
+const uint32_t max_rows = 400;			// Recorded rows limit
+const uint8_t num_signals = 6;			// Outputs per row
+
+// Tolerances [pitch, pitch_vel, yaw_vel, lin_vel, volts_L, volts_R]
+const float tol_float[num_signals] = {
+	1.0e-4f, 1.0e-3f, 1.0e-3f, 1.0e-4f, 1.0e-3f, 1.0e-3f,
+};
+const float tol_fixed[num_signals] = {
+	2.0e-3f, 3.0e-2f, 1.0e-2f, 1.0e-2f, 0.15f, 0.15f,
+};
+
+/**
+ * Test State
+ */
+float rows[max_rows][num_signals];		// Decimated balance step outputs
+uint32_t num_rows = 0;					// Rows recorded
+bool tipped = false;					// Controller reported tip-over
+
+/**
+ * @brief Queues a velocity command frame on the serial port
+ */
+void send_cmds(float lin, float yaw)
+{
+	static uint8_t seq = 0;
+	const float cmds[2] = {lin, yaw};
+	uint8_t frame[Protocol::max_frame];
+	const uint8_t size = Protocol::encode(frame,
+		Protocol::id_cmd_vel, seq++, cmds, sizeof(cmds));
+	Sim::serial_rx(frame, size);
+}
+
+/**
+ * @brief Initializes the subsystems as setup() does and runs the scenario
+ *
+ * Mirrors MonteCarlo::simulate(): the plant is placed after initialization
+ * and Mpu::init() rerun so the first frame reads the initial attitude.
+ */
+void run_chain()
+{
+	Bluetooth::init();
+	Imu::init();
+	MotorL::init();
+	MotorR::init();
+	MotorPwm::init();
+	Controller::init();
+	Sim::serial_capture(true);
+	const Plant::state_t x0 = {0.0f, 0.0f, pitch0, 0.0f, 0.0f, 0.0f};
+	Plant::init(Plant::nominal(), x0, seed);
+	Mpu::init();
+
+	const float f_frame = RateConfig::f_frame;
+	const uint32_t t_frame_us = (uint32_t)lroundf(1.0e6f / f_frame);
+	const uint32_t steps = (uint32_t)(t_run * f_frame);
+	uint32_t balance_steps = 0;
+	for (uint32_t k = 0; k < steps; k++)
+	{
+		const float t = k / f_frame;
+		const uint16_t frame = k % frames_per_cycle;
+
+		// Plant and commands
+		Plant::advance(t_frame_us);
+		if (k % cmd_steps == 0)
+		{
+			const bool on = (t >= t_cmd_on) && (t < t_cmd_off);
+			send_cmds(on ? lin_cmd : 0.0f, on ? yaw_cmd : 0.0f);
+		}
+
+		// Firmware frame
+		Bluetooth::drain();
+		uint8_t tx[64];
+		while (Sim::serial_tx(tx, sizeof(tx)) > 0);
+		if (due(RateConfig::group_sense, frame))
+		{
+			Imu::update();
+			Encoder::update();
+			MotorL::update();
+			MotorR::update();
+		}
+		if (due(RateConfig::group_yaw, frame))
+		{
+			Controller::update_yaw();
+		}
+		if (due(RateConfig::group_balance, frame))
+		{
+			Controller::update_balance();
+#if defined(BALBOT_FIXED_POINT)
+			MotorPwm::set_voltages_q16(
+				Controller::get_motor_L_cmd_q16(), Controller::get_motor_R_cmd_q16());
+#else
+			MotorPwm::set_voltages(
+				Controller::get_motor_L_cmd(), Controller::get_motor_R_cmd());
+#endif
+			if (balance_steps % ref_decimation == 0 && num_rows < max_rows)
+			{
+				float* row = rows[num_rows++];
+				row[0] = Imu::get_pitch();
+				row[1] = Imu::get_pitch_vel();
+				row[2] = Imu::get_yaw_vel();
+				row[3] = Controller::get_lin_vel();
+				row[4] = Controller::get_motor_L_cmd();
+				row[5] = Controller::get_motor_R_cmd();
+			}
+			balance_steps++;
+		}
+		if (due(RateConfig::group_comms, frame))
+		{
+			Bluetooth::update();
+		}
+		tipped |= Controller::is_tipped();
+	}
+}
+
+#if defined(TEST_CHAIN_RECORD)
+
+/**
+ * @brief Prints the recorded rows as reference.h
+ */
+void print_reference()
+{
+	printf("/**\n");
+	printf(" * @file reference.h\n");
+	printf(" * @brief Float build outputs of test_chain (TEST_CHAIN_RECORD)\n");
+	printf(" * @author Dan Oates (WPI Class of 2020)\n");
+	printf(" */\n");
+	printf("#pragma once\n");
+	printf("#include <stdint.h>\n\n");
+	printf("const int ref_bot_id = %d;\t\t\t// ES3011_BOT_ID\n", ES3011_BOT_ID);
+	printf("const float ref_f_balance = %.1ff;\t// Balance rate [Hz]\n",
+		RateConfig::f_balance);
+	printf("const uint32_t ref_rows = %u;\t\t// Decimated balance steps\n\n",
+		(unsigned)num_rows);
+	printf("// [pitch, pitch_vel, yaw_vel, lin_vel, volts_L, volts_R]\n");
+	printf("const float ref[ref_rows][%u] = {\n", (unsigned)num_signals);
+	for (uint32_t i = 0; i < num_rows; i++)
+	{
+		printf("\t{");
+		for (uint8_t j = 0; j < num_signals; j++)
+		{
+			printf("%s%.9g", j ? ", " : "", rows[i][j]);
+		}
+		printf("},\n");
+	}
+	printf("};\n");
+}
+
+#else
+
+void setUp() {}
+void tearDown() {}
+
+/**
+ * @brief Reference matches this configuration and the robot stays up
+ */
+void test_scenario()
+{
+	TEST_ASSERT_EQUAL_INT(ref_bot_id, ES3011_BOT_ID);
+	TEST_ASSERT_TRUE(ref_f_balance == RateConfig::f_balance);
+	TEST_ASSERT_EQUAL_UINT32(ref_rows, num_rows);
+	TEST_ASSERT_FALSE(tipped);
+}
+
+/**
+ * @brief Every balance step output stays within tolerance of the float build
+ */
+void test_chain_deviation()
+{
+#if defined(BALBOT_FIXED_POINT)
+	const float* tol = tol_fixed;
+#else
+	const float* tol = tol_float;
+#endif
+	float err_max[num_signals] = {0};
+	for (uint32_t i = 0; i < num_rows && i < ref_rows; i++)
+	{
+		for (uint8_t j = 0; j < num_signals; j++)
+		{
+			err_max[j] = fmaxf(err_max[j], fabsf(rows[i][j] - ref[i][j]));
+		}
+	}
+	char msg[80];
+	for (uint8_t j = 0; j < num_signals; j++)
+	{
+		snprintf(msg, sizeof(msg), "Signal %u error %g over %g",
+			(unsigned)j, err_max[j], tol[j]);
+		TEST_MESSAGE(msg);
+		TEST_ASSERT_TRUE_MESSAGE(err_max[j] <= tol[j], msg);
+	}
+}
+
+#endif
+
+/**
+ * @brief Runs all tests
+ */
+int main()
+{
+	run_chain();
+#if defined(TEST_CHAIN_RECORD)
+	print_reference();
+	return 0;
+#else
+	UNITY_BEGIN();
+	RUN_TEST(test_scenario);
+	RUN_TEST(test_chain_deviation);
+	return UNITY_END();
+#endif
+}
@@ -0,0 +1,258 @@
+/**
+ * @file test_main.cpp
+ * @brief Quadrature decoding and M/T rate estimation of the encoders
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * Drives the encoder pins of the Linux stand-in with Sim::set_pin() on the
+ * manual clock. Each pin change runs the edge ISR as on the AVR.
+ *
+ * Run with: pio test -e native_test -f test_encoder
+ */
+#include <unity.h>
+#include <Encoder.h>
+#include <Hal.h>
+#include <Sim.h>
+using Encoder::side_t;
+using Encoder::left;
+using Encoder::right;
+
+/**
+ * Test Constants
+ */
+const uint8_t pin_a[2] = {2, 5};			// Channel A pins [Encoder.cpp]
+const uint8_t pin_b[2] = {3, 4};			// Channel B pins [Encoder.cpp]
+const uint8_t gray[4] = {0x0, 0x2, 0x3, 0x1};	// A << 1 | B with A leading
+const uint32_t t_update = 5000;				// Update period [us]
+
+/**
+ * Test State
+ */
+uint8_t phase[2] = {0, 0};		// Index into gray of each wheel
+float rate_driven[2] = {0, 0};		// Rate of last drive() [cnt/s]
+uint32_t to_edge[2] = {0, 0};		// Time to next driven edge [us]
+
+/**
+ * @brief Sets both channels of wheel to state (A << 1 | B)
+ */
+void set_state(side_t side, uint8_t state)
+{
+	Sim::set_pin(pin_a[side], (state & 0x2) != 0);
+	Sim::set_pin(pin_b[side], (state & 0x1) != 0);
+}
+
+/**
+ * @brief Moves wheel one edge forward (dir = +1) or backward (dir = -1)
+ */
+void step(side_t side, int8_t dir)
+{
+	phase[side] = (phase[side] + dir) & 0x3;
+	set_state(side, gray[phase[side]]);
+}
+
+/**
+ * @brief Returns wheel count after a fresh snapshot
+ */
+int32_t count(side_t side)
+{
+	Encoder::update();
+	return Encoder::get_count(side);
+}
+
+/**
+ * @brief Drives wheel at rate [cnt/s] for duration [us] with updates every
+ * t_update, and returns the rate estimate after the last update [cnt/s]
+ *
+ * Edges are spaced exactly on the manual clock (use rates with a whole
+ * period in us), so the M/T estimate over any window should match the driven
+ * rate. Calls at the same rate continue the edge train.
+ */
+float drive(side_t side, float rate, uint32_t duration)
+{
+	const int8_t dir = (rate < 0.0f) ? -1 : +1;
+	const uint32_t t_edge = (rate != 0.0f) ?
+		(uint32_t)(1.0e6f / (dir * rate) + 0.5f) : UINT32_MAX;
+	if (rate != rate_driven[side])
+	{
+		rate_driven[side] = rate;
+		to_edge[side] = t_edge;
+	}
+	uint32_t to_update = t_update;
+	for (uint32_t t = 0; t < duration;)
+	{
+		const uint32_t dt = (to_edge[side] < to_update) ? to_edge[side] : to_update;
+		Sim::clock_advance(dt);
+		t += dt;
+		to_edge[side] -= dt;
+		to_update -= dt;
+		if (to_edge[side] == 0)
+		{
+			step(side, dir);
+			to_edge[side] = t_edge;
+		}
+		if (to_update == 0)
+		{
+			Encoder::update();
+			to_update = t_update;
+		}
+	}
+	return Encoder::get_rate(side);
+}
+
+void setUp()
+{
+	Sim::clock_manual(true);
+	Encoder::init();
+}
+void tearDown() {}
+
+/**
+ * @brief Full forward cycles count one per edge on that wheel only
+ */
+void test_forward()
+{
+	for (uint8_t side = left; side <= right; side++)
+	{
+		const int32_t start = count((side_t)side);
+		const int32_t other = count((side_t)(side ^ 1));
+		for (uint8_t i = 0; i < 40; i++)
+		{
+			step((side_t)side, +1);
+		}
+		TEST_ASSERT_EQUAL_INT32(start + 40, count((side_t)side));
+		TEST_ASSERT_EQUAL_INT32(other, count((side_t)(side ^ 1)));
+	}
+}
+
+/**
+ * @brief Reverse cycles count down and reversals mid-cycle net out
+ */
+void test_reverse()
+{
+	for (uint8_t side = left; side <= right; side++)
+	{
+		const int32_t start = count((side_t)side);
+		for (uint8_t i = 0; i < 10; i++) step((side_t)side, -1);
+		TEST_ASSERT_EQUAL_INT32(start - 10, count((side_t)side));
+		for (uint8_t i = 0; i < 3; i++) step((side_t)side, +1);
+		for (uint8_t i = 0; i < 3; i++) step((side_t)side, -1);
+		for (uint8_t i = 0; i < 10; i++) step((side_t)side, +1);
+		TEST_ASSERT_EQUAL_INT32(start, count((side_t)side));
+	}
+}
+
+/**
+ * @brief A bouncing channel toggles back and forth without net count
+ */
+void test_bounce()
+{
+	const int32_t start = count(left);
+	for (uint8_t i = 0; i < 10; i++)
+	{
+		Sim::set_pin(pin_a[left], !Sim::get_pin(pin_a[left]));
+	}
+	TEST_ASSERT_EQUAL_INT32(start, count(left));
+}
+
+/**
+ * @brief A skipped state (both channels changed between ISRs) counts zero
+ */
+void test_invalid_transition()
+{
+	const int32_t start = count(right);
+	const uint8_t state = gray[phase[right]];
+	noInterrupts();
+	set_state(right, state ^ 0x3);
+	interrupts();
+	TEST_ASSERT_EQUAL_INT32(start, count(right));
+
+	// Decoder resynchronizes on the new state
+	phase[right] = (phase[right] + 2) & 0x3;
+	for (uint8_t i = 0; i < 4; i++) step(right, +1);
+	TEST_ASSERT_EQUAL_INT32(start + 4, count(right));
+}
+
+/**
+ * @brief Each edge latches its own timestamp
+ */
+void test_edge_stamps()
+{
+	Sim::clock_advance(1000);
+	step(left, +1);
+	const uint32_t stamp_left = Hal::stamp();
+	Sim::clock_advance(500);
+	step(right, +1);
+	Sim::clock_advance(500);
+	Encoder::update();
+	const Encoder::edges_t& edges = Encoder::get_snapshot();
+	TEST_ASSERT_EQUAL_UINT32(stamp_left, edges.stamps[left]);
+	TEST_ASSERT_EQUAL_UINT32(stamp_left + 250, edges.stamps[right]);
+}
+
+/**
+ * @brief Several edges per window give the driven rate in both directions
+ */
+void test_rate_fast()
+{
+	TEST_ASSERT_FLOAT_WITHIN(0.5f, 1000.0f, drive(left, 1000.0f, 200000));
+	TEST_ASSERT_FLOAT_WITHIN(0.5f, -1000.0f, drive(left, -1000.0f, 200000));
+	TEST_ASSERT_FLOAT_WITHIN(2.0f, 5000.0f, drive(right, 5000.0f, 200000));
+	TEST_ASSERT_FLOAT_WITHIN(0.5f, 1000.0f, drive(right, 1000.0f, 200000));
+}
+
+/**
+ * @brief Edges slower than updates are timed period to period
+ */
+void test_rate_slow()
+{
+	drive(left, 20.0f, 500000);
+	for (uint8_t i = 0; i < 20; i++)
+	{
+		// Held between edges, since one count per elapsed time is larger
+		TEST_ASSERT_FLOAT_WITHIN(0.05f, 20.0f, drive(left, 20.0f, t_update));
+	}
+}
+
+/**
+ * @brief Rate decays as one count over the time since the last edge
+ */
+void test_rate_decay()
+{
+	drive(right, -500.0f, 100000);
+	for (uint32_t t = t_update; t <= 1000000; t += t_update)
+	{
+		const float rate = drive(right, 0.0f, t_update);
+		const float bound = 1.0e6f / t;
+		TEST_ASSERT_TRUE(rate <= 0.0f);
+		TEST_ASSERT_TRUE(-rate <= bound * 1.001f);
+	}
+	TEST_ASSERT_FLOAT_WITHIN(0.05f, -1.0f, Encoder::get_rate(right));
+}
+
+/**
+ * @brief A step in speed is tracked within two updates
+ */
+void test_rate_step()
+{
+	drive(left, 300.0f, 100000);
+	TEST_ASSERT_FLOAT_WITHIN(2.0f, 300.0f, Encoder::get_rate(left));
+	TEST_ASSERT_FLOAT_WITHIN(2.0f, 2000.0f, drive(left, 2000.0f, 2 * t_update));
+	TEST_ASSERT_FLOAT_WITHIN(2.0f, -800.0f, drive(left, -800.0f, 2 * t_update));
+}
+
+/**
+ * @brief Runs all tests
+ */
+int main()
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_forward);
+	RUN_TEST(test_reverse);
+	RUN_TEST(test_bounce);
+	RUN_TEST(test_invalid_transition);
+	RUN_TEST(test_edge_stamps);
+	RUN_TEST(test_rate_fast);
+	RUN_TEST(test_rate_slow);
+	RUN_TEST(test_rate_decay);
+	RUN_TEST(test_rate_step);
+	return UNITY_END();
+}
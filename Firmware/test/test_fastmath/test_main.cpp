@@ -0,0 +1,81 @@
+/**
+ * @file test_main.cpp
+ * @brief Sweeps the FastMath tables against libm
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * Run with: pio test -e native_test -f test_fastmath
+ */
+#include <unity.h>
+#include <FastMath.h>
+#include <math.h>
+
+/**
+ * Test Constants
+ */
+const double sin_tol = 2.0e-5;		// Documented sin/cos error
+const double atan2_tol = 6.0e-6;	// Documented atan2 error [rad]
+
+void setUp() {}
+void tearDown() {}
+
+/**
+ * @brief sin and cos meet their documented bound over several periods
+ */
+void test_sin_cos()
+{
+	double err_max = 0.0;
+	for (int32_t i = -2000000; i <= 2000000; i++)
+	{
+		const float x = i * 1.0e-5f;
+		const double err_sin = fabs(FastMath::sin(x) - ::sin((double)x));
+		const double err_cos = fabs(FastMath::cos(x) - ::cos((double)x));
+		if (err_sin > err_max) err_max = err_sin;
+		if (err_cos > err_max) err_max = err_cos;
+	}
+	TEST_ASSERT_TRUE(err_max <= sin_tol);
+}
+
+/**
+ * @brief sin is exact at the table ends and odd
+ */
+void test_sin_symmetry()
+{
+	TEST_ASSERT_TRUE(FastMath::sin(0.0f) == 0.0f);
+	TEST_ASSERT_FLOAT_WITHIN(1.0e-6, 1.0, FastMath::sin((float)M_PI_2));
+	for (float x = 0.0f; x < 7.0f; x += 0.01f)
+	{
+		TEST_ASSERT_TRUE(FastMath::sin(-x) == -FastMath::sin(x));
+	}
+}
+
+/**
+ * @brief atan2 meets its documented bound in all four quadrants
+ */
+void test_atan2()
+{
+	double err_max = 0.0;
+	for (uint32_t i = 0; i < 1000000; i++)
+	{
+		const double a = -M_PI + 2.0 * M_PI * i / 1000000.0;
+		const double r = 0.01 * pow(10000.0, (i % 1000) / 1000.0);
+		const float y = (float)(r * ::sin(a));
+		const float x = (float)(r * ::cos(a));
+		double err = fabs(FastMath::atan2(y, x) - ::atan2((double)y, (double)x));
+		if (err > M_PI) err = fabs(err - 2.0 * M_PI);
+		if (err > err_max) err_max = err;
+	}
+	TEST_ASSERT_TRUE(err_max <= atan2_tol);
+	TEST_ASSERT_TRUE(FastMath::atan2(0.0f, 0.0f) == 0.0f);
+}
+
+/**
+ * @brief Runs all tests
+ */
+int main()
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_sin_cos);
+	RUN_TEST(test_sin_symmetry);
+	RUN_TEST(test_atan2);
+	return UNITY_END();
+}
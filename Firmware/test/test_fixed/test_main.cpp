@@ -0,0 +1,137 @@
+/**
+ * @file test_main.cpp
+ * @brief Error bounds of the fixed-point kernels against double references
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * Run with: pio test -e native_test -f test_fixed
+ */
+#include <unity.h>
+#include <Fixed.h>
+#include <math.h>
+#include <stdlib.h>
+using namespace Fixed;
+
+/**
+ * Test Constants
+ */
+const double q16_lsb = 1.0 / 65536.0;	// Q16.16 resolution
+const double q15_lsb = 1.0 / 32768.0;	// Q1.15 resolution
+const double atan2_tol = 1.0e-4;		// Documented atan2 error [rad]
+const double sin_tol = 1.5e-4;			// Documented sin/cos error
+
+/**
+ * @brief Returns uniform random double in [lo, hi)
+ */
+double rand_range(double lo, double hi)
+{
+	return lo + (hi - lo) * (rand() / (RAND_MAX + 1.0));
+}
+
+void setUp() { srand(1); }
+void tearDown() {}
+
+/**
+ * @brief Q16.16 products are within one LSB and saturate at the limits
+ */
+void test_mul_q16()
+{
+	double err_max = 0.0;
+	for (uint32_t i = 0; i < 100000; i++)
+	{
+		const q16_t a = to_q16(rand_range(-180.0, 180.0));
+		const q16_t b = to_q16(rand_range(-180.0, 180.0));
+		const double ref = (a * q16_lsb) * (b * q16_lsb);
+		err_max = fmax(err_max, fabs(mul(a, b) * q16_lsb - ref));
+	}
+	TEST_ASSERT_TRUE(err_max <= q16_lsb);
+	TEST_ASSERT_EQUAL_INT32(q16_max, mul(to_q16(300.0f), to_q16(300.0f)));
+	TEST_ASSERT_EQUAL_INT32(q16_min, mul(to_q16(-300.0f), to_q16(300.0f)));
+}
+
+/**
+ * @brief Mixed Q16.16 x Q1.15 and Q1.15 x Q1.15 products
+ */
+void test_mul_q15()
+{
+	double err_ab = 0.0, err_bc = 0.0;
+	for (uint32_t i = 0; i < 100000; i++)
+	{
+		const q16_t a = to_q16(rand_range(-1000.0, 1000.0));
+		const q15_t b = to_q15(rand_range(-1.0, 1.0));
+		const q15_t c = to_q15(rand_range(-1.0, 1.0));
+		const double ref_ab = (a * q16_lsb) * (b * q15_lsb);
+		const double ref_bc = (b * q15_lsb) * (c * q15_lsb);
+		err_ab = fmax(err_ab, fabs(mul(a, b) * q16_lsb - ref_ab));
+		err_bc = fmax(err_bc, fabs(mul(b, c) * q15_lsb - ref_bc));
+	}
+	TEST_ASSERT_TRUE(err_ab <= q16_lsb);
+	TEST_ASSERT_TRUE(err_bc <= q15_lsb);
+}
+
+/**
+ * @brief Ratios are within two LSBs over the full 32-bit range
+ */
+void test_ratio()
+{
+	for (uint32_t i = 0; i < 100000; i++)
+	{
+		const uint32_t den = 1u + (uint32_t)rand_range(0.0, 4.0e9);
+		const uint32_t num = (uint32_t)(den * rand_range(0.0, 1.0));
+		const double ref = (double)num / den;
+		TEST_ASSERT_FLOAT_WITHIN(2.0 * q15_lsb, ref, ratio(num, den) * q15_lsb);
+	}
+	TEST_ASSERT_EQUAL_INT16(q15_max, ratio(5, 5));
+	TEST_ASSERT_EQUAL_INT16(q15_max, ratio(7, 5));
+	TEST_ASSERT_EQUAL_INT16(0, ratio(0, 5));
+}
+
+/**
+ * @brief atan2 meets its documented bound in all four quadrants
+ */
+void test_atan2()
+{
+	double err_max = 0.0;
+	for (uint32_t i = 0; i < 200000; i++)
+	{
+		const double r = rand_range(0.05, 20.0);
+		const double a = rand_range(-M_PI, M_PI);
+		const q16_t y = to_q16(r * ::sin(a));
+		const q16_t x = to_q16(r * ::cos(a));
+		double err = fabs(Fixed::atan2(y, x) * q16_lsb - ::atan2(y, (double)x));
+		if (err > M_PI) err = fabs(err - 2.0 * M_PI);
+		if (err > err_max) err_max = err;
+	}
+	TEST_ASSERT_TRUE(err_max <= atan2_tol);
+	TEST_ASSERT_EQUAL_INT32(0, Fixed::atan2(0, 0));
+}
+
+/**
+ * @brief sin and cos meet their documented bound beyond one period
+ */
+void test_sin_cos()
+{
+	double err_max = 0.0;
+	for (q16_t x = to_q16(-10.0f); x <= to_q16(10.0f); x += 7)
+	{
+		const double xd = x * q16_lsb;
+		const double err_sin = fabs(Fixed::sin(x) * q16_lsb - ::sin(xd));
+		const double err_cos = fabs(Fixed::cos(x) * q16_lsb - ::cos(xd));
+		if (err_sin > err_max) err_max = err_sin;
+		if (err_cos > err_max) err_max = err_cos;
+	}
+	TEST_ASSERT_TRUE(err_max <= sin_tol);
+}
+
+/**
+ * @brief Runs all tests
+ */
+int main()
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_mul_q16);
+	RUN_TEST(test_mul_q15);
+	RUN_TEST(test_ratio);
+	RUN_TEST(test_atan2);
+	RUN_TEST(test_sin_cos);
+	return UNITY_END();
+}
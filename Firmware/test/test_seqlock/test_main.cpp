@@ -0,0 +1,110 @@
+/**
+ * @file test_main.cpp
+ * @brief Consistency of Seqlock snapshots under a concurrent writer
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * A writer thread stands in for the encoder ISR and keeps every field of an
+ * edges-like state tied to its count. The reader checks each snapshot for
+ * that invariant, so a copy torn across a write fails the test.
+ *
+ * Run with: pio test -e native_test -f test_seqlock
+ */
+#include <unity.h>
+#include <Seqlock.h>
+#include <thread>
+
+/**
+ * Test Constants
+ */
+const uint32_t num_reads = 2000000;		// Stress test snapshots
+const int32_t count_step = 70000;		// Count change, crosses 16-bit words
+
+/**
+ * Test State
+ */
+typedef struct
+{
+	int32_t counts[2];		// Edge counts
+	uint32_t stamps[2];		// Values tied to counts
+}
+edges_t;
+
+/**
+ * @brief Returns true if every field of edges matches its count
+ */
+bool consistent(const edges_t& edges)
+{
+	return edges.stamps[0] == (uint32_t)edges.counts[0] * 3u &&
+		edges.stamps[1] == (uint32_t)edges.counts[1] * 5u;
+}
+
+/**
+ * @brief Applies write k to the state of lock
+ */
+void write(Seqlock<edges_t>& lock, uint32_t k)
+{
+	edges_t& edges = lock.write_begin();
+	edges.counts[k & 1] += (k & 2) ? count_step : -count_step;
+	edges.stamps[0] = (uint32_t)edges.counts[0] * 3u;
+	edges.stamps[1] = (uint32_t)edges.counts[1] * 5u;
+	lock.write_end();
+}
+
+void setUp() {}
+void tearDown() {}
+
+/**
+ * @brief Reads without a writer return the last write and never retry
+ */
+void test_uncontended()
+{
+	Seqlock<edges_t> lock;
+	edges_t copy;
+	TEST_ASSERT_EQUAL_UINT8(0, lock.read(copy));
+	TEST_ASSERT_EQUAL_INT32(0, copy.counts[0]);
+	for (uint32_t k = 0; k < 302; k++)
+	{
+		write(lock, k);
+	}
+	TEST_ASSERT_EQUAL_UINT8(0, lock.read(copy));
+	TEST_ASSERT_TRUE(consistent(copy));
+	TEST_ASSERT_EQUAL_INT32(-count_step, copy.counts[0]);
+	TEST_ASSERT_EQUAL_INT32(-count_step, copy.counts[1]);
+}
+
+/**
+ * @brief Every snapshot is whole while a writer thread runs
+ */
+void test_concurrent_writer()
+{
+	Seqlock<edges_t> lock;
+	volatile bool stop = false;
+	std::thread writer([&lock, &stop]()
+	{
+		for (uint32_t k = 0; !__atomic_load_n(&stop, __ATOMIC_RELAXED); k++)
+		{
+			write(lock, k);
+		}
+	});
+	uint32_t torn = 0;
+	for (uint32_t i = 0; i < num_reads; i++)
+	{
+		edges_t copy;
+		lock.read(copy);
+		if (!consistent(copy)) torn++;
+	}
+	__atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+	writer.join();
+	TEST_ASSERT_EQUAL_UINT32(0, torn);
+}
+
+/**
+ * @brief Runs all tests
+ */
+int main()
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_uncontended);
+	RUN_TEST(test_concurrent_writer);
+	return UNITY_END();
+}
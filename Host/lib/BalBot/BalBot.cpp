@@ -0,0 +1,147 @@
+/**
+ * @file BalBot.cpp
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#include <BalBot.h>
+#include <string.h>
+#include <math.h>
+
+/**
+ * @brief Constructs robot interface
+ * @param lin_vel_max Max linear velocity command [m/s]
+ * @param lin_acc_max Max linear acceleration command [m/s^2]
+ * @param yaw_vel_max Max yaw velocity command [rad/s]
+ */
+BalBot::BalBot(float lin_vel_max, float lin_acc_max, float yaw_vel_max) :
+	lin_vel_lim(lin_vel_max),
+	lin_acc_lim(lin_acc_max),
+	yaw_vel_lim(yaw_vel_max),
+	lin_vel_cmd(0.0f),
+	yaw_vel_cmd(0.0f)
+{}
+
+/**
+ * @brief Opens serial link to robot
+ * @return True if port opened
+ */
+bool BalBot::connect(const char* port, uint32_t baud)
+{
+	return link.open(port, baud);
+}
+
+/**
+ * @brief Closes serial link
+ */
+void BalBot::disconnect()
+{
+	link.close();
+}
+
+/**
+ * @brief Limits and sends commands without waiting for the state reply
+ * @param lin_vel_cmd Linear velocity [m/s]
+ * @param yaw_vel_cmd Yaw velocity [rad/s]
+ * @return True if frame was written
+ */
+bool BalBot::send_cmds(float lin_vel_cmd, float yaw_vel_cmd)
+{
+	this->lin_vel_cmd = lin_acc_lim.update(lin_vel_lim.update(lin_vel_cmd));
+	this->yaw_vel_cmd = yaw_vel_lim.update(yaw_vel_cmd);
+	const float cmds[2] = {this->lin_vel_cmd, this->yaw_vel_cmd};
+	return link.send(Protocol::id_cmd_vel, cmds, sizeof(cmds));
+}
+
+/**
+ * @brief Waits for next state reply (other replies are skipped)
+ * @return False on timeout
+ */
+bool BalBot::get_state(state_t& state, int timeout_ms)
+{
+	const uint64_t t_end = Link::now_ns() + (uint64_t)timeout_ms * 1000000ull;
+	Link::rx_frame_t rx;
+	while (true)
+	{
+		const int64_t t_left = (int64_t)(t_end - Link::now_ns());
+		if (t_left <= 0 || !link.recv_reply(rx, (int)(t_left / 1000000) + 1)) return false;
+		if (rx.frame.id == Protocol::id_state && rx.frame.len == 5 * sizeof(float)) break;
+	}
+	float vals[5];
+	memcpy(vals, rx.frame.payload, sizeof(vals));
+	state.pitch = vals[0];
+	state.lin_vel = vals[1];
+	state.yaw_vel = vals[2];
+	state.volts_L = vals[3];
+	state.volts_R = vals[4];
+	state.t_rx = rx.t_rx;
+	return true;
+}
+
+/**
+ * @brief Starts or stops robot-initiated telemetry
+ * @param decim Balance steps per frame (0 = off)
+ * @param mask Channel mask (bit = Protocol::channel_t)
+ * @return True if frame was written
+ */
+bool BalBot::set_stream(uint8_t decim, uint16_t mask)
+{
+	uint8_t payload[3];
+	payload[0] = decim;
+	memcpy(payload + 1, &mask, 2);
+	return link.send(Protocol::id_stream_cfg, payload, sizeof(payload));
+}
+
+/**
+ * @brief Waits for next telemetry frame and scales its channels
+ * @return False on timeout
+ */
+bool BalBot::read_telemetry(telemetry_t& tel, int timeout_ms)
+{
+	Link::rx_frame_t rx;
+	do
+	{
+		if (!link.recv_telemetry(rx, timeout_ms)) return false;
+	}
+	while (rx.frame.len < 6);
+	const Protocol::frame_t& frame = rx.frame;
+	memcpy(&tel.loop, frame.payload, 4);
+	memcpy(&tel.mask, frame.payload + 4, 2);
+	tel.t_rx = rx.t_rx;
+	uint8_t pos = 6;
+	for (uint8_t ch = 0; ch < Protocol::num_channels; ch++)
+	{
+		tel.values[ch] = NAN;
+		if (!(tel.mask & (1u << ch)) || pos + 2 > frame.len) continue;
+		int16_t count;
+		memcpy(&count, frame.payload + pos, 2);
+		pos += 2;
+		if (count != Protocol::channel_nan)
+		{
+			tel.values[ch] = count / Protocol::channel_scales[ch];
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Returns last limited linear velocity command [m/s]
+ */
+float BalBot::get_lin_vel_cmd() const
+{
+	return lin_vel_cmd;
+}
+
+/**
+ * @brief Returns last limited yaw velocity command [rad/s]
+ */
+float BalBot::get_yaw_vel_cmd() const
+{
+	return yaw_vel_cmd;
+}
+
+/**
+ * @brief Returns underlying link (for counters and raw frames)
+ */
+Link& BalBot::get_link()
+{
+	return link;
+}
@@ -0,0 +1,62 @@
+/**
+ * @file BalBot.h
+ * @brief C++ host interface for self-balancing robot
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * Mirrors the MATLAB BalBot class: commands pass through the same clamp and
+ * slew limiters before they are sent. Unlike the MATLAB class, sending a
+ * command does not wait for the state reply, so commands can be pipelined
+ * and replies and telemetry collected as they arrive.
+ */
+#pragma once
+#include <Link.h>
+#include <Limiters.h>
+#include <Protocol.h>
+#include <stdint.h>
+
+/**
+ * Class Declaration
+ */
+class BalBot
+{
+public:
+	// State reply
+	typedef struct
+	{
+		float pitch;		// Pitch [rad]
+		float lin_vel;		// Linear velocity [m/s]
+		float yaw_vel;		// Yaw velocity [rad/s]
+		float volts_L;		// Left motor voltage [V]
+		float volts_R;		// Right motor voltage [V]
+		uint64_t t_rx;		// Arrival time [ns]
+	}
+	state_t;
+
+	// Telemetry sample
+	typedef struct
+	{
+		uint32_t loop;		// Control loop count
+		uint16_t mask;		// Channels present
+		float values[Protocol::num_channels];	// Channel values (NaN if absent)
+		uint64_t t_rx;		// Arrival time [ns]
+	}
+	telemetry_t;
+
+	BalBot(float lin_vel_max, float lin_acc_max, float yaw_vel_max);
+	bool connect(const char* port, uint32_t baud = 57600);
+	void disconnect();
+	bool send_cmds(float lin_vel_cmd, float yaw_vel_cmd);
+	bool get_state(state_t& state, int timeout_ms);
+	bool set_stream(uint8_t decim, uint16_t mask);
+	bool read_telemetry(telemetry_t& tel, int timeout_ms);
+	float get_lin_vel_cmd() const;
+	float get_yaw_vel_cmd() const;
+	Link& get_link();
+protected:
+	Link link;
+	ClampLimiter lin_vel_lim;
+	SlewLimiter lin_acc_lim;
+	ClampLimiter yaw_vel_lim;
+	float lin_vel_cmd;
+	float yaw_vel_cmd;
+};
@@ -0,0 +1,53 @@
+/**
+ * @file Limiters.cpp
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#include <Limiters.h>
+
+/**
+ * @brief Constructs clamp limiter with output range [-max, max]
+ */
+ClampLimiter::ClampLimiter(float max) : max(max) {}
+
+/**
+ * @brief Returns input clamped to [-max, max]
+ */
+float ClampLimiter::update(float input)
+{
+	if (input > max) return max;
+	if (input < -max) return -max;
+	return input;
+}
+
+/**
+ * @brief Constructs slew limiter with max rate [units/s]
+ */
+SlewLimiter::SlewLimiter(float rate_max) :
+	rate_max(rate_max), output(0.0f), first(true)
+{}
+
+/**
+ * @brief Returns rate-limited input using time since last call
+ */
+float SlewLimiter::update(float input)
+{
+	using namespace std::chrono;
+	const steady_clock::time_point t_now = steady_clock::now();
+	const float dt = first ? 0.0f : duration<float>(t_now - t_last).count();
+	first = false;
+	t_last = t_now;
+	return update(input, dt);
+}
+
+/**
+ * @brief Returns rate-limited input given time since last call [s]
+ */
+float SlewLimiter::update(float input, float dt)
+{
+	const float delta_max = rate_max * dt;
+	const float delta = input - output;
+	if (delta > delta_max) output += delta_max;
+	else if (delta < -delta_max) output -= delta_max;
+	else output = input;
+	return output;
+}
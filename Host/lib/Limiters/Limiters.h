@@ -0,0 +1,42 @@
+/**
+ * @file Limiters.h
+ * @brief Command shaping limiters matching controls.ClampLimiter and
+ * controls.SlewLimiter in the MATLAB interface
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#pragma once
+#include <chrono>
+
+/**
+ * ClampLimiter Class Declaration
+ *
+ * Clamps input to [-max, max].
+ */
+class ClampLimiter
+{
+public:
+	ClampLimiter(float max);
+	float update(float input);
+protected:
+	float max;
+};
+
+/**
+ * SlewLimiter Class Declaration
+ *
+ * Limits output rate of change to rate_max per second, starting from zero.
+ * update(input) measures time between calls with the steady clock (zero for
+ * the first call); update(input, dt) takes it explicitly.
+ */
+class SlewLimiter
+{
+public:
+	SlewLimiter(float rate_max);
+	float update(float input);
+	float update(float input, float dt);
+protected:
+	float rate_max;
+	float output;
+	bool first;		// No clock update yet
+	std::chrono::steady_clock::time_point t_last;
+};
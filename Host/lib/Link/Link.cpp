@@ -0,0 +1,153 @@
+/**
+ * @file Link.cpp
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#include <Link.h>
+#include <chrono>
+
+/**
+ * @brief Constructs closed link
+ */
+Link::Link() :
+	running(false), tx_seq(0),
+	tx_frames(0), tx_bytes(0),
+	rx_frames(0), rx_bytes(0), rx_errors(0), rx_drops(0)
+{}
+
+/**
+ * @brief Stops reader and closes port
+ */
+Link::~Link()
+{
+	close();
+}
+
+/**
+ * @brief Opens serial port and starts reader thread
+ * @return True if port opened
+ */
+bool Link::open(const char* path, uint32_t baud)
+{
+	close();
+	if (!port.open(path, baud)) return false;
+	running = true;
+	reader = std::thread(&Link::read_loop, this);
+	return true;
+}
+
+/**
+ * @brief Stops reader thread and closes port
+ */
+void Link::close()
+{
+	running = false;
+	if (reader.joinable()) reader.join();
+	port.close();
+}
+
+/**
+ * @brief Frames payload and writes it to the port (thread-safe)
+ * @return True if frame was written
+ */
+bool Link::send(uint8_t id, const void* payload, uint8_t len)
+{
+	if (len > Protocol::max_payload) return false;
+	uint8_t buf[Protocol::max_frame];
+	std::lock_guard<std::mutex> lock(tx_mutex);
+	const uint8_t size = Protocol::encode(buf, id, tx_seq++, payload, len);
+	if (!port.write(buf, size)) return false;
+	tx_frames++;
+	tx_bytes += size;
+	return true;
+}
+
+/**
+ * @brief Pops next non-telemetry frame, waiting at most timeout_ms
+ * @return False on timeout
+ */
+bool Link::recv_reply(rx_frame_t& rx, int timeout_ms)
+{
+	return wait_pop(replies, rx, timeout_ms);
+}
+
+/**
+ * @brief Pops next telemetry frame, waiting at most timeout_ms
+ * @return False on timeout
+ */
+bool Link::recv_telemetry(rx_frame_t& rx, int timeout_ms)
+{
+	return wait_pop(telemetry, rx, timeout_ms);
+}
+
+/**
+ * @brief Returns link counters
+ */
+Link::stats_t Link::get_stats() const
+{
+	stats_t stats;
+	stats.tx_frames = tx_frames;
+	stats.tx_bytes = tx_bytes;
+	stats.rx_frames = rx_frames;
+	stats.rx_bytes = rx_bytes;
+	stats.rx_errors = rx_errors;
+	stats.rx_drops = rx_drops;
+	return stats;
+}
+
+/**
+ * @brief Returns steady clock time [ns]
+ */
+uint64_t Link::now_ns()
+{
+	using namespace std::chrono;
+	return (uint64_t)duration_cast<nanoseconds>(
+		steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Reader thread: parses port bytes into the frame queues
+ */
+void Link::read_loop()
+{
+	Protocol::parser_t parser;
+	Protocol::reset(parser);
+	uint16_t errors_seen = 0;
+	uint8_t buf[256];
+	while (running)
+	{
+		const int n = port.read(buf, sizeof(buf), 20);
+		if (n < 0) break;
+		const uint64_t t_rx = now_ns();
+		rx_bytes += (uint64_t)n;
+		for (int i = 0; i < n; i++)
+		{
+			if (!Protocol::parse(parser, buf[i])) continue;
+			rx_frame_t rx;
+			rx.frame = parser.frame;
+			rx.t_rx = t_rx;
+			const bool is_telemetry = (rx.frame.id == Protocol::id_telemetry);
+			if ((is_telemetry ? telemetry : replies).push(rx)) rx_frames++;
+			else rx_drops++;
+		}
+		rx_errors += (uint16_t)(parser.errors - errors_seen);
+		errors_seen = parser.errors;
+	}
+	running = false;
+}
+
+/**
+ * @brief Pops from queue, spinning briefly then sleeping until timeout
+ */
+bool Link::wait_pop(SpscQueue<rx_frame_t, queue_size>& queue, rx_frame_t& rx, int timeout_ms)
+{
+	using namespace std::chrono;
+	const steady_clock::time_point t_end =
+		steady_clock::now() + milliseconds(timeout_ms);
+	for (uint32_t spins = 0; ; spins++)
+	{
+		if (queue.pop(rx)) return true;
+		if (steady_clock::now() >= t_end) return false;
+		if (spins < 1000) std::this_thread::yield();
+		else std::this_thread::sleep_for(microseconds(50));
+	}
+}
@@ -0,0 +1,79 @@
+/**
+ * @file Link.h
+ * @brief Asynchronous framed serial link to the robot
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * A reader thread parses incoming bytes with the firmware's Protocol module
+ * and pushes each valid frame, stamped with its arrival time, into one of two
+ * lock-free queues: telemetry frames and all other frames (replies). Keeping
+ * them apart lets a caller wait for a reply while telemetry streams. Frames
+ * which arrive while their queue is full are dropped and counted.
+ */
+#pragma once
+#include <SerialPort.h>
+#include <SpscQueue.h>
+#include <Protocol.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <stdint.h>
+
+/**
+ * Class Declaration
+ */
+class Link
+{
+public:
+	// Received frame
+	typedef struct
+	{
+		Protocol::frame_t frame;	// Frame contents
+		uint64_t t_rx;				// Arrival time [ns, steady clock]
+	}
+	rx_frame_t;
+
+	// Link counters
+	typedef struct
+	{
+		uint64_t tx_frames;		// Frames sent
+		uint64_t tx_bytes;		// Bytes sent
+		uint64_t rx_frames;		// Valid frames received
+		uint64_t rx_bytes;		// Bytes received
+		uint64_t rx_errors;		// Rejected frames
+		uint64_t rx_drops;		// Frames dropped on full queue
+	}
+	stats_t;
+
+	// Queue size [frames]
+	static const size_t queue_size = 256;
+
+	Link();
+	~Link();
+	bool open(const char* path, uint32_t baud);
+	void close();
+	bool send(uint8_t id, const void* payload, uint8_t len);
+	bool recv_reply(rx_frame_t& rx, int timeout_ms);
+	bool recv_telemetry(rx_frame_t& rx, int timeout_ms);
+	stats_t get_stats() const;
+	static uint64_t now_ns();
+protected:
+	void read_loop();
+	static bool wait_pop(SpscQueue<rx_frame_t, queue_size>& queue, rx_frame_t& rx, int timeout_ms);
+
+	// Serial port and reader thread
+	SerialPort port;
+	std::thread reader;
+	std::atomic<bool> running;
+
+	// Received frames
+	SpscQueue<rx_frame_t, queue_size> replies;
+	SpscQueue<rx_frame_t, queue_size> telemetry;
+
+	// Transmit state
+	std::mutex tx_mutex;
+	uint8_t tx_seq;
+
+	// Counters
+	std::atomic<uint64_t> tx_frames, tx_bytes;
+	std::atomic<uint64_t> rx_frames, rx_bytes, rx_errors, rx_drops;
+};
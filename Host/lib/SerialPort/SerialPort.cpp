@@ -0,0 +1,135 @@
+/**
+ * @file SerialPort.cpp
+ * @author Dan Oates (WPI Class of 2020)
+ */
+#include <SerialPort.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <errno.h>
+
+/**
+ * Private Functions
+ */
+namespace
+{
+	/**
+	 * @brief Returns termios speed constant for baud (B0 if unsupported)
+	 */
+	speed_t to_speed(uint32_t baud)
+	{
+		switch (baud)
+		{
+			case 9600: return B9600;
+			case 19200: return B19200;
+			case 38400: return B38400;
+			case 57600: return B57600;
+			case 115200: return B115200;
+			case 230400: return B230400;
+			default: return B0;
+		}
+	}
+}
+
+/**
+ * @brief Constructs closed port
+ */
+SerialPort::SerialPort() : fd(-1) {}
+
+/**
+ * @brief Closes port
+ */
+SerialPort::~SerialPort()
+{
+	close();
+}
+
+/**
+ * @brief Opens tty at path in raw mode at baud
+ * @return True if port opened and was configured
+ */
+bool SerialPort::open(const char* path, uint32_t baud)
+{
+	close();
+	const speed_t speed = to_speed(baud);
+	if (speed == B0) return false;
+	fd = ::open(path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+	if (fd < 0) return false;
+	termios tio;
+	if (tcgetattr(fd, &tio) != 0)
+	{
+		close();
+		return false;
+	}
+	cfmakeraw(&tio);
+	tio.c_cflag |= CLOCAL | CREAD;
+	tio.c_cflag &= ~CRTSCTS;
+	tio.c_cc[VMIN] = 0;
+	tio.c_cc[VTIME] = 0;
+	cfsetispeed(&tio, speed);
+	cfsetospeed(&tio, speed);
+	if (tcsetattr(fd, TCSANOW, &tio) != 0)
+	{
+		close();
+		return false;
+	}
+	tcflush(fd, TCIOFLUSH);
+	return true;
+}
+
+/**
+ * @brief Closes port if open
+ */
+void SerialPort::close()
+{
+	if (fd >= 0)
+	{
+		::close(fd);
+		fd = -1;
+	}
+}
+
+/**
+ * @brief Returns true if port is open
+ */
+bool SerialPort::is_open() const
+{
+	return fd >= 0;
+}
+
+/**
+ * @brief Writes all of data (blocking)
+ * @return True if all bytes were written
+ */
+bool SerialPort::write(const uint8_t* data, size_t size)
+{
+	while (size > 0)
+	{
+		const ssize_t n = ::write(fd, data, size);
+		if (n < 0)
+		{
+			if (errno == EINTR || errno == EAGAIN) continue;
+			return false;
+		}
+		data += n;
+		size -= (size_t)n;
+	}
+	return true;
+}
+
+/**
+ * @brief Reads up to size bytes, waiting at most timeout_ms for the first
+ * @return Bytes read, 0 on timeout, or -1 on error or hangup
+ */
+int SerialPort::read(uint8_t* data, size_t size, int timeout_ms)
+{
+	pollfd pfd = {fd, POLLIN, 0};
+	const int ready = poll(&pfd, 1, timeout_ms);
+	if (ready < 0) return (errno == EINTR) ? 0 : -1;
+	if (ready == 0) return 0;
+	if (!(pfd.revents & POLLIN)) return -1;
+	const ssize_t n = ::read(fd, data, size);
+	if (n < 0) return (errno == EINTR || errno == EAGAIN) ? 0 : -1;
+	return (n == 0) ? -1 : (int)n;
+}
@@ -0,0 +1,29 @@
+/**
+ * @file SerialPort.h
+ * @brief Raw POSIX serial port for host tools
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * Opens a tty (Bluetooth rfcomm, USB adapter, or pty) in raw 8N1 mode with no
+ * flow control. Reads wait with poll() so a reader thread can be stopped
+ * within one timeout.
+ */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Class Declaration
+ */
+class SerialPort
+{
+public:
+	SerialPort();
+	~SerialPort();
+	bool open(const char* path, uint32_t baud);
+	void close();
+	bool is_open() const;
+	bool write(const uint8_t* data, size_t size);
+	int read(uint8_t* data, size_t size, int timeout_ms);
+protected:
+	int fd;
+};
@@ -0,0 +1,61 @@
+/**
+ * @file SpscQueue.h
+ * @brief Lock-free single-producer single-consumer ring queue
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * One thread may push and one other thread may pop without locks. The head
+ * and tail indices only ever increase and are masked into the ring, so size
+ * must be a power of two. Push fails instead of overwriting when full.
+ */
+#pragma once
+#include <atomic>
+#include <stddef.h>
+
+/**
+ * Class Declaration
+ */
+template <typename T, size_t N>
+class SpscQueue
+{
+	static_assert(N > 0 && (N & (N - 1)) == 0, "Queue size must be a power of two");
+public:
+	SpscQueue() : head(0), tail(0) {}
+
+	/**
+	 * @brief Adds item (producer thread only)
+	 * @return False if queue was full
+	 */
+	bool push(const T& item)
+	{
+		const size_t t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) == N) return false;
+		items[t & (N - 1)] = item;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * @brief Removes oldest item (consumer thread only)
+	 * @return False if queue was empty
+	 */
+	bool pop(T& item)
+	{
+		const size_t h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire)) return false;
+		item = items[h & (N - 1)];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * @brief Returns number of queued items (approximate while in use)
+	 */
+	size_t size() const
+	{
+		return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+	}
+protected:
+	T items[N];
+	alignas(64) std::atomic<size_t> head;	// Next item to pop
+	alignas(64) std::atomic<size_t> tail;	// Next slot to push
+};
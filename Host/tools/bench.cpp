@@ -0,0 +1,192 @@
+/**
+ * @file bench.cpp
+ * @brief Round-trip latency and throughput benchmark for the BalBot link
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * Runs three phases against a robot or the emulator:
+ *
+ *   1. Ping-pong: one velocity command at a time, timing each state reply.
+ *   2. Pipelined: up to window commands in flight, counting replies per second.
+ *   3. Streaming: full telemetry at every comms step, counting frames per
+ *      second and gaps in the loop counter (frames dropped by the robot).
+ *      The loop counter advances several balance steps per comms step, so
+ *      gaps are measured in units of the smallest stride seen.
+ *
+ * Usage: balbot_bench <port> [--baud 57600] [--count 500] [--window 4]
+ *                     [--seconds 5]
+ */
+#include <BalBot.h>
+#include <algorithm>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Namespace Definitions
+ */
+namespace
+{
+	// Settings
+	const char* port = nullptr;		// Serial port path
+	uint32_t baud = 57600;			// Baud rate [bit/s]
+	int count = 500;				// Ping-pong and pipelined commands
+	int window = 4;					// Pipelined commands in flight
+	float run_time = 5.0f;			// Streaming duration [s]
+	const int timeout_ms = 500;		// Reply timeout [ms]
+
+	/**
+	 * @brief Returns seconds between steady clock stamps [ns]
+	 */
+	double seconds(uint64_t t0, uint64_t t1)
+	{
+		return (t1 - t0) * 1e-9;
+	}
+
+	/**
+	 * @brief Prints percentiles of sorted round trip times [ns]
+	 */
+	void print_rtts(std::vector<uint64_t>& rtts)
+	{
+		std::sort(rtts.begin(), rtts.end());
+		const size_t n = rtts.size();
+		auto pct = [&](double p) { return rtts[(size_t)(p * (n - 1))] * 1e-6; };
+		printf("  RTT [ms]: p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n",
+			pct(0.50), pct(0.90), pct(0.99), rtts[n - 1] * 1e-6);
+	}
+
+	/**
+	 * @brief Sends commands one at a time and times each reply
+	 */
+	bool ping_pong(BalBot& bot)
+	{
+		printf("Ping-pong (%d commands)\n", count);
+		std::vector<uint64_t> rtts;
+		int timeouts = 0;
+		const uint64_t t_start = Link::now_ns();
+		for (int i = 0; i < count; i++)
+		{
+			BalBot::state_t state;
+			const uint64_t t_tx = Link::now_ns();
+			bot.send_cmds(0.0f, 0.0f);
+			if (bot.get_state(state, timeout_ms)) rtts.push_back(state.t_rx - t_tx);
+			else timeouts++;
+		}
+		const double t_run = seconds(t_start, Link::now_ns());
+		if (rtts.empty())
+		{
+			printf("  No replies\n");
+			return false;
+		}
+		print_rtts(rtts);
+		printf("  %.1f round trips/s, %d timeouts\n", rtts.size() / t_run, timeouts);
+		return true;
+	}
+
+	/**
+	 * @brief Keeps window commands in flight and counts replies
+	 */
+	void pipelined(BalBot& bot)
+	{
+		printf("Pipelined (%d commands, window %d)\n", count, window);
+		int sent = 0, received = 0;
+		const uint64_t t_start = Link::now_ns();
+		while (received < count)
+		{
+			while (sent < count && sent - received < window)
+			{
+				bot.send_cmds(0.0f, 0.0f);
+				sent++;
+			}
+			BalBot::state_t state;
+			if (!bot.get_state(state, timeout_ms)) break;
+			received++;
+		}
+		const double t_run = seconds(t_start, Link::now_ns());
+		printf("  %.1f replies/s, %d lost\n", received / t_run, sent - received);
+	}
+
+	/**
+	 * @brief Streams all channels at full rate and counts frames and gaps
+	 */
+	void streaming(BalBot& bot)
+	{
+		printf("Streaming (%.1f s, all channels)\n", run_time);
+		const uint16_t mask = (1u << Protocol::num_channels) - 1;
+		bot.set_stream(1, mask);
+		uint64_t frames = 0, missed = 0;
+		uint32_t loop_last = 0;
+		std::vector<uint32_t> strides;
+		const uint64_t t_start = Link::now_ns();
+		const uint64_t t_end = t_start + (uint64_t)(run_time * 1e9f);
+		while (Link::now_ns() < t_end)
+		{
+			BalBot::telemetry_t tel;
+			if (!bot.read_telemetry(tel, 100)) continue;
+			if (frames > 0 && tel.loop > loop_last) strides.push_back(tel.loop - loop_last);
+			loop_last = tel.loop;
+			frames++;
+		}
+		bot.set_stream(0, 0);
+		if (!strides.empty())
+		{
+			const uint32_t stride = *std::min_element(strides.begin(), strides.end());
+			for (uint32_t s : strides) missed += s / stride - 1;
+		}
+		const double t_run = seconds(t_start, Link::now_ns());
+		printf("  %.1f frames/s, %llu comms steps missed (%.1f%%)\n",
+			frames / t_run, (unsigned long long)missed,
+			frames ? 100.0 * missed / (frames + missed) : 0.0);
+	}
+
+	/**
+	 * @brief Parses command line
+	 * @return False on missing port or unknown argument
+	 */
+	bool parse_args(int argc, char** argv)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			const bool has_value = (i + 1 < argc);
+			if (!strcmp(argv[i], "--baud") && has_value) baud = atoi(argv[++i]);
+			else if (!strcmp(argv[i], "--count") && has_value) count = atoi(argv[++i]);
+			else if (!strcmp(argv[i], "--window") && has_value) window = atoi(argv[++i]);
+			else if (!strcmp(argv[i], "--seconds") && has_value) run_time = atof(argv[++i]);
+			else if (argv[i][0] != '-' && !port) port = argv[i];
+			else return false;
+		}
+		return port && baud > 0 && count > 0 && window > 0;
+	}
+}
+
+/**
+ * @brief Runs benchmark phases and prints link counters
+ */
+int main(int argc, char** argv)
+{
+	if (!parse_args(argc, argv))
+	{
+		fprintf(stderr, "Usage: %s <port> [--baud 57600] [--count 500] "
+			"[--window 4] [--seconds 5]\n", argv[0]);
+		return 1;
+	}
+	BalBot bot(1.0f, 1.0f, 1.0f);
+	if (!bot.connect(port, baud))
+	{
+		fprintf(stderr, "Could not open %s\n", port);
+		return 1;
+	}
+	if (ping_pong(bot))
+	{
+		pipelined(bot);
+		if (run_time > 0.0f) streaming(bot);
+	}
+	const Link::stats_t stats = bot.get_link().get_stats();
+	printf("Link: %llu frames / %llu bytes sent, %llu frames / %llu bytes received, "
+		"%llu rejected, %llu dropped\n",
+		(unsigned long long)stats.tx_frames, (unsigned long long)stats.tx_bytes,
+		(unsigned long long)stats.rx_frames, (unsigned long long)stats.rx_bytes,
+		(unsigned long long)stats.rx_errors, (unsigned long long)stats.rx_drops);
+	bot.disconnect();
+	return 0;
+}
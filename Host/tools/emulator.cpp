@@ -0,0 +1,360 @@
+/**
+ * @file emulator.cpp
+ * @brief Pseudo-terminal emulator of the BalBot firmware serial protocol
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * Creates a pty and answers on it the way the firmware does: a state reply for
+ * each velocity command, decimated telemetry from a simulated control loop,
+ * and empty profile and recorder dumps. Both directions are paced at the baud
+ * rate, and output frames go through a queue with the firmware's size and
+ * drop-oldest-telemetry policy, so host tools see realistic latency and
+ * throughput without a robot.
+ *
+ * Usage: balbot_emulator [--baud 57600] [--f-ctrl 100] [--link path]
+ *                        [--seconds s] [--no-throttle]
+ */
+#include <Protocol.h>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <termios.h>
+#include <unistd.h>
+
+/**
+ * Namespace Definitions
+ */
+namespace
+{
+	// Settings
+	uint32_t baud = 57600;			// Emulated baud rate [bit/s]
+	float f_ctrl = 100.0f;			// Control frequency [Hz]
+	const char* link_path = nullptr;	// Optional symlink to pty
+	float run_time = 0.0f;			// Exit after [s] (0 = never)
+	bool throttle = true;			// Pace bytes at baud rate
+
+	// Firmware output buffering [bytes]
+	const size_t tx_queue_size = 128 + 64;	// Bluetooth queue + UART ring
+
+	// Link state
+	volatile sig_atomic_t running = 1;
+	Protocol::parser_t parser;
+	std::deque<uint8_t> rx_bytes;				// Received, not yet delivered
+	std::deque<std::vector<uint8_t>> tx_frames;	// Queued output frames
+	size_t tx_len = 0;							// Queued output bytes
+	size_t tx_front_sent = 0;					// Bytes written of front frame
+	uint8_t tx_seq = 0;
+	double byte_time = 0.0;						// Time per byte [s]
+	double t_rx = 0.0;							// Delivery time of next RX byte [s]
+	double t_tx = 0.0;							// Send time of next TX byte [s]
+
+	// Simulated robot
+	float lin_vel_cmd = 0.0f;	// Linear velocity command [m/s]
+	float yaw_vel_cmd = 0.0f;	// Yaw velocity command [rad/s]
+	float lin_vel = 0.0f;		// Linear velocity [m/s]
+	float yaw_vel = 0.0f;		// Yaw velocity [rad/s]
+	uint32_t loop_count = 0;
+
+	// Telemetry stream
+	uint8_t stream_decim = 0;
+	uint16_t stream_mask = 0;
+	uint8_t stream_step = 0;
+
+	// Counters
+	uint64_t rx_frames = 0;
+	uint64_t tx_drops = 0;
+
+	/**
+	 * @brief Returns steady clock time [s]
+	 */
+	double now()
+	{
+		using namespace std::chrono;
+		return duration<double>(steady_clock::now().time_since_epoch()).count();
+	}
+
+	/**
+	 * @brief Queues frame, dropping oldest unsent telemetry to make room
+	 */
+	void send(uint8_t id, const void* payload, uint8_t len)
+	{
+		std::vector<uint8_t> frame(Protocol::max_frame);
+		frame.resize(Protocol::encode(frame.data(), id, tx_seq++, payload, len));
+		while (tx_len + frame.size() > tx_queue_size)
+		{
+			auto it = tx_frames.begin();
+			if (it != tx_frames.end() && tx_front_sent > 0) it++;
+			while (it != tx_frames.end() && (*it)[2] != Protocol::id_telemetry) it++;
+			if (it == tx_frames.end())
+			{
+				tx_drops++;
+				return;
+			}
+			tx_len -= it->size();
+			tx_frames.erase(it);
+			tx_drops++;
+		}
+		if (tx_frames.empty()) t_tx = fmax(t_tx, now());
+		tx_len += frame.size();
+		tx_frames.push_back(frame);
+	}
+
+	/**
+	 * @brief Returns simulated pitch [rad]
+	 */
+	float get_pitch()
+	{
+		return 0.02f * sinf(2.0f * (float)M_PI * 1.3f * loop_count / f_ctrl);
+	}
+
+	/**
+	 * @brief Returns simulated telemetry channel value
+	 */
+	float get_channel(uint8_t channel)
+	{
+		const float volts = 4.0f * lin_vel + 0.5f * yaw_vel;
+		switch (channel)
+		{
+			case Protocol::ch_pitch: return get_pitch();
+			case Protocol::ch_pitch_vel: return 0.02f * 2.0f * (float)M_PI * 1.3f *
+				cosf(2.0f * (float)M_PI * 1.3f * loop_count / f_ctrl);
+			case Protocol::ch_lin_vel: return lin_vel;
+			case Protocol::ch_yaw_vel: return yaw_vel;
+			case Protocol::ch_volts_L: return volts - yaw_vel;
+			case Protocol::ch_volts_R: return volts + yaw_vel;
+			case Protocol::ch_wheel_vel_L: return lin_vel / 0.04f - yaw_vel * 2.0f;
+			case Protocol::ch_wheel_vel_R: return lin_vel / 0.04f + yaw_vel * 2.0f;
+			case Protocol::ch_lin_vel_cmd: return lin_vel_cmd;
+			case Protocol::ch_yaw_vel_cmd: return yaw_vel_cmd;
+			default: return 0.0f;
+		}
+	}
+
+	/**
+	 * @brief Handles received frame as the firmware does
+	 */
+	void handle(const Protocol::frame_t& frame)
+	{
+		rx_frames++;
+		switch (frame.id)
+		{
+			case Protocol::id_cmd_vel:
+			{
+				if (frame.len != 8) break;
+				float cmds[2];
+				memcpy(cmds, frame.payload, sizeof(cmds));
+				if (isfinite(cmds[0]) && isfinite(cmds[1]))
+				{
+					lin_vel_cmd = cmds[0];
+					yaw_vel_cmd = cmds[1];
+				}
+				const float state[5] = {
+					get_pitch(), lin_vel, yaw_vel,
+					get_channel(Protocol::ch_volts_L),
+					get_channel(Protocol::ch_volts_R),
+				};
+				send(Protocol::id_state, state, sizeof(state));
+				break;
+			}
+			case Protocol::id_profile_req:
+			{
+				const uint8_t payload[2] = {0, 0};
+				send(Protocol::id_profile, payload, sizeof(payload));
+				break;
+			}
+			case Protocol::id_stream_cfg:
+				if (frame.len != 3) break;
+				stream_decim = frame.payload[0];
+				memcpy(&stream_mask, frame.payload + 1, 2);
+				stream_mask &= (1u << Protocol::num_channels) - 1;
+				stream_step = 0;
+				break;
+			case Protocol::id_record_req:
+			{
+				if (frame.len != 1 || frame.payload[0] != 0) break;
+				const uint8_t payload[6] = {0, 0, 0, 0, 0, 0};
+				send(Protocol::id_record_info, payload, sizeof(payload));
+				break;
+			}
+			default:
+				break;
+		}
+	}
+
+	/**
+	 * @brief Runs one simulated control step
+	 */
+	void step()
+	{
+		const float a = 1.0f - expf(-10.0f / f_ctrl);
+		lin_vel += a * (lin_vel_cmd - lin_vel);
+		yaw_vel += a * (yaw_vel_cmd - yaw_vel);
+		if (stream_decim > 0 && ++stream_step >= stream_decim)
+		{
+			stream_step = 0;
+			uint8_t payload[Protocol::max_payload];
+			memcpy(payload, &loop_count, 4);
+			memcpy(payload + 4, &stream_mask, 2);
+			uint8_t len = 6;
+			for (uint8_t ch = 0; ch < Protocol::num_channels; ch++)
+			{
+				if (!(stream_mask & (1u << ch))) continue;
+				const int16_t count = Protocol::to_channel(ch, get_channel(ch));
+				memcpy(payload + len, &count, 2);
+				len += 2;
+			}
+			send(Protocol::id_telemetry, payload, len);
+		}
+		loop_count++;
+	}
+
+	/**
+	 * @brief Parses command line
+	 * @return False on unknown argument
+	 */
+	bool parse_args(int argc, char** argv)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			const bool has_value = (i + 1 < argc);
+			if (!strcmp(argv[i], "--baud") && has_value) baud = atoi(argv[++i]);
+			else if (!strcmp(argv[i], "--f-ctrl") && has_value) f_ctrl = atof(argv[++i]);
+			else if (!strcmp(argv[i], "--link") && has_value) link_path = argv[++i];
+			else if (!strcmp(argv[i], "--seconds") && has_value) run_time = atof(argv[++i]);
+			else if (!strcmp(argv[i], "--no-throttle")) throttle = false;
+			else return false;
+		}
+		return baud > 0 && f_ctrl > 0.0f;
+	}
+
+	/**
+	 * @brief Stops main loop on SIGINT or SIGTERM
+	 */
+	void on_signal(int)
+	{
+		running = 0;
+	}
+}
+
+/**
+ * @brief Runs emulator until interrupted
+ */
+int main(int argc, char** argv)
+{
+	if (!parse_args(argc, argv))
+	{
+		fprintf(stderr, "Usage: %s [--baud 57600] [--f-ctrl 100] [--link path] "
+			"[--seconds s] [--no-throttle]\n", argv[0]);
+		return 1;
+	}
+
+	// Open pty, holding the slave open in raw mode so that no line discipline
+	// processing happens before or between host connections
+	const int master = posix_openpt(O_RDWR | O_NOCTTY);
+	if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+	{
+		perror("posix_openpt");
+		return 1;
+	}
+	const char* slave_path = ptsname(master);
+	const int slave = open(slave_path, O_RDWR | O_NOCTTY);
+	termios tio;
+	tcgetattr(slave, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(slave, TCSANOW, &tio);
+	fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+	if (link_path)
+	{
+		unlink(link_path);
+		if (symlink(slave_path, link_path) != 0) perror("symlink");
+	}
+	printf("%s\n", link_path ? link_path : slave_path);
+	fflush(stdout);
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	// Run link and control loop
+	Protocol::reset(parser);
+	byte_time = throttle ? 10.0 / baud : 0.0;
+	const double t_ctrl = 1.0 / f_ctrl;
+	const double t_start = now();
+	double t_step = t_start + t_ctrl;
+	while (running)
+	{
+		double t = now();
+		if (run_time > 0.0f && t - t_start >= run_time) break;
+
+		// Read host bytes
+		uint8_t buf[256];
+		ssize_t n;
+		while ((n = read(master, buf, sizeof(buf))) > 0)
+		{
+			if (rx_bytes.empty()) t_rx = fmax(t_rx, t + byte_time);
+			rx_bytes.insert(rx_bytes.end(), buf, buf + n);
+		}
+
+		// Deliver received bytes at baud rate
+		while (!rx_bytes.empty() && t_rx <= t)
+		{
+			t_rx += byte_time;
+			const uint8_t byte = rx_bytes.front();
+			rx_bytes.pop_front();
+			if (Protocol::parse(parser, byte)) handle(parser.frame);
+		}
+
+		// Control steps
+		while (t >= t_step)
+		{
+			step();
+			t_step += t_ctrl;
+		}
+
+		// Send queued bytes at baud rate
+		t = now();
+		while (!tx_frames.empty() && t_tx <= t)
+		{
+			std::vector<uint8_t>& frame = tx_frames.front();
+			size_t count = frame.size() - tx_front_sent;
+			if (byte_time > 0.0)
+			{
+				const size_t due = (size_t)((t - t_tx) / byte_time) + 1;
+				if (count > due) count = due;
+			}
+			const ssize_t w = write(master, frame.data() + tx_front_sent, count);
+			if (w <= 0) break;
+			t_tx += w * byte_time;
+			tx_front_sent += (size_t)w;
+			tx_len -= (size_t)w;
+			if (tx_front_sent == frame.size())
+			{
+				tx_frames.pop_front();
+				tx_front_sent = 0;
+			}
+		}
+
+		// Sleep until next event or host bytes
+		double t_next = t_step;
+		if (!rx_bytes.empty()) t_next = fmin(t_next, t_rx);
+		if (!tx_frames.empty()) t_next = fmin(t_next, t_tx);
+		const double t_wait = fmax(t_next - now(), 0.0);
+		timespec timeout;
+		timeout.tv_sec = (time_t)t_wait;
+		timeout.tv_nsec = (long)((t_wait - timeout.tv_sec) * 1e9);
+		pollfd pfd = {master, POLLIN, 0};
+		ppoll(&pfd, 1, &timeout, nullptr);
+	}
+
+	// Report and clean up
+	fprintf(stderr, "Emulator: %llu frames received, %u rejected, %llu frames dropped\n",
+		(unsigned long long)rx_frames, parser.errors, (unsigned long long)tx_drops);
+	if (link_path) unlink(link_path);
+	close(slave);
+	close(master);
+	return 0;
+}
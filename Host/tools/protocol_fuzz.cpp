@@ -0,0 +1,316 @@
+/**
+ * @file protocol_fuzz.cpp
+ * @brief Fuzz and throughput test of the shared frame parser
+ * @author Dan Oates (WPI Class of 2020)
+ *
+ * Runs three checks against Protocol::parse() and exits nonzero on failure:
+ *
+ *   1. Fuzz: random frames with bit flips, dropped bytes, and sync-dense
+ *      garbage bursts. Every frame left intact must be decoded, unless a
+ *      damaged frame still passed its CRC and swallowed its sync. That
+ *      happens when the byte dropped from a frame is its last and matches
+ *      the next sync, or when a corrupt candidate misses the CRC (false
+ *      accepts, which must stay near the 2^-16 CRC miss rate).
+ *   2. Throughput: parsed bytes per second for clean and corrupt streams.
+ *   3. Worst byte: the slowest single parse() call on a burst of nested
+ *      corrupt frames, all completing on the same byte, must stay close to
+ *      that of completing one maximum-size frame.
+ *
+ * Usage: balbot_protocol_fuzz [--frames 200000] [--seed 1]
+ */
+#include <Protocol.h>
+#include <Link.h>
+#include <random>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Namespace Definitions
+ */
+namespace
+{
+	// Settings
+	uint32_t num_frames = 200000;		// Fuzzed frames
+	uint32_t seed = 1;					// Random seed
+	const float p_damage = 0.1f;		// Chance a frame is damaged
+	const float false_accept_max = 1.0e-3f;	// False accepts per damaged frame
+	const int worst_reps = 2000;		// Repetitions of worst-byte bursts
+	const float worst_ratio_max = 2.5f;	// Worst byte vs frame completion
+
+	// Sent frame
+	typedef struct
+	{
+		Protocol::frame_t frame;	// Contents
+		bool intact;				// Sent without damage
+	}
+	sent_t;
+
+	std::mt19937 rng;
+
+	/**
+	 * @brief Returns uniform random integer in [0, n)
+	 */
+	uint32_t rand_below(uint32_t n)
+	{
+		return std::uniform_int_distribution<uint32_t>(0, n - 1)(rng);
+	}
+
+	/**
+	 * @brief Returns true with probability p
+	 */
+	bool chance(float p)
+	{
+		return std::uniform_real_distribution<float>(0.0f, 1.0f)(rng) < p;
+	}
+
+	/**
+	 * @brief Returns true if frames have equal contents
+	 */
+	bool same(const Protocol::frame_t& a, const Protocol::frame_t& b)
+	{
+		return a.id == b.id && a.seq == b.seq && a.len == b.len &&
+			memcmp(a.payload, b.payload, a.len) == 0;
+	}
+
+	/**
+	 * @brief Appends garbage dense in sync and version bytes
+	 */
+	void add_garbage(std::vector<uint8_t>& stream)
+	{
+		const uint32_t n = 1 + rand_below(2 * Protocol::max_frame);
+		for (uint32_t i = 0; i < n; i++)
+		{
+			const uint32_t r = rand_below(4);
+			stream.push_back(
+				(r == 0) ? Protocol::sync :
+				(r == 1) ? Protocol::version :
+				(uint8_t)rand_below(256));
+		}
+	}
+
+	/**
+	 * @brief Appends bytes that flush any rescan still pending in a parser
+	 */
+	void add_padding(std::vector<uint8_t>& stream)
+	{
+		stream.insert(stream.end(), 2 * Protocol::max_frame, 0x00);
+	}
+
+	/**
+	 * @brief Feeds stream to a fresh parser and returns the decoded frames
+	 */
+	std::vector<Protocol::frame_t> parse_all(const std::vector<uint8_t>& stream)
+	{
+		Protocol::parser_t parser;
+		Protocol::reset(parser);
+		std::vector<Protocol::frame_t> frames;
+		for (uint8_t byte : stream)
+		{
+			if (Protocol::parse(parser, byte)) frames.push_back(parser.frame);
+		}
+		return frames;
+	}
+
+	/**
+	 * @brief Streams damaged random frames and checks what the parser recovers
+	 */
+	bool fuzz()
+	{
+		printf("Fuzz (%u frames, %.0f%% damaged)\n", num_frames, 100.0f * p_damage);
+		std::vector<sent_t> sent;
+		std::vector<uint8_t> stream;
+		uint32_t damaged = 0;
+		for (uint32_t i = 0; i < num_frames; i++)
+		{
+			// Random frame
+			sent_t s;
+			s.frame.id = (uint8_t)rand_below(256);
+			s.frame.seq = (uint8_t)i;
+			s.frame.len = (uint8_t)rand_below(Protocol::max_payload + 1);
+			for (uint8_t j = 0; j < s.frame.len; j++)
+			{
+				s.frame.payload[j] = (uint8_t)rand_below(256);
+			}
+			uint8_t buf[Protocol::max_frame];
+			const uint8_t size = Protocol::encode(
+				buf, s.frame.id, s.frame.seq, s.frame.payload, s.frame.len);
+
+			// Damage: garbage burst before it, bit flip, or dropped byte
+			s.intact = true;
+			if (chance(p_damage))
+			{
+				damaged++;
+				switch (rand_below(3))
+				{
+					case 0:
+						add_garbage(stream);
+						break;
+					case 1:
+						buf[rand_below(size)] ^= (uint8_t)(1 << rand_below(8));
+						s.intact = false;
+						break;
+					case 2:
+						stream.insert(stream.end(), buf, buf + size);
+						stream.erase(stream.end() - size + rand_below(size));
+						sent.push_back({s.frame, false});
+						continue;
+				}
+			}
+			stream.insert(stream.end(), buf, buf + size);
+			sent.push_back(s);
+		}
+		add_padding(stream);
+
+		// Match decoded frames to sent frames in order
+		const std::vector<Protocol::frame_t> decoded = parse_all(stream);
+		const uint32_t window = 8;
+		uint32_t lost = 0, false_accepts = 0, damaged_accepts = 0;
+		size_t next = 0;
+		for (const Protocol::frame_t& frame : decoded)
+		{
+			size_t match = next;
+			while (match < sent.size() && match < next + window &&
+				!same(frame, sent[match].frame)) match++;
+			if (match == sent.size() || match == next + window)
+			{
+				false_accepts++;
+				continue;
+			}
+			for (; next < match; next++) lost += sent[next].intact ? 1 : 0;
+			damaged_accepts += sent[match].intact ? 0 : 1;
+			next = match + 1;
+		}
+		for (; next < sent.size(); next++) lost += sent[next].intact ? 1 : 0;
+
+		printf("  Decoded %zu of %zu, intact lost %u, damaged accepts %u, false accepts %u\n",
+			decoded.size(), sent.size(), lost, damaged_accepts, false_accepts);
+		const bool pass =
+			lost <= damaged_accepts + false_accepts &&
+			false_accepts <= (uint32_t)(false_accept_max * damaged) + 1;
+		if (!pass) printf("  FAIL\n");
+		return pass;
+	}
+
+	/**
+	 * @brief Prints parse rate of stream [MB/s]
+	 */
+	void throughput(const char* name, const std::vector<uint8_t>& stream)
+	{
+		Protocol::parser_t parser;
+		Protocol::reset(parser);
+		uint32_t frames = 0;
+		const uint64_t t0 = Link::now_ns();
+		for (uint8_t byte : stream)
+		{
+			if (Protocol::parse(parser, byte)) frames++;
+		}
+		const uint64_t t1 = Link::now_ns();
+		printf("  %-10s %7.1f MB/s (%u frames, %u rejects)\n", name,
+			stream.size() * 1.0e3 / (t1 - t0), frames, parser.errors);
+	}
+
+	/**
+	 * @brief Returns the slowest byte of a burst, as the minimum over
+	 * repetitions of each byte's parse time (robust to preemption) [ns]
+	 */
+	uint64_t worst_byte(const std::vector<uint8_t>& burst)
+	{
+		std::vector<uint64_t> t_min(burst.size(), UINT64_MAX);
+		Protocol::parser_t parser;
+		Protocol::reset(parser);
+		for (int rep = 0; rep < worst_reps; rep++)
+		{
+			for (size_t i = 0; i < burst.size(); i++)
+			{
+				const uint64_t t0 = Link::now_ns();
+				Protocol::parse(parser, burst[i]);
+				const uint64_t t = Link::now_ns() - t0;
+				if (t < t_min[i]) t_min[i] = t;
+			}
+		}
+		uint64_t worst = 0;
+		for (uint64_t t : t_min) if (t > worst) worst = t;
+		return worst;
+	}
+
+	/**
+	 * @brief Times clean and corrupt streams and the worst single byte
+	 */
+	bool bench()
+	{
+		printf("Throughput\n");
+		std::vector<uint8_t> clean, corrupt;
+		uint8_t payload[Protocol::max_payload];
+		for (uint8_t j = 0; j < Protocol::max_payload; j++) payload[j] = j;
+		for (uint32_t i = 0; i < 20000; i++)
+		{
+			uint8_t buf[Protocol::max_frame];
+			const uint8_t size = Protocol::encode(buf, 0x83, (uint8_t)i, payload,
+				(uint8_t)rand_below(Protocol::max_payload + 1));
+			clean.insert(clean.end(), buf, buf + size);
+			add_garbage(corrupt);
+			corrupt.insert(corrupt.end(), buf, buf + size);
+		}
+		throughput("clean", clean);
+		throughput("corrupt", corrupt);
+
+		// Nested headers every 5 bytes, all ending on the same byte
+		std::vector<uint8_t> nested;
+		for (uint8_t k = 0; k + Protocol::header_size <= Protocol::max_frame; k += Protocol::header_size)
+		{
+			const uint8_t len = (uint8_t)(Protocol::max_frame - k -
+				Protocol::header_size - Protocol::crc_size);
+			const uint8_t header[] = {Protocol::sync, Protocol::version, 0x83, k, len};
+			nested.insert(nested.end(), header, header + sizeof(header));
+			if (len == 0) break;
+		}
+		nested.resize(Protocol::max_frame, 0x00);
+		add_padding(nested);
+
+		// One maximum-size frame
+		std::vector<uint8_t> single(Protocol::max_frame);
+		Protocol::encode(single.data(), 0x83, 0, payload, Protocol::max_payload);
+		add_padding(single);
+
+		const uint64_t t_nested = worst_byte(nested);
+		const uint64_t t_single = worst_byte(single);
+		const float ratio = (float)t_nested / t_single;
+		printf("  Worst byte [ns]: nested corrupt %llu, max frame %llu (x%.2f)\n",
+			(unsigned long long)t_nested, (unsigned long long)t_single, ratio);
+		const bool pass = ratio <= worst_ratio_max;
+		if (!pass) printf("  FAIL (limit x%.1f)\n", worst_ratio_max);
+		return pass;
+	}
+
+	/**
+	 * @brief Parses command line arguments
+	 */
+	bool parse_args(int argc, char** argv)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			if (i + 1 < argc && strcmp(argv[i], "--frames") == 0) num_frames = atoi(argv[++i]);
+			else if (i + 1 < argc && strcmp(argv[i], "--seed") == 0) seed = atoi(argv[++i]);
+			else return false;
+		}
+		return num_frames > 0;
+	}
+}
+
+/**
+ * @brief Runs fuzz and throughput checks
+ */
+int main(int argc, char** argv)
+{
+	if (!parse_args(argc, argv))
+	{
+		fprintf(stderr, "Usage: %s [--frames 200000] [--seed 1]\n", argv[0]);
+		return 1;
+	}
+	rng.seed(seed);
+	const bool fuzz_ok = fuzz();
+	const bool bench_ok = bench();
+	return (fuzz_ok && bench_ok) ? 0 : 1;
+}
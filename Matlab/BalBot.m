@@ -9,8 +9,35 @@ classdef BalBot < handle
         yaw_vel_lim;    % Yaw velocity limiter [controls.ClampLimiter]
     end
     
+    properties (Constant, Access = protected)
+        sync = uint8(165);          % Frame start byte [0xA5]
+        version = uint8(2);         % Protocol version
+        id_cmd_vel = uint8(1);      % Velocity commands
+        id_profile_req = uint8(2);  % Profile dump request
+        id_stream_cfg = uint8(3);   % Telemetry config
+        id_record_req = uint8(4);   % Recorder command
+        id_state = uint8(129);      % State reply
+        id_profile = uint8(130);    % Profile span
+        id_telemetry = uint8(131);  % Telemetry
+        id_record_info = uint8(132);% Recorder info
+        id_record_data = uint8(133);% Recorder block part
+        
+        % Telemetry channels (mask bit order) and scales [counts per unit]
+        channels = {'pitch', 'pitch_vel', 'lin_vel', 'yaw_vel', ...
+            'volts_L', 'volts_R', 'wheel_vel_L', 'wheel_vel_R', ...
+            'lin_vel_cmd', 'yaw_vel_cmd'};
+        channel_scales = [1e4, 1e3, 1e4, 1e3, 1e3, 1e3, 1e2, 1e2, 1e4, 1e3];
+        
+        % Recorder channels (telemetry channel indices) and block layout
+        record_channels = [1, 2, 7, 8, 5, 6];
+        record_block_size = 128;
+        record_part_size = 32;
+        record_reasons = {'none', 'tip', 'i2c', 'overrun', 'host'};
+    end
+    
     properties (Access = protected)
-        serial_;    % Embedded serial interface [serial_com.SerialStruct]
+        serial_;    % Serial port [serial]
+        tx_seq;     % Transmit sequence number
     end
     
     methods (Access = public)
@@ -25,8 +52,8 @@ classdef BalBot < handle
             %   - yaw_vel_max = Max yaw velocity command [rad/s]
 %             serial_ = serial_com.make_bluetooth(bot_name);
             port  = 'auto'; baud = 57600;
-            serial_ = serial_com.make_serial(port, baud);
-            obj.serial_ = serial_com.SerialStruct(serial_);
+            obj.serial_ = serial_com.make_serial(port, baud);
+            obj.tx_seq = 0;
             obj.lin_vel_lim = controls.ClampLimiter(lin_vel_max);
             obj.lin_acc_lim = controls.SlewLimiter(lin_acc_max);
             obj.yaw_vel_lim = controls.ClampLimiter(yaw_vel_max);
@@ -55,23 +82,235 @@ classdef BalBot < handle
             yaw_vel_cmd = obj.yaw_vel_lim.update(yaw_vel_cmd);
             
             % Send filtered commands
-            obj.serial_.write(lin_vel_cmd, 'single');
-            obj.serial_.write(yaw_vel_cmd, 'single');
+            obj.send_frame(obj.id_cmd_vel, ...
+                typecast(single([lin_vel_cmd, yaw_vel_cmd]), 'uint8'));
             
             % Get state from robot
+            payload = obj.read_frame(obj.id_state);
+            vals = typecast(payload, 'single');
             state = struct();
             state.lin_vel_cmd = lin_vel_cmd;
             state.yaw_vel_cmd = yaw_vel_cmd;
-            state.pitch = obj.serial_.read('single');
-            state.lin_vel = obj.serial_.read('single');
-            state.yaw_vel = obj.serial_.read('single');
-            state.volts_L = obj.serial_.read('single');
-            state.volts_R = obj.serial_.read('single');
+            state.pitch = vals(1);
+            state.lin_vel = vals(2);
+            state.yaw_vel = vals(3);
+            state.volts_L = vals(4);
+            state.volts_R = vals(5);
+        end
+        
+        function prof = get_profile(obj)
+            %prof = GET_PROFILE(obj)
+            %   Get and reset loop timing histograms (firmware built with
+            %   PROFILE_LOOP, otherwise returns empty)
+            %
+            %   Outputs:
+            %   - prof(i).name = Span name
+            %   - prof(i).min = Min span [us]
+            %   - prof(i).max = Max span [us]
+            %   - prof(i).mean = Mean span [us]
+            %   - prof(i).count = Span count
+            %   - prof(i).max_cycle = Control cycle of max span
+            %   - prof(i).bins = Bin counts [<8us, 8-16us, ..., >=8192us]
+            names = {'Bluetooth', 'Imu', 'Encoder', 'MotorL', 'MotorR', 'Controller', 'Yaw', 'Step', ...
+                'Imu to PWM', 'Encoder to PWM', 'Controller to PWM'};
+
+            % Send dump request
+            obj.send_frame(obj.id_profile_req, uint8([]));
+
+            % Read one frame per span
+            prof = struct([]);
+            num_spans = 1;
+            i = 1;
+            while i <= num_spans
+                payload = obj.read_frame(obj.id_profile);
+                num_spans = double(payload(2));
+                if num_spans == 0, break; end
+                hist = payload(3:end);
+                prof(i).name = names{payload(1) + 1};
+                prof(i).min = double(typecast(hist(1:2), 'uint16'));
+                prof(i).max = double(typecast(hist(3:4), 'uint16'));
+                sum_us = double(typecast(hist(5:8), 'uint32'));
+                prof(i).count = double(typecast(hist(9:12), 'uint32'));
+                prof(i).mean = sum_us / max(prof(i).count, 1);
+                prof(i).max_cycle = double(typecast(hist(13:16), 'uint32'));
+                prof(i).bins = double(typecast(hist(17:40), 'uint16'));
+                i = i + 1;
+            end
+        end
+        
+        function set_stream(obj, decim, channels)
+            %SET_STREAM(obj, decim, channels)
+            %   Start or stop robot-initiated telemetry
+            %   
+            %   Inputs:
+            %   - decim = Balance steps per frame [0 = off, 1 = 100 Hz]
+            %   - channels = Cell array of channel names [see BalBot.channels]
+            mask = 0;
+            for i = 1:numel(channels)
+                bit = find(strcmp(obj.channels, channels{i}));
+                if isempty(bit)
+                    error('Unknown channel: %s', channels{i});
+                end
+                mask = bitor(mask, bitshift(1, bit - 1));
+            end
+            obj.send_frame(obj.id_stream_cfg, ...
+                [uint8(decim), typecast(uint16(mask), 'uint8')]);
+        end
+        
+        function tel = read_telemetry(obj)
+            %tel = READ_TELEMETRY(obj)
+            %   Read next telemetry frame (other frames are skipped)
+            %   
+            %   Outputs:
+            %   - tel.loop = Control loop count of sample
+            %   - tel.(name) = Channel value for each streamed channel [NaN
+            %     if the robot value was NaN]
+            payload = obj.read_frame(obj.id_telemetry);
+            tel = struct();
+            tel.loop = double(typecast(payload(1:4), 'uint32'));
+            mask = double(typecast(payload(5:6), 'uint16'));
+            i = 7;
+            for bit = 1:numel(obj.channels)
+                if bitand(mask, bitshift(1, bit - 1))
+                    count = double(typecast(payload(i:i+1), 'int16'));
+                    if count == -32768
+                        count = NaN;
+                    end
+                    tel.(obj.channels{bit}) = count / obj.channel_scales(bit);
+                    i = i + 2;
+                end
+            end
+        end
+        
+        function rec = get_record(obj)
+            %rec = GET_RECORD(obj)
+            %   Freeze and download black-box recorder (firmware built with
+            %   FLIGHT_RECORDER, otherwise returns no steps)
+            %   
+            %   Outputs:
+            %   - rec.reason = Freeze reason ['tip', 'i2c', 'overrun', 'host']
+            %   - rec.loop = Control loop count of each step
+            %   - rec.(name) = Channel values of each step [see channels]
+            %   - rec.t_step_min = Step time bin lower bound [us]
+            obj.send_frame(obj.id_record_req, uint8(0));
+            info = obj.read_frame(obj.id_record_info);
+            rec = struct();
+            rec.reason = obj.record_reasons{double(info(1)) + 1};
+            last_loop = double(typecast(info(2:5), 'uint32'));
+            num_blocks = double(info(6));
+            
+            % Reassemble blocks
+            parts = obj.record_block_size / obj.record_part_size;
+            raw = zeros(num_blocks, obj.record_block_size, 'uint8');
+            for i = 1:(num_blocks * parts)
+                payload = obj.read_frame(obj.id_record_data);
+                b = double(payload(1)) + 1;
+                j = double(payload(2)) * obj.record_part_size;
+                raw(b, j + (1:obj.record_part_size)) = payload(3:end);
+            end
+            
+            % Decode blocks
+            num_ch = numel(obj.record_channels);
+            vals = zeros(0, num_ch);
+            bins = zeros(0, 1);
+            for b = 1:num_blocks
+                block = raw(b, :);
+                val = double(typecast(block(1:12), 'int16'));
+                nib = [bitand(block, 15); bitshift(block, -4)];
+                nib = double(nib(:)');
+                shifts = nib(25:30);
+                steps = double(block(17));
+                codes = nib(35:end);
+                vals(end+1, :) = val; %#ok<AGROW>
+                bins(end+1, 1) = double(block(16)); %#ok<AGROW>
+                for s = 1:(steps - 1)
+                    for c = 1:num_ch
+                        code = codes((s - 1) * 7 + c);
+                        if code > 7, code = code - 16; end
+                        val(c) = min(max(val(c) + code * 2^shifts(c), -32768), 32767);
+                        if abs(code) >= 4 && shifts(c) < 15
+                            shifts(c) = shifts(c) + 1;
+                        elseif abs(code) <= 1 && shifts(c) > 0
+                            shifts(c) = shifts(c) - 1;
+                        end
+                    end
+                    vals(end+1, :) = val; %#ok<AGROW>
+                    bins(end+1, 1) = codes(s * 7); %#ok<AGROW>
+                end
+            end
+            
+            % Scale channels
+            n = size(vals, 1);
+            rec.loop = (last_loop - n + 1 : last_loop)';
+            for c = 1:num_ch
+                ch = obj.record_channels(c);
+                v = vals(:, c) / obj.channel_scales(ch);
+                v(vals(:, c) == -32768) = NaN;
+                rec.(obj.channels{ch}) = v;
+            end
+            rec.t_step_min = (bins > 0) .* 2.^(bins + 2);
+        end
+        
+        function rearm_record(obj)
+            %REARM_RECORD(obj) Clear and restart black-box recorder
+            obj.send_frame(obj.id_record_req, uint8(1));
         end
         
         function delete(obj)
             %DELETE(obj) Disconnects from Bluetooth
-            fclose(obj.serial_.get_serial());
+            fclose(obj.serial_);
+        end
+    end
+    
+    methods (Access = protected)
+        function send_frame(obj, id, payload)
+            %SEND_FRAME(obj, id, payload)
+            %   Frame and send payload [uint8] with given message ID
+            body = [obj.version, id, uint8(obj.tx_seq), ...
+                uint8(numel(payload)), payload(:)'];
+            crc = BalBot.crc16(body);
+            fwrite(obj.serial_, [obj.sync, body, ...
+                uint8(bitand(crc, 255)), uint8(bitshift(crc, -8))], 'uint8');
+            obj.tx_seq = mod(obj.tx_seq + 1, 256);
+        end
+        
+        function payload = read_frame(obj, id)
+            %payload = READ_FRAME(obj, id)
+            %   Read frames until a valid one with given ID arrives
+            %   Corrupt frames and other IDs are skipped.
+            while 1
+                % Find sync byte
+                if fread(obj.serial_, 1, 'uint8') ~= obj.sync, continue; end
+                
+                % Read header, payload, and CRC
+                header = uint8(fread(obj.serial_, 4, 'uint8'))';
+                if header(1) ~= obj.version, continue; end
+                len = double(header(4));
+                rest = uint8(fread(obj.serial_, len + 2, 'uint8'))';
+                payload = rest(1:len);
+                crc_rx = double(rest(end-1)) + 256 * double(rest(end));
+                if BalBot.crc16([header, payload]) == crc_rx && header(2) == id
+                    return
+                end
+            end
+        end
+    end
+    
+    methods (Static, Access = protected)
+        function crc = crc16(data)
+            %crc = CRC16(data)
+            %   CRC-16/CCITT-FALSE of data [uint8]
+            crc = 65535;
+            for byte = double(data(:)')
+                crc = bitxor(crc, bitshift(byte, 8));
+                for b = 1:8
+                    if bitand(crc, 32768)
+                        crc = bitxor(bitand(bitshift(crc, 1), 65535), 4129);
+                    else
+                        crc = bitand(bitshift(crc, 1), 65535);
+                    end
+                end
+            end
         end
     end
 end
\ No newline at end of file